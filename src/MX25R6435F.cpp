@@ -22,10 +22,78 @@
 
 #include "MX25R6435F.h"
 
+#if (MX25R6435F_DIGEST_CHUNK_SIZE < 64) || ((MX25R6435F_DIGEST_CHUNK_SIZE % 4) != 0)
+#error "MX25R6435F_DIGEST_CHUNK_SIZE must be a multiple of 4, at least 64"
+#endif
+
 MX25R6435FClass MX25R6435F;
 
-MX25R6435FClass::MX25R6435FClass(): initDone(0)
+/**
+  * @brief  Adds data to a digest computation, using the CRC unit for the
+  *         CRC-32 of the aligned words.
+  * @param  ctx   : Computation context
+  * @param  pData : Pointer to the data
+  * @param  size  : Size of the data
+  */
+static void digestUpdate(memory_digest_t *ctx, const uint8_t *pData, uint32_t size)
 {
+#if MX25R6435F_DIGEST_HW_CRC
+  uint32_t head = (uint32_t)((4 - ((uintptr_t)pData % 4)) % 4);
+
+  if ((ctx->algo == MEMORY_DIGEST_CRC32) && (size >= (head + 16))) {
+    uint32_t cr, init;
+#ifdef CRC_POL_POL
+    uint32_t pol;
+#endif
+    uint32_t words;
+    const uint32_t *pWord;
+
+    memory_digest_update(ctx, pData, head);
+    pData += head;
+    size -= head;
+
+    /* The unit is shared: its configuration is restored at the end */
+    __HAL_RCC_CRC_CLK_ENABLE();
+    cr = CRC->CR;
+    init = CRC->INIT;
+#ifdef CRC_POL_POL
+    pol = CRC->POL;
+    CRC->POL = 0x04C11DB7;
+#endif
+
+    /* Reflected CRC-32 of the words, continuing the current CRC */
+    CRC->INIT = __RBIT(~ctx->crc);
+    CRC->CR = CRC_CR_REV_IN | CRC_CR_REV_OUT | CRC_CR_RESET;
+
+    words = size / 4;
+    pWord = (const uint32_t *)pData;
+    for (uint32_t i = 0; i < words; i++) {
+      CRC->DR = pWord[i];
+    }
+    ctx->crc = ~CRC->DR;
+    ctx->length += words * 4;
+
+#ifdef CRC_POL_POL
+    CRC->POL = pol;
+#endif
+    CRC->INIT = init;
+    CRC->CR = cr;
+
+    pData += words * 4;
+    size -= words * 4;
+  }
+#endif /* MX25R6435F_DIGEST_HW_CRC */
+
+  memory_digest_update(ctx, pData, size);
+}
+
+MX25R6435FClass::MX25R6435FClass(): initDone(0), _eraseStatus(MEMORY_OK), _eraseType(MEMORY_ERASE_SECTOR),
+  _eraseStart(0), _eraseCallback(NULL), _eraseArg(NULL), _digestStatus(MEMORY_OK)
+{
+  _eraseTime[MEMORY_ERASE_SECTOR]   = MX25R6435F_SECTOR_ERASE_TYP_TIME;
+  _eraseTime[MEMORY_ERASE_SUBBLOCK] = MX25R6435F_SUBBLOCK_ERASE_TYP_TIME;
+  _eraseTime[MEMORY_ERASE_BLOCK]    = MX25R6435F_BLOCK_ERASE_TYP_TIME;
+  _eraseTime[MEMORY_ERASE_CHIP]     = MX25R6435F_CHIP_ERASE_TYP_TIME;
 }
 
 void MX25R6435FClass::begin(uint8_t data0, uint8_t data1, uint8_t data2, uint8_t data3, uint8_t sclk, uint8_t ssel)
@@ -38,6 +106,14 @@ void MX25R6435FClass::begin(uint8_t data0, uint8_t data1, uint8_t data2, uint8_t
   _qspi.pin_ssel = digitalPinToPinName(ssel);
 
   if (BSP_QSPI_Init(&_qspi) == MEMORY_OK) {
+    QSPI_Info pInfo;
+
+    /* Start the erase time estimations from the memory typical times */
+    BSP_QSPI_GetInfo(&_qspi, &pInfo);
+    for (uint8_t i = 0; i < QSPI_ERASE_NUMBER; i++) {
+      _eraseTime[i] = pInfo.EraseTypTime[i];
+    }
+
     initDone = 1;
   }
 }
@@ -66,6 +142,44 @@ uint32_t MX25R6435FClass::write(uint8_t *pData, uint32_t addr, uint32_t size)
   return size;
 }
 
+uint32_t MX25R6435FClass::program(uint8_t *pData, uint32_t addr, uint32_t size)
+{
+  /* Content of a sector to erase, shared by the instances */
+  static uint8_t sector[MX25R6435F_PROGRAM_BUFFER_SIZE];
+  static volatile uint8_t busy = 0;
+  QSPI_Info pInfo;
+  uint8_t status;
+
+  if ((pData == NULL) || (initDone == 0)) {
+    return 0;
+  }
+
+  /* Not reentrant: the buffer is in use by a program() interrupted by this one */
+  if (busy != 0) {
+    return 0;
+  }
+  busy = 1;
+
+  /* Without a buffer large enough for the sector found, a write needing
+     an erase fails */
+  BSP_QSPI_GetInfo(&_qspi, &pInfo);
+  status = BSP_QSPI_Program(&_qspi, pData, addr, size,
+                            (pInfo.EraseSectorSize <= sizeof(sector)) ? sector : NULL);
+
+  busy = 0;
+
+  return (status == MEMORY_OK) ? size : 0;
+}
+
+uint8_t MX25R6435FClass::flush(void)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Flush(&_qspi);
+}
+
 uint8_t MX25R6435FClass::read(uint32_t addr)
 {
   uint8_t data;
@@ -82,31 +196,187 @@ void MX25R6435FClass::read(uint8_t *pData, uint32_t addr, uint32_t size)
   }
 }
 
+uint8_t MX25R6435FClass::readAsync(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback, void *arg)
+{
+  if ((pData == NULL) || (initDone == 0)) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Read_Async(&_qspi, pData, addr, size, callback, arg);
+}
+
+uint8_t MX25R6435FClass::writeAsync(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback, void *arg)
+{
+  if ((pData == NULL) || (initDone == 0)) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Write_Async(&_qspi, pData, addr, size, callback, arg);
+}
+
+uint8_t MX25R6435FClass::readv(memory_iovec_t *vec, uint32_t count)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_ReadV(&_qspi, vec, count);
+}
+
+uint8_t MX25R6435FClass::writev(memory_iovec_t *vec, uint32_t count)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_WriteV(&_qspi, vec, count);
+}
+
+uint8_t MX25R6435FClass::readvAsync(memory_iovec_t *vec, uint32_t count, memory_callback_t callback, void *arg)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_ReadV_Async(&_qspi, vec, count, callback, arg);
+}
+
+uint8_t MX25R6435FClass::writevAsync(memory_iovec_t *vec, uint32_t count, memory_callback_t callback, void *arg)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_WriteV_Async(&_qspi, vec, count, callback, arg);
+}
+
+uint8_t MX25R6435FClass::digest(uint32_t addr, uint32_t size, uint8_t algo, uint8_t *pDigest)
+{
+  /* Chunks transferred while the previous one is hashed */
+  static uint32_t buf[2][MX25R6435F_DIGEST_CHUNK_SIZE / 4];
+  memory_digest_t ctx;
+  uint32_t chunk;
+  uint8_t cur = 0;
+
+  if ((pDigest == NULL) || (initDone == 0) || (addr > length()) || (size > (length() - addr))) {
+    return MEMORY_ERROR;
+  }
+
+  if (memory_digest_init(&ctx, algo) != MEMORY_OK) {
+    return MEMORY_NOT_SUPPORTED;
+  }
+
+  if ((_qspi.mapped != 0) && (_qspi.async_op == QSPI_ASYNC_NONE)) {
+    /* No copy from the mapped window */
+    digestUpdate(&ctx, BSP_QSPI_GetMappedAddress(&_qspi) + addr, size);
+  } else if (size > 0) {
+    chunk = (size < MX25R6435F_DIGEST_CHUNK_SIZE) ? size : MX25R6435F_DIGEST_CHUNK_SIZE;
+    if (digestRead((uint8_t *)buf[cur], addr, chunk) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+
+    for (;;) {
+      uint32_t next;
+
+      while (_digestStatus == MEMORY_BUSY) {
+      }
+      if (_digestStatus != MEMORY_OK) {
+        return MEMORY_ERROR;
+      }
+
+      addr += chunk;
+      size -= chunk;
+      next = (size < MX25R6435F_DIGEST_CHUNK_SIZE) ? size : MX25R6435F_DIGEST_CHUNK_SIZE;
+      if ((next > 0) && (digestRead((uint8_t *)buf[cur ^ 1], addr, next) != MEMORY_OK)) {
+        return MEMORY_ERROR;
+      }
+
+      digestUpdate(&ctx, (const uint8_t *)buf[cur], chunk);
+
+      if (next == 0) {
+        break;
+      }
+      chunk = next;
+      cur ^= 1;
+    }
+  }
+
+  memory_digest_final(&ctx, pDigest);
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FClass::digestRead(uint8_t *pData, uint32_t addr, uint32_t size)
+{
+  _digestStatus = MEMORY_BUSY;
+
+  /* Synchronous read if the transfers are not available (asynchronous
+     operation in progress) */
+  if (BSP_QSPI_Read_Async(&_qspi, pData, addr, size, digestReadDone, this) != MEMORY_OK) {
+    _digestStatus = BSP_QSPI_Read(&_qspi, pData, addr, size);
+    return _digestStatus;
+  }
+
+  return MEMORY_OK;
+}
+
+void MX25R6435FClass::digestReadDone(uint8_t status, void *arg)
+{
+  MX25R6435FClass *mem = (MX25R6435FClass *)arg;
+
+  mem->_digestStatus = status;
+}
+
 uint8_t *MX25R6435FClass::mapped(void)
 {
   if (BSP_QSPI_EnableMemoryMappedMode(&_qspi) != MEMORY_OK) {
     return NULL;
   }
 
-  return (uint8_t *)MEMORY_MAPPED_ADDRESS;
+  return BSP_QSPI_GetMappedAddress(&_qspi);
+}
+
+uint8_t MX25R6435FClass::unmap(void)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_DisableMemoryMappedMode(&_qspi);
 }
 
 uint8_t MX25R6435FClass::erase(uint32_t addr)
 {
+  uint8_t status;
+  uint32_t start = millis();
+
   if (initDone == 0) {
     return MEMORY_ERROR;
   }
 
-  return BSP_QSPI_Erase_Block(&_qspi, addr);
+  status = BSP_QSPI_Erase_Block(&_qspi, addr);
+  if (status == MEMORY_OK) {
+    updateEraseTime(MEMORY_ERASE_BLOCK, millis() - start);
+  }
+
+  return status;
 }
 
 uint8_t MX25R6435FClass::eraseChip(void)
 {
+  uint8_t status;
+  uint32_t start = millis();
+
   if (initDone == 0) {
     return MEMORY_ERROR;
   }
 
-  return BSP_QSPI_Erase_Chip(&_qspi);
+  status = BSP_QSPI_Erase_Chip(&_qspi);
+  if (status == MEMORY_OK) {
+    updateEraseTime(MEMORY_ERASE_CHIP, millis() - start);
+  }
+
+  return status;
 }
 
 uint8_t MX25R6435FClass::eraseSector(uint32_t sector)
@@ -118,6 +388,135 @@ uint8_t MX25R6435FClass::eraseSector(uint32_t sector)
   return BSP_QSPI_Erase_Sector(&_qspi, sector);
 }
 
+uint8_t MX25R6435FClass::eraseRange(uint32_t addr, uint32_t len, bool skipBlank)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Erase_Range(&_qspi, addr, len, skipBlank ? 1 : 0);
+}
+
+bool MX25R6435FClass::isBlank(uint32_t addr, uint32_t len)
+{
+  uint8_t blank;
+
+  if ((initDone == 0) || (BSP_QSPI_IsBlank(&_qspi, addr, len, &blank) != MEMORY_OK)) {
+    return false;
+  }
+
+  return (blank != 0);
+}
+
+bool MX25R6435FClass::isRetired(uint32_t addr)
+{
+  uint8_t retired;
+
+  if ((initDone == 0) || (BSP_QSPI_IsRetired(&_qspi, addr, &retired) != MEMORY_OK)) {
+    return false;
+  }
+
+  return (retired != 0);
+}
+
+uint32_t MX25R6435FClass::retiredCount(void)
+{
+  uint32_t count;
+
+  if ((initDone == 0) || (BSP_QSPI_GetRetiredCount(&_qspi, &count) != MEMORY_OK)) {
+    return 0;
+  }
+
+  return count;
+}
+
+uint32_t MX25R6435FClass::eraseRangeTime(uint32_t addr, uint32_t len)
+{
+  uint32_t count[QSPI_ERASE_NUMBER];
+  uint32_t time = 0;
+
+  if ((initDone == 0) || (BSP_QSPI_Erase_Plan(&_qspi, addr, len, count) != MEMORY_OK)) {
+    return 0;
+  }
+
+  for (uint8_t i = 0; i < QSPI_ERASE_NUMBER; i++) {
+    time += count[i] * _eraseTime[i];
+  }
+
+  return time;
+}
+
+uint8_t MX25R6435FClass::eraseAsync(memory_erase_t type, uint32_t addr, memory_callback_t callback, void *arg)
+{
+  uint8_t previous = _eraseStatus;
+  uint8_t status;
+
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  if (_eraseStatus == MEMORY_BUSY) {
+    return MEMORY_BUSY;
+  }
+
+  _eraseType = type;
+  _eraseCallback = callback;
+  _eraseArg = arg;
+  _eraseStart = millis();
+  /* Busy before the start, as the completion may come before the return */
+  _eraseStatus = MEMORY_BUSY;
+
+  /* A refused erase leaves the status of the previous one */
+  status = BSP_QSPI_Erase_Async(&_qspi, type, addr, eraseDone, this);
+  if (status != MEMORY_OK) {
+    _eraseStatus = previous;
+  }
+
+  return status;
+}
+
+uint8_t MX25R6435FClass::eraseStatus(void)
+{
+  return _eraseStatus;
+}
+
+uint32_t MX25R6435FClass::eraseRemaining(void)
+{
+  uint32_t elapsed;
+
+  if (_eraseStatus != MEMORY_BUSY) {
+    return 0;
+  }
+
+  elapsed = millis() - _eraseStart;
+  if (elapsed >= _eraseTime[_eraseType]) {
+    /* Longer than expected: the end is imminent */
+    return 1;
+  }
+
+  return _eraseTime[_eraseType] - elapsed;
+}
+
+void MX25R6435FClass::updateEraseTime(memory_erase_t type, uint32_t duration)
+{
+  /* Moving average giving a weight of 1/4 to the last measure */
+  _eraseTime[type] = (3 * _eraseTime[type] + duration + 3) / 4;
+}
+
+void MX25R6435FClass::eraseDone(uint8_t status, void *arg)
+{
+  MX25R6435FClass *mem = (MX25R6435FClass *)arg;
+
+  if (status == MEMORY_OK) {
+    mem->updateEraseTime(mem->_eraseType, millis() - mem->_eraseStart);
+  }
+  mem->_eraseStatus = status;
+
+  if (mem->_eraseCallback != NULL) {
+    mem->_eraseCallback(status, mem->_eraseArg);
+  }
+}
+
 uint8_t MX25R6435FClass::suspendErase(void)
 {
   if (initDone == 0) {
@@ -136,6 +535,24 @@ uint8_t MX25R6435FClass::resumeErase(void)
   return BSP_QSPI_ResumeErase(&_qspi);
 }
 
+uint8_t MX25R6435FClass::suspendProgram(void)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_SuspendProgram(&_qspi);
+}
+
+uint8_t MX25R6435FClass::resumeProgram(void)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_ResumeProgram(&_qspi);
+}
+
 uint8_t MX25R6435FClass::sleep(void)
 {
   if (initDone == 0) {
@@ -154,6 +571,51 @@ uint8_t MX25R6435FClass::wakeup(void)
   return BSP_QSPI_LeaveDeepPowerDown(&_qspi);
 }
 
+uint8_t MX25R6435FClass::setContinuousRead(bool enable)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_SetContinuousRead(&_qspi, enable ? 1 : 0);
+}
+
+uint8_t MX25R6435FClass::calibrate(memory_calibration_t *calib)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Calibrate(&_qspi, calib);
+}
+
+uint8_t MX25R6435FClass::setCalibration(const memory_calibration_t *calib)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_SetCalibration(&_qspi, calib);
+}
+
+#if MX25R6435F_STATS
+uint8_t MX25R6435FClass::stats(memory_stats_t *stats)
+{
+  if (initDone == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_GetStats(&_qspi, stats);
+}
+
+void MX25R6435FClass::resetStats(void)
+{
+  if (initDone != 0) {
+    BSP_QSPI_ResetStats(&_qspi);
+  }
+}
+#endif
+
 uint8_t MX25R6435FClass::status(void)
 {
   return BSP_QSPI_GetStatus(&_qspi);
@@ -164,7 +626,7 @@ uint32_t MX25R6435FClass::info(memory_info_t info)
   uint32_t res;
   QSPI_Info pInfo;
 
-  BSP_QSPI_GetInfo(&pInfo);
+  BSP_QSPI_GetInfo(&_qspi, &pInfo);
 
   switch (info) {
     case MEMORY_SIZE:
@@ -187,6 +649,10 @@ uint32_t MX25R6435FClass::info(memory_info_t info)
       res = pInfo.ProgPagesNumber;
       break;
 
+    case MEMORY_JEDEC_ID:
+      res = pInfo.JedecId;
+      break;
+
     default:
       res = 0;
       break;
@@ -199,3 +665,61 @@ uint32_t MX25R6435FClass::length(void)
 {
   return info(MEMORY_SIZE);
 }
+
+uint8_t MX25R6435FFlash::read(uint8_t *pData, uint32_t addr, uint32_t size)
+{
+  if ((pData == NULL) || (_memory.initDone == 0)) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Read(&_memory._qspi, pData, addr, size);
+}
+
+uint8_t MX25R6435FFlash::write(uint8_t *pData, uint32_t addr, uint32_t size)
+{
+  if ((pData == NULL) || (_memory.initDone == 0)) {
+    return MEMORY_ERROR;
+  }
+
+  return BSP_QSPI_Write(&_memory._qspi, pData, addr, size);
+}
+
+uint8_t MX25R6435FFlash::eraseSector(uint32_t addr)
+{
+  QSPI_Info pInfo;
+
+  if ((_memory.initDone == 0) || (addr >= _memory.length())) {
+    return MEMORY_ERROR;
+  }
+
+  /* Sector found by begin(), waits for the end of the erase */
+  BSP_QSPI_GetInfo(&_memory._qspi, &pInfo);
+  return BSP_QSPI_Erase_Range(&_memory._qspi, addr - (addr % pInfo.EraseSectorSize), pInfo.EraseSectorSize, 0);
+}
+
+uint8_t MX25R6435FFlash::sync(void)
+{
+  return _memory.flush();
+}
+
+bool MX25R6435FFlash::isRetired(uint32_t addr)
+{
+  return _memory.isRetired(addr);
+}
+
+uint32_t MX25R6435FFlash::length(void)
+{
+  return _memory.length();
+}
+
+const uint8_t *MX25R6435FFlash::map(uint32_t addr, uint32_t size)
+{
+  /* The window is left during the asynchronous operations */
+  if ((_memory.initDone == 0) || (_memory._qspi.mapped == 0) ||
+      (_memory._qspi.async_op != QSPI_ASYNC_NONE) || (addr > _memory.length()) ||
+      (size > (_memory.length() - addr))) {
+    return NULL;
+  }
+
+  return BSP_QSPI_GetMappedAddress(&_memory._qspi) + addr;
+}
@@ -22,6 +22,8 @@
 
 #include "Arduino.h"
 #include "mx25r6435f_driver.h"
+#include "MX25R6435FDevice.h"
+#include "MX25R6435FDigest.h"
 
 /*
  * For backward compatibility define the xSPI pins used by:
@@ -46,23 +48,66 @@
   #define MX25R6435F_SSEL         PE11
 #endif
 
+/*
+ * program() keeps the content of a sector to erase in a static buffer of
+ * MX25R6435F_PROGRAM_BUFFER_SIZE bytes. It must hold the largest sector of the
+ * memories in use (using build_opt.h or hal_conf_extra.h).
+ */
+#ifndef MX25R6435F_PROGRAM_BUFFER_SIZE
+  #define MX25R6435F_PROGRAM_BUFFER_SIZE  MX25R6435F_SECTOR_SIZE
+#endif
+#if MX25R6435F_PROGRAM_BUFFER_SIZE < MX25R6435F_SECTOR_SIZE
+  #error "MX25R6435F_PROGRAM_BUFFER_SIZE is smaller than the sector of the MX25R6435F"
+#endif
+
+/*
+ * digest() reads the memory by chunks of MX25R6435F_DIGEST_CHUNK_SIZE bytes in
+ * 2 buffers: the next chunk is transferred (by DMA when available) while the
+ * previous one is hashed. The CRC-32 uses the CRC unit of the STM32 when its
+ * input and output can be reversed (MX25R6435F_DIGEST_HW_CRC).
+ */
+#ifndef MX25R6435F_DIGEST_CHUNK_SIZE
+  #define MX25R6435F_DIGEST_CHUNK_SIZE  1024
+#endif
+#ifndef MX25R6435F_DIGEST_HW_CRC
+  #if defined(CRC) && defined(CRC_CR_REV_IN) && defined(CRC_CR_REV_OUT)
+    #define MX25R6435F_DIGEST_HW_CRC    1
+  #else
+    #define MX25R6435F_DIGEST_HW_CRC    0
+  #endif
+#endif
+
 /* Memory configuration paremeters */
 typedef enum {
   MEMORY_SIZE,
   MEMORY_SECTOR_SIZE,
   MEMORY_SECTOR_NUMBER,
   MEMORY_PAGE_SIZE,
-  MEMORY_PAGE_NUMBER
+  MEMORY_PAGE_NUMBER,
+  MEMORY_JEDEC_ID
 } memory_info_t;
 
-/* Memory Error codes */
-#define MEMORY_OK             QSPI_OK
-#define MEMORY_ERROR          QSPI_ERROR
-#define MEMORY_BUSY           QSPI_BUSY
-#define MEMORY_NOT_SUPPORTED  QSPI_NOT_SUPPORTED
-#define MEMORY_SUSPENDED      QSPI_SUSPENDED
+/* Memory erase granularity */
+typedef enum {
+  MEMORY_ERASE_SECTOR   = QSPI_ERASE_SECTOR,   /* 4 KBytes */
+  MEMORY_ERASE_SUBBLOCK = QSPI_ERASE_SUBBLOCK, /* 32 KBytes */
+  MEMORY_ERASE_BLOCK    = QSPI_ERASE_BLOCK,    /* 64 KBytes */
+  MEMORY_ERASE_CHIP     = QSPI_ERASE_CHIP      /* Entire memory */
+} memory_erase_t;
+
+/* Area of a vectored read or write */
+typedef QSPI_IoVec memory_iovec_t;
 
-/* Base address of the memory in mapped mode */
+/* Clock and sampling configuration of the memory interface */
+typedef QSPI_Calibration memory_calibration_t;
+
+#if MX25R6435F_STATS
+/* Statistics of the operations, indexed by QSPI_STATS_xxx */
+typedef QSPI_Stats memory_stats_t;
+#endif
+
+/* Base address of the memory in mapped mode on QUADSPI and OCTOSPI1, mapped()
+   returns the window of the interface in use */
 #define MEMORY_MAPPED_ADDRESS ((uint32_t)0x90000000)
 
 class MX25R6435FClass {
@@ -125,6 +170,30 @@ class MX25R6435FClass {
       */
     uint32_t write(uint8_t *pData, uint32_t addr, uint32_t size);
 
+    /**
+      * @brief  Writes an amount of data to the memory without prior erase.
+      *         The pages already holding the data are skipped, the others are
+      *         programmed directly when bits only go from 1 to 0. A sector is
+      *         erased and rewritten only when a bit has to go from 0 to 1.
+      * @param  pData     : Pointer to data to be written
+      * @param  addr      : Write start address
+      * @param  size      : Size of data to write
+      * @retval number of data written. 0 indicates a failure.
+      * @note A sector buffer of MX25R6435F_PROGRAM_BUFFER_SIZE bytes is
+      *       allocated statically. A write needing the erase of a larger
+      *       sector fails, as well as a call from a callback interrupting
+      *       another program().
+      */
+    uint32_t program(uint8_t *pData, uint32_t addr, uint32_t size);
+
+    /**
+      * @brief  Programs the data kept in the write cache (MX25R6435F_WRITE_CACHE)
+      *         and saves the sectors retired since the last flush
+      *         (MX25R6435F_RETIRED_TABLE).
+      * @retval memory status
+      */
+    uint8_t flush(void);
+
     /**
       * @brief  Reads one byte from the memory.
       * @param  addr : Read start address
@@ -140,12 +209,102 @@ class MX25R6435FClass {
       */
     void read(uint8_t *pData, uint32_t addr, uint32_t size);
 
+    /**
+      * @brief  Reads an amount of data from the memory without blocking.
+      * @param  pData    : Pointer to data to be read
+      * @param  addr     : Read start address
+      * @param  size     : Size of data to read
+      * @param  callback : Function called when the read is completed
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status
+      * @note This function is non blocking: pData must remain valid until
+      *       the callback is called. No other access to the memory can be
+      *       done before.
+      */
+    uint8_t readAsync(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback, void *arg = NULL);
+
+    /**
+      * @brief  Writes an amount of data to the memory without blocking.
+      * @param  pData    : Pointer to data to be written
+      * @param  addr     : Write start address
+      * @param  size     : Size of data to write
+      * @param  callback : Function called when the write is completed
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status
+      * @note Each page program is chained by interrupt, the CPU never waits
+      *       for the memory. pData must remain valid until the callback is
+      *       called. No other access to the memory can be done before.
+      */
+    uint8_t writeAsync(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback, void *arg = NULL);
+
+    /**
+      * @brief  Reads several areas of the memory.
+      * @param  vec   : Array of the areas to read
+      * @param  count : Number of areas
+      * @retval memory status
+      * @note The array is sorted in place by address. Close areas are read together.
+      */
+    uint8_t readv(memory_iovec_t *vec, uint32_t count);
+
+    /**
+      * @brief  Writes several areas of the memory.
+      * @param  vec   : Array of the areas to write
+      * @param  count : Number of areas
+      * @retval memory status
+      * @note The array is sorted in place by address. The areas in the same page are
+      *       programmed together.
+      */
+    uint8_t writev(memory_iovec_t *vec, uint32_t count);
+
+    /**
+      * @brief  Reads several areas of the memory without blocking.
+      * @param  vec      : Array of the areas to read
+      * @param  count    : Number of areas
+      * @param  callback : Function called when all the areas are read
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status
+      * @note The array is sorted in place by address. It must remain valid until the
+      *       callback is called.
+      */
+    uint8_t readvAsync(memory_iovec_t *vec, uint32_t count, memory_callback_t callback, void *arg = NULL);
+
+    /**
+      * @brief  Writes several areas of the memory without blocking.
+      * @param  vec      : Array of the areas to write
+      * @param  count    : Number of areas
+      * @param  callback : Function called when all the areas are written
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status
+      * @note The array is sorted in place by address. It must remain valid until the
+      *       callback is called.
+      */
+    uint8_t writevAsync(memory_iovec_t *vec, uint32_t count, memory_callback_t callback, void *arg = NULL);
+
+    /**
+      * @brief  Computes the digest of an area of the memory.
+      * @param  addr    : Start address of the area
+      * @param  size    : Size of the area
+      * @param  algo    : Algorithm, MEMORY_DIGEST_CRC32 or MEMORY_DIGEST_SHA256
+      * @param  pDigest : Buffer of the digest, MEMORY_DIGEST_MAX_SIZE bytes
+      * @retval memory status, MEMORY_NOT_SUPPORTED for an unknown algorithm
+      * @note In mapped mode the data are hashed from the mapped window.
+      */
+    uint8_t digest(uint32_t addr, uint32_t size, uint8_t algo, uint8_t *pDigest);
+
     /**
       * @brief  Configure the memory in mapped mode
       * @retval pointer to the memory
+      * @note The mapped mode is left during writes and erases then restored.
+      *       read() copies the data from the mapped window.
       */
     uint8_t *mapped(void);
 
+    /**
+      * @brief  Leave the mapped mode
+      * @retval memory status
+      */
+    uint8_t unmap(void);
+
     /**
       * @brief  Erases the specified block of the memory.
       * @param  addr : Block address to erase
@@ -172,9 +331,80 @@ class MX25R6435FClass {
     uint8_t eraseSector(uint32_t sector);
 
     /**
-      * @brief  This function suspends an ongoing eraseSector command.
+      * @brief  Erases an area of the memory with the smallest number of
+      *         erases: 64 KB blocks, 32 KB sub-blocks and 4 KB sectors are
+      *         mixed, the chip erase is used for the entire memory.
+      * @param  addr      : Start address of the area, aligned on a sector
+      * @param  len       : Size of the area, multiple of the sector size
+      * @param  skipBlank : true to skip the erases of already erased areas
       * @retval memory status
       */
+    uint8_t eraseRange(uint32_t addr, uint32_t len, bool skipBlank = false);
+
+    /**
+      * @brief  Check whether an area of the memory is erased.
+      * @param  addr : Start address of the area
+      * @param  len  : Size of the area
+      * @retval true if all the bytes of the area are 0xFF
+      */
+    bool isBlank(uint32_t addr, uint32_t len);
+
+    /**
+      * @brief  Check whether a sector is retired: a program or an erase still
+      *         failed in it after the retries (MX25R6435F_RETIRED_TABLE).
+      * @param  addr : Address in the sector
+      * @retval true if the sector must not be used anymore. The sector of the
+      *         table is reported as retired.
+      */
+    bool isRetired(uint32_t addr);
+
+    /* Return the number of retired sectors, including the sector of the table */
+    uint32_t retiredCount(void);
+
+    /**
+      * @brief  Estimate the duration of eraseRange() from the measured erase
+      *         durations.
+      * @param  addr : Start address of the area, aligned on a sector
+      * @param  len  : Size of the area, multiple of the sector size
+      * @retval planned time in ms, 0 if the area can't be erased
+      */
+    uint32_t eraseRangeTime(uint32_t addr, uint32_t len);
+
+    /**
+      * @brief  Erases a sector, a sub-block, a block or the entire memory
+      *         without blocking.
+      * @param  type     : erase granularity. This parameter should be a value
+      *                    of memory_erase_t.
+      * @param  addr     : Address in the area to erase (ignored for chip erase)
+      * @param  callback : Function called when the erase is completed (optional)
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status
+      * @note Completion can also be polled with eraseStatus(). No other
+      *       access to the memory can be done before.
+      */
+    uint8_t eraseAsync(memory_erase_t type, uint32_t addr, memory_callback_t callback = NULL, void *arg = NULL);
+
+    /**
+      * @brief  Return the state of the last eraseAsync().
+      * @retval MEMORY_BUSY while the erase is running, else the erase status
+      */
+    uint8_t eraseStatus(void);
+
+    /**
+      * @brief  Estimate the remaining time of the running eraseAsync().
+      *         The estimation is based on the measured erase durations.
+      * @retval remaining time in ms, 0 if no erase is running
+      */
+    uint32_t eraseRemaining(void);
+
+    /**
+      * @brief  This function suspends an ongoing eraseSector command or
+      *         eraseAsync().
+      * @retval memory status
+      * @note read() suspends and resumes a running eraseAsync() or
+      *       eraseSector() by itself. While an eraseSector() is suspended,
+      *       the writes and erases return MEMORY_SUSPENDED.
+      */
     uint8_t suspendErase(void);
 
     /**
@@ -183,6 +413,21 @@ class MX25R6435FClass {
       */
     uint8_t resumeErase(void);
 
+    /**
+      * @brief  This function suspends an ongoing page program. A writeAsync()
+      *         stops at its current page until resumeProgram() is called.
+      * @retval memory status
+      * @note Only read() can be called until the program is resumed.
+      */
+    uint8_t suspendProgram(void);
+
+    /**
+      * @brief  This function resumes a suspended page program and the
+      *         writeAsync() stopped by suspendProgram().
+      * @retval memory status
+      */
+    uint8_t resumeProgram(void);
+
     /**
       * @brief  This function enter the memory in deep power down mode.
       * @retval memory status
@@ -195,6 +440,48 @@ class MX25R6435FClass {
       */
     uint8_t wakeup(void);
 
+    /**
+      * @brief  Enables/disables the continuous read mode. The memory is kept
+      *         in performance enhance mode: the read instruction is skipped
+      *         for the next reads and mapped mode cache line refills.
+      * @param  enable : true to enable, false to disable
+      * @retval memory status
+      * @note Disabled by begin(). The memory leaves this mode automatically
+      *       before writes and erases.
+      */
+    uint8_t setContinuousRead(bool enable);
+
+    /**
+      * @brief  Find the fastest working clock and sampling configuration of
+      *         the memory interface (OCTOSPI only) and apply it.
+      * @param  calib : Configuration found. It can be saved and given to
+      *                 setCalibration() at next boots to skip the search.
+      * @retval memory status. MEMORY_NOT_SUPPORTED on QUADSPI.
+      */
+    uint8_t calibrate(memory_calibration_t *calib);
+
+    /**
+      * @brief  Apply a configuration found by calibrate() at a previous boot.
+      * @param  calib : Configuration to apply
+      * @retval memory status. MEMORY_ERROR if the configuration does not
+      *         match the current clock or does not work anymore: calibrate()
+      *         has to be called again.
+      */
+    uint8_t setCalibration(const memory_calibration_t *calib);
+
+#if MX25R6435F_STATS
+    /**
+      * @brief  Copy the statistics of the operations (MX25R6435F_STATS): calls,
+      *         bytes and durations in CPU cycles with their histogram.
+      * @param  stats : Copy of the statistics
+      * @retval memory status
+      */
+    uint8_t stats(memory_stats_t *stats);
+
+    /* Clear the statistics of the operations */
+    void resetStats(void);
+#endif
+
     /* Reads current status of the memory.*/
     uint8_t status(void);
 
@@ -212,8 +499,49 @@ class MX25R6435FClass {
   private:
     uint8_t initDone;
     QSPI_t _qspi;
+
+    /* Asynchronous erase tracking */
+    volatile uint8_t _eraseStatus;
+    memory_erase_t _eraseType;
+    uint32_t _eraseStart;
+    uint32_t _eraseTime[QSPI_ERASE_NUMBER]; /* Estimated duration in ms of each erase type */
+    memory_callback_t _eraseCallback;
+    void *_eraseArg;
+
+    void updateEraseTime(memory_erase_t type, uint32_t duration);
+    static void eraseDone(uint8_t status, void *arg);
+
+    /* Status of the chunk read by digest(), MEMORY_BUSY until it is received */
+    volatile uint8_t _digestStatus;
+
+    uint8_t digestRead(uint8_t *pData, uint32_t addr, uint32_t size);
+    static void digestReadDone(uint8_t status, void *arg);
+
+    friend class MX25R6435FFlash;
 };
 
 extern MX25R6435FClass MX25R6435F;
 
+/* MX25R6435FDevice interface of the memory, used by the storage classes */
+class MX25R6435FFlash : public MX25R6435FDevice {
+  public:
+    MX25R6435FFlash(MX25R6435FClass &memory = MX25R6435F): _memory(memory) {};
+
+    uint8_t read(uint8_t *pData, uint32_t addr, uint32_t size);
+    uint8_t write(uint8_t *pData, uint32_t addr, uint32_t size);
+
+    /* Erase the sector containing an address, of the size found by begin() */
+    uint8_t eraseSector(uint32_t addr);
+    uint8_t sync(void);
+    uint32_t length(void);
+
+    /* Return the data in the mapped window, if the memory is in mapped mode */
+    const uint8_t *map(uint32_t addr, uint32_t size);
+
+    bool isRetired(uint32_t addr);
+
+  private:
+    MX25R6435FClass &_memory;
+};
+
 #endif /* _MX25R6435F_H_ */
@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FBlockDevice.cpp
+  * @brief   Block device of the MX25R6435F library, for the file systems
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FBlockDevice.h"
+
+MX25R6435FBlockDevice::MX25R6435FBlockDevice(MX25R6435FDevice &device, uint32_t addr, uint32_t size,
+                                             uint32_t readSize, uint32_t progSize, uint32_t blockSize): _device(device),
+  _addr(addr - (addr % MX25R6435F_SECTOR_SIZE)), _readSize(readSize), _progSize(progSize), _blockSize(blockSize),
+  _blockCount(0), _bufAddr(0), _bufSize(0)
+{
+  /* The granularities divide the block, which is made of whole sectors */
+  if ((readSize != 0) && (progSize != 0) && (blockSize != 0) && ((blockSize % MX25R6435F_SECTOR_SIZE) == 0) &&
+      ((blockSize % readSize) == 0) && ((blockSize % progSize) == 0)) {
+    _blockCount = size / blockSize;
+  }
+}
+
+bool MX25R6435FBlockDevice::valid(uint32_t block, uint32_t off, uint32_t size, uint32_t granularity)
+{
+  return (block < _blockCount) && (off <= _blockSize) && (size <= (_blockSize - off)) &&
+         ((off % granularity) == 0) && ((size % granularity) == 0);
+}
+
+void MX25R6435FBlockDevice::invalidate(uint32_t addr, uint32_t size)
+{
+  if ((addr < (_bufAddr + _bufSize)) && ((addr + size) > _bufAddr)) {
+    _bufSize = 0;
+  }
+}
+
+uint8_t MX25R6435FBlockDevice::read(uint32_t block, uint32_t off, uint8_t *pData, uint32_t size)
+{
+  uint32_t addr = _addr + (block * _blockSize) + off;
+  uint32_t end = _addr + (_blockCount * _blockSize);
+  const uint8_t *pMapped;
+
+  if ((pData == NULL) || !valid(block, off, size, _readSize)) {
+    return MEMORY_ERROR;
+  }
+
+  pMapped = _device.map(addr, size);
+  if (pMapped != NULL) {
+    memcpy(pData, pMapped, size);
+    return MEMORY_OK;
+  }
+
+  while (size > 0) {
+    uint32_t chunk;
+
+    if ((addr >= _bufAddr) && (addr < (_bufAddr + _bufSize))) {
+      chunk = _bufAddr + _bufSize - addr;
+      if (chunk > size) {
+        chunk = size;
+      }
+      memcpy(pData, &_buf[addr - _bufAddr], chunk);
+    } else if (size >= MX25R6435F_BD_LOOKAHEAD_SIZE) {
+      /* Large reads go to the buffer of the caller */
+      return _device.read(pData, addr, size);
+    } else {
+      /* Small reads bring the following data in the lookahead buffer */
+      _bufAddr = addr;
+      _bufSize = end - addr;
+      if (_bufSize > MX25R6435F_BD_LOOKAHEAD_SIZE) {
+        _bufSize = MX25R6435F_BD_LOOKAHEAD_SIZE;
+      }
+      if (_device.read(_buf, _bufAddr, _bufSize) != MEMORY_OK) {
+        _bufSize = 0;
+        return MEMORY_ERROR;
+      }
+      continue;
+    }
+
+    pData += chunk;
+    addr += chunk;
+    size -= chunk;
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FBlockDevice::prog(uint32_t block, uint32_t off, uint8_t *pData, uint32_t size)
+{
+  uint32_t addr = _addr + (block * _blockSize) + off;
+
+  if ((pData == NULL) || !valid(block, off, size, _progSize)) {
+    return MEMORY_ERROR;
+  }
+
+  invalidate(addr, size);
+
+  return _device.write(pData, addr, size);
+}
+
+uint8_t MX25R6435FBlockDevice::erase(uint32_t block)
+{
+  uint32_t addr = _addr + (block * _blockSize);
+
+  if (!valid(block, 0, _blockSize, 1)) {
+    return MEMORY_ERROR;
+  }
+
+  invalidate(addr, _blockSize);
+
+  for (uint32_t i = 0; i < _blockSize; i += MX25R6435F_SECTOR_SIZE) {
+    if (_device.eraseSector(addr + i) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FBlockDevice::sync(void)
+{
+  return _device.sync();
+}
+
+const uint8_t *MX25R6435FBlockDevice::map(uint32_t block, uint32_t off, uint32_t size)
+{
+  if (!valid(block, off, size, 1)) {
+    return NULL;
+  }
+
+  return _device.map(_addr + (block * _blockSize) + off, size);
+}
+
+uint32_t MX25R6435FBlockDevice::readSize(void)
+{
+  return _readSize;
+}
+
+uint32_t MX25R6435FBlockDevice::progSize(void)
+{
+  return _progSize;
+}
+
+uint32_t MX25R6435FBlockDevice::blockSize(void)
+{
+  return _blockSize;
+}
+
+uint32_t MX25R6435FBlockDevice::blockCount(void)
+{
+  return _blockCount;
+}
@@ -0,0 +1,116 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FBlockDevice.h
+  * @brief   Block device of the MX25R6435F library, for the file systems
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_BLOCKDEVICE_H_
+#define _MX25R6435F_BLOCKDEVICE_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Size of the lookahead buffer of the small reads */
+#ifndef MX25R6435F_BD_LOOKAHEAD_SIZE
+#define MX25R6435F_BD_LOOKAHEAD_SIZE  512
+#endif
+
+/*
+ * Blocks of an area of a MX25R6435FDevice, with the read/prog/erase/sync
+ * operations and the granularities expected by file systems such as littlefs.
+ * The data are passed to the device without intermediate copy; the small
+ * reads are served from a lookahead buffer filled by larger reads, or
+ * directly from the mapped window of the device when it is available.
+ */
+class MX25R6435FBlockDevice {
+  public:
+    /**
+      * @brief  Constructor.
+      * @param  device    : Device holding the area
+      * @param  addr      : Start address of the area, aligned on a sector
+      * @param  size      : Size of the area
+      * @param  readSize  : Granularity of the reads
+      * @param  progSize  : Granularity of the programs
+      * @param  blockSize : Size of the blocks, multiple of the sector size
+      */
+    MX25R6435FBlockDevice(MX25R6435FDevice &device, uint32_t addr, uint32_t size, uint32_t readSize = 1,
+                          uint32_t progSize = MX25R6435F_PAGE_SIZE, uint32_t blockSize = MX25R6435F_SECTOR_SIZE);
+
+    /**
+      * @brief  Reads data of a block.
+      * @param  block : Block number
+      * @param  off   : Offset in the block, multiple of the read size
+      * @param  pData : Pointer to data to be read
+      * @param  size  : Size of data to read, multiple of the read size
+      * @retval memory status
+      */
+    uint8_t read(uint32_t block, uint32_t off, uint8_t *pData, uint32_t size);
+
+    /**
+      * @brief  Programs data of an erased block.
+      * @param  block : Block number
+      * @param  off   : Offset in the block, multiple of the program size
+      * @param  pData : Pointer to data to be programmed
+      * @param  size  : Size of data to program, multiple of the program size
+      * @retval memory status
+      */
+    uint8_t prog(uint32_t block, uint32_t off, uint8_t *pData, uint32_t size);
+
+    /**
+      * @brief  Erases a block.
+      * @param  block : Block number
+      * @retval memory status
+      */
+    uint8_t erase(uint32_t block);
+
+    /**
+      * @brief  Programs the data still buffered by the device.
+      * @retval memory status
+      */
+    uint8_t sync(void);
+
+    /**
+      * @brief  Gives direct access to data of a block, without copy.
+      * @param  block : Block number
+      * @param  off   : Offset in the block
+      * @param  size  : Size of the data
+      * @retval pointer to the data, valid until the next prog or erase, or
+      *         NULL if the device is not mapped
+      */
+    const uint8_t *map(uint32_t block, uint32_t off, uint32_t size);
+
+    /* Return the granularities and the number of blocks, 0 if the
+       configuration is not valid */
+    uint32_t readSize(void);
+    uint32_t progSize(void);
+    uint32_t blockSize(void);
+    uint32_t blockCount(void);
+
+  private:
+    MX25R6435FDevice &_device;
+    uint32_t _addr;
+    uint32_t _readSize;
+    uint32_t _progSize;
+    uint32_t _blockSize;
+    uint32_t _blockCount;
+    uint32_t _bufAddr;     /* Address of the data of the lookahead buffer */
+    uint32_t _bufSize;
+    uint8_t _buf[MX25R6435F_BD_LOOKAHEAD_SIZE];
+
+    bool valid(uint32_t block, uint32_t off, uint32_t size, uint32_t granularity);
+    void invalidate(uint32_t addr, uint32_t size);
+};
+
+#endif /* _MX25R6435F_BLOCKDEVICE_H_ */
@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FConfig.cpp
+  * @brief   Power-loss-safe configuration store of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FConfig.h"
+
+#define CONFIG_MAGIC    0x31474643 /* "CFG1" */
+#define CONFIG_NONE     0xFF       /* No group receiving the versions */
+
+/* Size of a version in the group, aligned on 4 bytes */
+#define CONFIG_LENGTH(size) ((sizeof(record_t) + (size) + 3) & ~3UL)
+
+MX25R6435FConfig::MX25R6435FConfig(MX25R6435FDevice &device, uint32_t addr, uint32_t size): _device(device),
+  _addr(addr - (addr % MX25R6435F_SECTOR_SIZE)), _groupSize(0), _mounted(0), _group(CONFIG_NONE), _offset(0),
+  _seq(0), _size(0), _valid(0)
+{
+  /* Each group is made of whole sectors */
+  _groupSize = ((size / 2) / MX25R6435F_SECTOR_SIZE) * MX25R6435F_SECTOR_SIZE;
+}
+
+uint32_t MX25R6435FConfig::groupAddr(uint8_t group)
+{
+  return _addr + (group * _groupSize);
+}
+
+uint32_t MX25R6435FConfig::place(uint32_t offset, uint32_t len)
+{
+  /* A version fitting in a page does not straddle two, so that it is
+     programmed at once */
+  if ((len <= MX25R6435F_PAGE_SIZE) && (((offset % MX25R6435F_PAGE_SIZE) + len) > MX25R6435F_PAGE_SIZE)) {
+    offset += MX25R6435F_PAGE_SIZE - (offset % MX25R6435F_PAGE_SIZE);
+  }
+
+  return offset;
+}
+
+bool MX25R6435FConfig::blank(uint32_t addr, uint32_t size)
+{
+  uint8_t buf[32];
+
+  while (size > 0) {
+    uint32_t chunk = (size < sizeof(buf)) ? size : sizeof(buf);
+
+    if (_device.read(buf, addr, chunk) != MEMORY_OK) {
+      return false;
+    }
+    for (uint32_t i = 0; i < chunk; i++) {
+      if (buf[i] != 0xFF) {
+        return false;
+      }
+    }
+    addr += chunk;
+    size -= chunk;
+  }
+
+  return true;
+}
+
+uint8_t MX25R6435FConfig::readRecord(uint8_t group, uint32_t offset, record_t *record)
+{
+  uint32_t addr = groupAddr(group) + offset;
+
+  if (((offset + sizeof(record_t)) > _groupSize) ||
+      (_device.read((uint8_t *)record, addr, sizeof(record_t)) != MEMORY_OK) ||
+      (record->magic != CONFIG_MAGIC) || (record->check != (uint16_t)~record->size) ||
+      (record->size > MX25R6435F_CONFIG_MAX_SIZE) || ((offset + CONFIG_LENGTH(record->size)) > _groupSize) ||
+      ((record->size > 0) && (_device.read(_record, addr + sizeof(record_t), record->size) != MEMORY_OK))) {
+    return MEMORY_ERROR;
+  }
+
+  if (memory_crc32(memory_crc32(0, (uint8_t *)record, sizeof(record_t) - sizeof(uint32_t)), _record,
+                   record->size) != record->crc) {
+    return MEMORY_ERROR;
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FConfig::scan(uint8_t group)
+{
+  uint32_t offset = 0;
+  record_t record;
+
+  /* The versions follow each other, or start on the next page */
+  for (;;) {
+    uint32_t next = offset + MX25R6435F_PAGE_SIZE - (offset % MX25R6435F_PAGE_SIZE);
+
+    if (readRecord(group, offset, &record) != MEMORY_OK) {
+      if (((offset % MX25R6435F_PAGE_SIZE) == 0) || (readRecord(group, next, &record) != MEMORY_OK)) {
+        break;
+      }
+      offset = next;
+    }
+
+    memcpy(_data, _record, record.size);
+    _size = record.size;
+    _seq = record.seq;
+    _valid = 1;
+    offset += CONFIG_LENGTH(record.size);
+  }
+
+  _group = group;
+  _offset = offset;
+
+  return (_valid != 0) ? MEMORY_OK : MEMORY_ERROR;
+}
+
+uint8_t MX25R6435FConfig::begin(void)
+{
+  record_t first[2];
+  uint8_t valid[2];
+  uint8_t group;
+
+  _mounted = 0;
+  _group = CONFIG_NONE;
+  _valid = 0;
+  _size = 0;
+  _seq = 0;
+
+  if (_groupSize == 0) {
+    return MEMORY_ERROR;
+  }
+  _mounted = 1;
+
+  /* The group receiving the versions starts with the most recent one */
+  valid[0] = (readRecord(0, 0, &first[0]) == MEMORY_OK);
+  valid[1] = (readRecord(1, 0, &first[1]) == MEMORY_OK);
+
+  if (!valid[0] && !valid[1]) {
+    return MEMORY_ERROR;
+  }
+
+  group = (valid[1] && (!valid[0] || ((int32_t)(first[1].seq - first[0].seq) > 0))) ? 1 : 0;
+
+  return scan(group);
+}
+
+uint8_t MX25R6435FConfig::save(uint8_t *pData, uint16_t size)
+{
+  uint32_t len = CONFIG_LENGTH(size);
+  uint32_t offset = 0;
+  record_t record;
+
+  if ((_mounted == 0) || (size > MX25R6435F_CONFIG_MAX_SIZE) || ((pData == NULL) && (size != 0))) {
+    return MEMORY_ERROR;
+  }
+
+  if ((_valid != 0) && (size == _size) && ((size == 0) || (memcmp(pData, _data, size) == 0))) {
+    return MEMORY_OK;
+  }
+
+  record.magic = CONFIG_MAGIC;
+  record.seq = _seq + 1;
+  record.size = size;
+  record.check = ~size;
+  record.crc = memory_crc32(memory_crc32(0, (uint8_t *)&record, sizeof(record_t) - sizeof(uint32_t)), pData, size);
+
+  /* Append to the group if the place is still erased */
+  if (_group != CONFIG_NONE) {
+    offset = place(_offset, len);
+    if (((offset + len) <= _groupSize) && !blank(groupAddr(_group) + offset, len)) {
+      offset = _groupSize;
+    }
+  }
+
+  /* Otherwise the other group is erased for the new version, the current
+     one is kept until then */
+  if ((_group == CONFIG_NONE) || ((offset + len) > _groupSize)) {
+    uint8_t group = (_group == 0) ? 1 : 0;
+
+    for (uint32_t i = 0; i < _groupSize; i += MX25R6435F_SECTOR_SIZE) {
+      if (_device.eraseSector(groupAddr(group) + i) != MEMORY_OK) {
+        return MEMORY_ERROR;
+      }
+    }
+    _group = group;
+    offset = 0;
+  }
+
+  memcpy(_record, &record, sizeof(record_t));
+  if (size > 0) {
+    memcpy(_record + sizeof(record_t), pData, size);
+  }
+  if (_device.write(_record, groupAddr(_group) + offset, sizeof(record_t) + size) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  _offset = offset + len;
+  _seq++;
+  _size = size;
+  _valid = 1;
+  if (size > 0) {
+    memcpy(_data, pData, size);
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FConfig::load(uint8_t *pData, uint16_t maxSize, uint16_t *pSize)
+{
+  uint16_t size = (_size < maxSize) ? _size : maxSize;
+
+  if ((_valid == 0) || ((pData == NULL) && (maxSize != 0))) {
+    return MEMORY_ERROR;
+  }
+
+  if (size > 0) {
+    memcpy(pData, _data, size);
+  }
+  if (pSize != NULL) {
+    *pSize = _size;
+  }
+
+  return MEMORY_OK;
+}
+
+const uint8_t *MX25R6435FConfig::data(void)
+{
+  return (_valid != 0) ? _data : NULL;
+}
+
+uint16_t MX25R6435FConfig::size(void)
+{
+  return _size;
+}
@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FConfig.h
+  * @brief   Power-loss-safe configuration store of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_CONFIG_H_
+#define _MX25R6435F_CONFIG_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Maximum size of the configuration, kept in RAM */
+#ifndef MX25R6435F_CONFIG_MAX_SIZE
+#define MX25R6435F_CONFIG_MAX_SIZE    240
+#endif
+
+/*
+ * Configuration saved in an area of a MX25R6435FDevice split into 2 groups of
+ * sectors. Each save appends a new version to the current group; when it is
+ * full, the other group is erased and receives the new version. The previous
+ * versions are only erased once a newer one is complete, so a power loss
+ * during a save leaves the last saved version. A copy of the configuration is
+ * kept in RAM, the reads do not access the memory.
+ */
+class MX25R6435FConfig {
+  public:
+    /**
+      * @brief  Constructor.
+      * @param  device : Device holding the area
+      * @param  addr   : Start address of the area, aligned on a sector
+      * @param  size   : Size of the area, at least 2 sectors
+      */
+    MX25R6435FConfig(MX25R6435FDevice &device, uint32_t addr, uint32_t size);
+
+    /**
+      * @brief  Loads the last version of the configuration.
+      * @retval memory status, MEMORY_ERROR if no configuration has been saved.
+      *         save() can be used in both cases.
+      */
+    uint8_t begin(void);
+
+    /**
+      * @brief  Saves a new version of the configuration. Nothing is written if
+      *         it does not change.
+      * @param  pData : Configuration
+      * @param  size  : Size of the configuration, up to MX25R6435F_CONFIG_MAX_SIZE
+      * @retval memory status
+      */
+    uint8_t save(uint8_t *pData, uint16_t size);
+
+    /**
+      * @brief  Copies the configuration from RAM.
+      * @param  pData   : Buffer of the configuration
+      * @param  maxSize : Size of the buffer, the configuration is truncated if larger
+      * @param  pSize   : Size of the configuration, can be NULL
+      * @retval memory status, MEMORY_ERROR if there is no configuration
+      */
+    uint8_t load(uint8_t *pData, uint16_t maxSize, uint16_t *pSize = NULL);
+
+    /* Return the configuration in RAM and its size, 0 if there is none */
+    const uint8_t *data(void);
+    uint16_t size(void);
+
+  private:
+    /* Header of a version, followed by the configuration */
+    typedef struct {
+      uint32_t magic;
+      uint32_t seq;
+      uint16_t size;
+      uint16_t check;   /* ~size */
+      uint32_t crc;
+    } record_t;
+
+    MX25R6435FDevice &_device;
+    uint32_t _addr;
+    uint32_t _groupSize;
+    uint8_t _mounted;
+    uint8_t _group;       /* Group receiving the versions, 0xFF if none */
+    uint32_t _offset;     /* Offset of the next version in the group */
+    uint32_t _seq;        /* Sequence number of the last version */
+    uint16_t _size;
+    uint8_t _valid;       /* A configuration is loaded */
+    uint8_t _data[MX25R6435F_CONFIG_MAX_SIZE];
+    uint8_t _record[sizeof(record_t) + MX25R6435F_CONFIG_MAX_SIZE];
+
+    uint32_t groupAddr(uint8_t group);
+    uint32_t place(uint32_t offset, uint32_t len);
+    bool blank(uint32_t addr, uint32_t size);
+    uint8_t readRecord(uint8_t group, uint32_t offset, record_t *record);
+    uint8_t scan(uint8_t group);
+};
+
+#endif /* _MX25R6435F_CONFIG_H_ */
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FDevice.cpp
+  * @brief   RAM simulation of the MX25R6435F storage device
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FDevice.h"
+
+/* CRC-32 of the 16 values of a nibble */
+static const uint32_t crc32_nibble[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t memory_crc32(uint32_t crc, const uint8_t *pData, uint32_t size)
+{
+  crc = ~crc;
+
+  for (uint32_t i = 0; i < size; i++) {
+    crc ^= pData[i];
+    crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+    crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+  }
+
+  return ~crc;
+}
+
+MX25R6435FSimDevice::MX25R6435FSimDevice(uint8_t *mem, uint32_t size): reads(0), writes(0), erases(0),
+  _mem(mem), _size(size)
+{
+}
+
+uint8_t MX25R6435FSimDevice::read(uint8_t *pData, uint32_t addr, uint32_t size)
+{
+  if ((pData == NULL) || (addr > _size) || (size > (_size - addr))) {
+    return MEMORY_ERROR;
+  }
+
+  memcpy(pData, _mem + addr, size);
+  reads++;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FSimDevice::write(uint8_t *pData, uint32_t addr, uint32_t size)
+{
+  if ((pData == NULL) || (addr > _size) || (size > (_size - addr))) {
+    return MEMORY_ERROR;
+  }
+
+  /* Programming only clears bits */
+  for (uint32_t i = 0; i < size; i++) {
+    _mem[addr + i] &= pData[i];
+  }
+  writes++;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FSimDevice::eraseSector(uint32_t addr)
+{
+  addr -= addr % MX25R6435F_SECTOR_SIZE;
+
+  if ((addr >= _size) || (MX25R6435F_SECTOR_SIZE > (_size - addr))) {
+    return MEMORY_ERROR;
+  }
+
+  memset(_mem + addr, 0xFF, MX25R6435F_SECTOR_SIZE);
+  erases++;
+
+  return MEMORY_OK;
+}
+
+const uint8_t *MX25R6435FSimDevice::map(uint32_t addr, uint32_t size)
+{
+  if ((addr > _size) || (size > (_size - addr))) {
+    return NULL;
+  }
+
+  return _mem + addr;
+}
+
+uint32_t MX25R6435FSimDevice::length(void)
+{
+  return _size;
+}
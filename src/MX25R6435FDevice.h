@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FDevice.h
+  * @brief   Storage device interface of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_DEVICE_H_
+#define _MX25R6435F_DEVICE_H_
+
+/*
+ * This file does not depend on the STM32 core so that the classes built on
+ * MX25R6435FDevice can also be compiled and tested on a host computer,
+ * against MX25R6435FSimDevice.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include "mx25r6435f_desc.h"
+
+/* Memory Error codes (values of the QSPI_xxx codes of the driver) */
+#define MEMORY_OK             ((uint8_t)0x00)
+#define MEMORY_ERROR          ((uint8_t)0x01)
+#define MEMORY_BUSY           ((uint8_t)0x02)
+#define MEMORY_NOT_SUPPORTED  ((uint8_t)0x04)
+#define MEMORY_SUSPENDED      ((uint8_t)0x08)
+
+/* Completion callback of the asynchronous operations, called from interrupt */
+typedef void (*memory_callback_t)(uint8_t status, void *arg);
+
+/**
+  * @brief  Updates a CRC-32 (IEEE 802.3, as zlib) with an amount of data.
+  * @param  crc   : CRC of the previous data, 0 to start
+  * @param  pData : Pointer to the data
+  * @param  size  : Size of the data
+  * @retval CRC of the data
+  */
+uint32_t memory_crc32(uint32_t crc, const uint8_t *pData, uint32_t size);
+
+/*
+ * NOR flash seen by the upper layers: write() only clears bits, a sector
+ * must be erased to set them back to 1.
+ */
+class MX25R6435FDevice {
+  public:
+    /**
+      * @brief  Reads an amount of data from the device.
+      * @param  pData : Pointer to data to be read
+      * @param  addr  : Read start address
+      * @param  size  : Size of data to read
+      * @retval memory status
+      */
+    virtual uint8_t read(uint8_t *pData, uint32_t addr, uint32_t size) = 0;
+
+    /**
+      * @brief  Programs an amount of data to the device.
+      * @param  pData : Pointer to data to be written
+      * @param  addr  : Write start address
+      * @param  size  : Size of data to write
+      * @retval memory status
+      */
+    virtual uint8_t write(uint8_t *pData, uint32_t addr, uint32_t size) = 0;
+
+    /**
+      * @brief  Erases the sector (MX25R6435F_SECTOR_SIZE) containing an address.
+      * @param  addr : Address in the sector
+      * @retval memory status
+      */
+    virtual uint8_t eraseSector(uint32_t addr) = 0;
+
+    /**
+      * @brief  Programs the data still buffered by the device, if any.
+      * @retval memory status
+      */
+    virtual uint8_t sync(void)
+    {
+      return MEMORY_OK;
+    };
+
+    /* Return the total size of the device */
+    virtual uint32_t length(void) = 0;
+
+    /**
+      * @brief  Gives direct access to data of the device, without copy.
+      * @param  addr : Start address of the data
+      * @param  size : Size of the data
+      * @retval pointer to the data, valid until the next write or erase, or
+      *         NULL if the device cannot give access to them at the moment
+      */
+    virtual const uint8_t *map(uint32_t addr, uint32_t size)
+    {
+      (void)addr;
+      (void)size;
+      return NULL;
+    };
+
+    /**
+      * @brief  Check whether a sector must not be used anymore, a program or
+      *         an erase having failed in it.
+      * @param  addr : Address in the sector
+      * @retval true if the sector is retired
+      */
+    virtual bool isRetired(uint32_t addr)
+    {
+      (void)addr;
+      return false;
+    };
+};
+
+/*
+ * RAM simulation of a NOR flash, for the host tests of the classes built on
+ * MX25R6435FDevice. The buffer is given by the application.
+ */
+class MX25R6435FSimDevice : public MX25R6435FDevice {
+  public:
+    MX25R6435FSimDevice(uint8_t *mem, uint32_t size);
+
+    uint8_t read(uint8_t *pData, uint32_t addr, uint32_t size);
+    uint8_t write(uint8_t *pData, uint32_t addr, uint32_t size);
+    uint8_t eraseSector(uint32_t addr);
+    uint32_t length(void);
+    const uint8_t *map(uint32_t addr, uint32_t size);
+
+    /* Number of operations done since the creation of the device */
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erases;
+
+  private:
+    uint8_t *_mem;
+    uint32_t _size;
+};
+
+#endif /* _MX25R6435F_DEVICE_H_ */
@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FDigest.h
+  * @brief   CRC-32 and SHA-256 digests of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_DIGEST_H_
+#define _MX25R6435F_DIGEST_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Digest algorithms */
+#define MEMORY_DIGEST_CRC32     ((uint8_t)0x00) /* CRC-32 (IEEE 802.3), 4 bytes, most significant first */
+#define MEMORY_DIGEST_SHA256    ((uint8_t)0x01) /* SHA-256, 32 bytes */
+
+/* Size of the largest digest */
+#define MEMORY_DIGEST_MAX_SIZE  32
+
+/* Digest computation in progress */
+typedef struct {
+  uint8_t algo;
+  uint32_t crc;          /* CRC of the data, as returned by memory_crc32() */
+  uint32_t state[8];     /* SHA-256 hash values */
+  uint64_t length;       /* Size of the data */
+  uint8_t block[64];     /* SHA-256 data not yet processed */
+} memory_digest_t;
+
+/**
+  * @brief  Starts a digest computation.
+  * @param  ctx  : Computation context
+  * @param  algo : Algorithm, MEMORY_DIGEST_CRC32 or MEMORY_DIGEST_SHA256
+  * @retval memory status, MEMORY_NOT_SUPPORTED for an unknown algorithm
+  */
+uint8_t memory_digest_init(memory_digest_t *ctx, uint8_t algo);
+
+/**
+  * @brief  Adds data to a digest computation. The CRC-32 processes 8 bytes
+  *         per step (slicing-by-8).
+  * @param  ctx   : Computation context
+  * @param  pData : Pointer to the data
+  * @param  size  : Size of the data
+  */
+void memory_digest_update(memory_digest_t *ctx, const uint8_t *pData, uint32_t size);
+
+/**
+  * @brief  Ends a digest computation.
+  * @param  ctx     : Computation context
+  * @param  pDigest : Buffer of the digest, MEMORY_DIGEST_MAX_SIZE bytes
+  * @retval Size of the digest
+  */
+uint32_t memory_digest_final(memory_digest_t *ctx, uint8_t *pDigest);
+
+#endif /* _MX25R6435F_DIGEST_H_ */
@@ -0,0 +1,466 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FFtl.cpp
+  * @brief   Wear-leveling sector translation layer of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FFtl.h"
+
+#if MX25R6435F_FTL_SPARE_SECTORS < 1
+#error "MX25R6435F_FTL_SPARE_SECTORS must be at least 1"
+#endif
+
+#define FTL_MAGIC       0x314C5446 /* "FTL1" */
+#define FTL_NONE        0xFFFF     /* Unmapped logical sector or free physical sector */
+#define FTL_BANK_SIZE   (MX25R6435F_FTL_META_SECTORS * MX25R6435F_SECTOR_SIZE)
+
+MX25R6435FFtl::MX25R6435FFtl(MX25R6435FDevice &device, uint32_t addr, uint32_t size): _device(device),
+  _addr(addr - (addr % MX25R6435F_SECTOR_SIZE)), _physical(0), _logical(0), _mounted(0), _bank(0), _seq(0),
+  _journal(0), _writes(0)
+{
+  uint32_t total = size / MX25R6435F_SECTOR_SIZE;
+
+  /* The area starts with the 2 banks of the checkpoints */
+  if (total > (2 * MX25R6435F_FTL_META_SECTORS)) {
+    _physical = total - (2 * MX25R6435F_FTL_META_SECTORS);
+  }
+  if (_physical > MX25R6435F_FTL_MAX_SECTORS) {
+    _physical = MX25R6435F_FTL_MAX_SECTORS;
+  }
+  if (_physical > MX25R6435F_FTL_SPARE_SECTORS) {
+    _logical = _physical - MX25R6435F_FTL_SPARE_SECTORS;
+  }
+
+  memset(_erases, 0, sizeof(_erases));
+  memset(_heat, 0, sizeof(_heat));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t MX25R6435FFtl::bankAddr(uint8_t bank)
+{
+  return _addr + (bank * FTL_BANK_SIZE);
+}
+
+uint32_t MX25R6435FFtl::sectorAddr(uint16_t physical)
+{
+  return _addr + (2 * FTL_BANK_SIZE) + (physical * MX25R6435F_SECTOR_SIZE);
+}
+
+uint32_t MX25R6435FFtl::journalStart(void)
+{
+  uint32_t size = sizeof(header_t) + (_logical * sizeof(uint16_t)) + (_physical * sizeof(uint32_t));
+
+  /* Entries are aligned so that none straddles a page */
+  return (size + sizeof(entry_t) - 1) & ~(sizeof(entry_t) - 1);
+}
+
+uint8_t MX25R6435FFtl::begin(void)
+{
+  header_t header[2];
+  uint8_t first;
+
+  _mounted = 0;
+
+  if ((_logical == 0) || ((journalStart() + sizeof(entry_t)) > FTL_BANK_SIZE)) {
+    return MEMORY_ERROR;
+  }
+
+  if ((_device.read((uint8_t *)&header[0], bankAddr(0), sizeof(header_t)) != MEMORY_OK) ||
+      (_device.read((uint8_t *)&header[1], bankAddr(1), sizeof(header_t)) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  /* Load the most recent valid checkpoint */
+  first = ((header[1].magic == FTL_MAGIC) &&
+           ((header[0].magic != FTL_MAGIC) || ((int32_t)(header[1].seq - header[0].seq) > 0))) ? 1 : 0;
+
+  if ((loadCheckpoint(first, header[first].seq) != MEMORY_OK) &&
+      (loadCheckpoint(first ^ 1, header[first ^ 1].seq) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  memset(_heat, 0, sizeof(_heat));
+  _writes = 0;
+  _mounted = 1;
+
+  return replayJournal();
+}
+
+uint8_t MX25R6435FFtl::format(void)
+{
+  if ((_logical == 0) || ((journalStart() + sizeof(entry_t)) > FTL_BANK_SIZE)) {
+    return MEMORY_ERROR;
+  }
+
+  /* The erase counts of a mounted area are kept */
+  if (_mounted == 0) {
+    memset(_erases, 0, sizeof(_erases));
+  }
+
+  for (uint32_t i = 0; i < (2 * MX25R6435F_FTL_META_SECTORS); i++) {
+    if (_device.eraseSector(_addr + (i * MX25R6435F_SECTOR_SIZE)) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  memset(_map, 0xFF, sizeof(_map));
+  memset(_owner, 0xFF, sizeof(_owner));
+  memset(_heat, 0, sizeof(_heat));
+  _writes = 0;
+  _bank = 1;
+  _seq = 0;
+  _mounted = 1;
+
+  return writeCheckpoint();
+}
+
+uint8_t MX25R6435FFtl::loadCheckpoint(uint8_t bank, uint32_t seq)
+{
+  uint32_t addr = bankAddr(bank);
+  header_t header;
+  uint32_t crc;
+
+  if ((_device.read((uint8_t *)&header, addr, sizeof(header_t)) != MEMORY_OK) ||
+      (header.magic != FTL_MAGIC) || (header.seq != seq) ||
+      (header.physical != _physical) || (header.logical != _logical)) {
+    return MEMORY_ERROR;
+  }
+
+  addr += sizeof(header_t);
+  if ((_device.read((uint8_t *)_map, addr, _logical * sizeof(uint16_t)) != MEMORY_OK) ||
+      (_device.read((uint8_t *)_erases, addr + (_logical * sizeof(uint16_t)),
+                    _physical * sizeof(uint32_t)) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  crc = memory_crc32(0, (uint8_t *)&header, sizeof(header_t) - sizeof(uint32_t));
+  crc = memory_crc32(crc, (uint8_t *)_map, _logical * sizeof(uint16_t));
+  crc = memory_crc32(crc, (uint8_t *)_erases, _physical * sizeof(uint32_t));
+  if (crc != header.crc) {
+    return MEMORY_ERROR;
+  }
+
+  /* Rebuild the reverse map */
+  memset(_owner, 0xFF, sizeof(_owner));
+  for (uint32_t i = 0; i < _logical; i++) {
+    if (_map[i] < _physical) {
+      _owner[_map[i]] = i;
+    } else {
+      _map[i] = FTL_NONE;
+    }
+  }
+
+  _bank = bank;
+  _seq = seq;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FFtl::replayJournal(void)
+{
+  entry_t *entry = (entry_t *)_page;
+  uint32_t count = 0;
+
+  for (_journal = journalStart(); (_journal + sizeof(entry_t)) <= FTL_BANK_SIZE; _journal += sizeof(entry_t)) {
+    /* Read the entries one page at a time */
+    if (count == 0) {
+      count = MX25R6435F_PAGE_SIZE - (_journal % MX25R6435F_PAGE_SIZE);
+      if (count > (FTL_BANK_SIZE - _journal)) {
+        count = FTL_BANK_SIZE - _journal;
+      }
+      if (_device.read(_page, bankAddr(_bank) + _journal, count) != MEMORY_OK) {
+        return MEMORY_ERROR;
+      }
+      count /= sizeof(entry_t);
+      entry = (entry_t *)_page;
+    }
+
+    if ((entry->seq != _seq) || (entry->logical >= _logical) ||
+        ((entry->physical >= _physical) && (entry->physical != FTL_NONE)) ||
+        (memory_crc32(0, (uint8_t *)entry, sizeof(entry_t) - sizeof(uint32_t)) != entry->crc)) {
+      break;
+    }
+
+    if (entry->physical != FTL_NONE) {
+      _erases[entry->physical] = entry->erases;
+    }
+    remap(entry->logical, entry->physical);
+
+    entry++;
+    count--;
+  }
+
+  /* A torn entry can't be programmed again: start a new journal */
+  if ((_journal + sizeof(entry_t)) <= FTL_BANK_SIZE) {
+    for (uint32_t i = 0; i < sizeof(entry_t); i++) {
+      if (((uint8_t *)entry)[i] != 0xFF) {
+        return writeCheckpoint();
+      }
+    }
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FFtl::writeCheckpoint(void)
+{
+  uint8_t bank = _bank ^ 1;
+  uint32_t addr = bankAddr(bank);
+  header_t header;
+
+  for (uint32_t i = 0; i < MX25R6435F_FTL_META_SECTORS; i++) {
+    if (_device.eraseSector(addr + (i * MX25R6435F_SECTOR_SIZE)) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  header.magic    = FTL_MAGIC;
+  header.seq      = _seq + 1;
+  header.physical = _physical;
+  header.logical  = _logical;
+  header.crc      = memory_crc32(0, (uint8_t *)&header, sizeof(header_t) - sizeof(uint32_t));
+  header.crc      = memory_crc32(header.crc, (uint8_t *)_map, _logical * sizeof(uint16_t));
+  header.crc      = memory_crc32(header.crc, (uint8_t *)_erases, _physical * sizeof(uint32_t));
+
+  /* The header is programmed last: the checkpoint is valid once complete */
+  addr += sizeof(header_t);
+  if ((_device.write((uint8_t *)_map, addr, _logical * sizeof(uint16_t)) != MEMORY_OK) ||
+      (_device.write((uint8_t *)_erases, addr + (_logical * sizeof(uint16_t)),
+                     _physical * sizeof(uint32_t)) != MEMORY_OK) ||
+      (_device.write((uint8_t *)&header, bankAddr(bank), sizeof(header_t)) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  _bank = bank;
+  _seq++;
+  _journal = journalStart();
+  _stats.checkpoints++;
+  _stats.flashBytes += journalStart();
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FFtl::append(uint16_t logical, uint16_t physical)
+{
+  entry_t entry;
+  uint8_t status;
+
+  /* Journal full: the change is saved by a new checkpoint */
+  if ((_journal + sizeof(entry_t)) > FTL_BANK_SIZE) {
+    remap(logical, physical);
+    return writeCheckpoint();
+  }
+
+  entry.logical  = logical;
+  entry.physical = physical;
+  entry.erases   = (physical != FTL_NONE) ? _erases[physical] : 0;
+  entry.seq      = _seq;
+  entry.crc      = memory_crc32(0, (uint8_t *)&entry, sizeof(entry_t) - sizeof(uint32_t));
+
+  status = _device.write((uint8_t *)&entry, bankAddr(_bank) + _journal, sizeof(entry_t));
+  _journal += sizeof(entry_t);
+  _stats.flashBytes += sizeof(entry_t);
+
+  if (status == MEMORY_OK) {
+    remap(logical, physical);
+  }
+
+  return status;
+}
+
+uint16_t MX25R6435FFtl::allocate(bool hot)
+{
+  uint16_t found = FTL_NONE;
+
+  /* Hot data go to the least erased free sector, cold data to the most erased
+     one. The sectors retired by the device are never used again. */
+  for (uint16_t i = 0; i < _physical; i++) {
+    if ((_owner[i] == FTL_NONE) &&
+        ((found == FTL_NONE) || (hot && (_erases[i] < _erases[found])) || (!hot && (_erases[i] > _erases[found]))) &&
+        !_device.isRetired(sectorAddr(i))) {
+      found = i;
+    }
+  }
+
+  return found;
+}
+
+void MX25R6435FFtl::remap(uint16_t logical, uint16_t physical)
+{
+  if (_map[logical] != FTL_NONE) {
+    _owner[_map[logical]] = FTL_NONE;
+  }
+
+  _map[logical] = physical;
+  if (physical != FTL_NONE) {
+    _owner[physical] = logical;
+  }
+}
+
+uint8_t MX25R6435FFtl::move(void)
+{
+  uint16_t young = FTL_NONE;
+  uint16_t target;
+  uint32_t oldest = 0;
+
+  /* Least erased sector holding data, and highest erase count of the sectors
+     still in use */
+  for (uint16_t i = 0; i < _physical; i++) {
+    if ((_owner[i] != FTL_NONE) && ((young == FTL_NONE) || (_erases[i] < _erases[young]))) {
+      young = i;
+    }
+    if ((_erases[i] > oldest) && !_device.isRetired(sectorAddr(i))) {
+      oldest = _erases[i];
+    }
+  }
+
+  if ((young == FTL_NONE) || ((oldest - _erases[young]) <= MX25R6435F_FTL_WEAR_THRESHOLD)) {
+    return MEMORY_OK;
+  }
+
+  /* Move the cold data to the most erased free sector, releasing the young one */
+  target = allocate(false);
+  if ((target == FTL_NONE) || (_erases[target] <= _erases[young])) {
+    return MEMORY_OK;
+  }
+
+  _erases[target]++;
+  if (_device.eraseSector(sectorAddr(target)) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  for (uint32_t offset = 0; offset < MX25R6435F_SECTOR_SIZE; offset += MX25R6435F_PAGE_SIZE) {
+    if ((_device.read(_page, sectorAddr(young) + offset, MX25R6435F_PAGE_SIZE) != MEMORY_OK) ||
+        (_device.write(_page, sectorAddr(target) + offset, MX25R6435F_PAGE_SIZE) != MEMORY_OK)) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  _stats.moves++;
+  _stats.flashBytes += MX25R6435F_SECTOR_SIZE;
+
+  return append(_owner[young], target);
+}
+
+uint8_t MX25R6435FFtl::readSector(uint32_t sector, uint8_t *pData)
+{
+  if ((_mounted == 0) || (sector >= _logical) || (pData == NULL)) {
+    return MEMORY_ERROR;
+  }
+
+  if (_map[sector] == FTL_NONE) {
+    memset(pData, 0xFF, MX25R6435F_SECTOR_SIZE);
+    return MEMORY_OK;
+  }
+
+  return _device.read(pData, sectorAddr(_map[sector]), MX25R6435F_SECTOR_SIZE);
+}
+
+uint8_t MX25R6435FFtl::writeSector(uint32_t sector, uint8_t *pData)
+{
+  uint16_t target;
+  uint8_t status;
+
+  if ((_mounted == 0) || (sector >= _logical) || (pData == NULL)) {
+    return MEMORY_ERROR;
+  }
+
+  /* A sector written again recently is hot. The heat decays by half after
+     as many writes as logical sectors. */
+  if (_heat[sector] < 0xFF) {
+    _heat[sector]++;
+  }
+  if (++_writes >= _logical) {
+    _writes = 0;
+    for (uint32_t i = 0; i < _logical; i++) {
+      _heat[i] >>= 1;
+    }
+  }
+
+  target = allocate(_heat[sector] > 1);
+  if (target == FTL_NONE) {
+    return MEMORY_ERROR;
+  }
+
+  /* The previous data stay mapped until the journal entry is programmed */
+  _erases[target]++;
+  status = _device.eraseSector(sectorAddr(target));
+  if (status == MEMORY_OK) {
+    status = _device.write(pData, sectorAddr(target), MX25R6435F_SECTOR_SIZE);
+  }
+  if (status == MEMORY_OK) {
+    status = append(sector, target);
+  }
+
+  _stats.hostBytes += MX25R6435F_SECTOR_SIZE;
+  _stats.flashBytes += MX25R6435F_SECTOR_SIZE;
+
+  if (status != MEMORY_OK) {
+    return status;
+  }
+
+  return move();
+}
+
+uint8_t MX25R6435FFtl::trimSector(uint32_t sector)
+{
+  if ((_mounted == 0) || (sector >= _logical)) {
+    return MEMORY_ERROR;
+  }
+
+  if (_map[sector] == FTL_NONE) {
+    return MEMORY_OK;
+  }
+
+  return append(sector, FTL_NONE);
+}
+
+uint32_t MX25R6435FFtl::sectors(void)
+{
+  return _logical;
+}
+
+uint8_t MX25R6435FFtl::checkpoint(void)
+{
+  if (_mounted == 0) {
+    return MEMORY_ERROR;
+  }
+
+  return writeCheckpoint();
+}
+
+void MX25R6435FFtl::stats(memory_ftl_stats_t *stats)
+{
+  if (stats == NULL) {
+    return;
+  }
+
+  _stats.minErase = (_physical > 0) ? _erases[0] : 0;
+  _stats.maxErase = _stats.minErase;
+  for (uint32_t i = 1; i < _physical; i++) {
+    if (_erases[i] < _stats.minErase) {
+      _stats.minErase = _erases[i];
+    }
+    if (_erases[i] > _stats.maxErase) {
+      _stats.maxErase = _erases[i];
+    }
+  }
+
+  _stats.writeAmplification = (_stats.hostBytes > 0) ? (uint32_t)((_stats.flashBytes * 100) / _stats.hostBytes) : 0;
+
+  *stats = _stats;
+}
@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FFtl.h
+  * @brief   Wear-leveling sector translation layer of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_FTL_H_
+#define _MX25R6435F_FTL_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Maximum number of data sectors managed, sizes the RAM tables */
+#ifndef MX25R6435F_FTL_MAX_SECTORS
+#define MX25R6435F_FTL_MAX_SECTORS    256
+#endif
+
+/* Sectors of each of the 2 banks holding the checkpoint and the journal */
+#ifndef MX25R6435F_FTL_META_SECTORS
+#define MX25R6435F_FTL_META_SECTORS   2
+#endif
+
+/* Data sectors kept free, not available as logical sectors */
+#ifndef MX25R6435F_FTL_SPARE_SECTORS
+#define MX25R6435F_FTL_SPARE_SECTORS  4
+#endif
+
+/* Erase count difference starting the move of cold data (static wear leveling) */
+#ifndef MX25R6435F_FTL_WEAR_THRESHOLD
+#define MX25R6435F_FTL_WEAR_THRESHOLD 32
+#endif
+
+/* Wear-leveling counters */
+typedef struct {
+  uint64_t hostBytes;          /* Bytes written by the application */
+  uint64_t flashBytes;         /* Bytes programmed: data, moves, journal and checkpoints */
+  uint32_t moves;              /* Sectors moved by the static wear leveling */
+  uint32_t checkpoints;        /* Checkpoints written */
+  uint32_t minErase;           /* Lowest erase count of the data sectors */
+  uint32_t maxErase;           /* Highest erase count of the data sectors */
+  uint32_t writeAmplification; /* flashBytes / hostBytes, in percent */
+} memory_ftl_stats_t;
+
+/*
+ * Logical sectors of MX25R6435F_SECTOR_SIZE bytes mapped on the sectors of an
+ * area of a MX25R6435FDevice. Each write goes to a free sector: the least
+ * erased one for hot data, the most erased one for cold data. The cold data
+ * staying on little erased sectors are moved when the erase counts drift
+ * apart. The sectors retired by the device are never written again, the
+ * spare sectors replace them. The map lives in RAM; its changes are appended to a journal and the
+ * whole map is saved in a checkpoint when the journal is full, so mounting
+ * reads one checkpoint and one journal whatever the size of the area.
+ */
+class MX25R6435FFtl {
+  public:
+    /**
+      * @brief  Constructor.
+      * @param  device : Device holding the area
+      * @param  addr   : Start address of the area, aligned on a sector
+      * @param  size   : Size of the area, multiple of the sector size
+      */
+    MX25R6435FFtl(MX25R6435FDevice &device, uint32_t addr, uint32_t size);
+
+    /**
+      * @brief  Mounts the area: loads the last checkpoint and its journal.
+      * @retval memory status, MEMORY_ERROR if the area is not formatted
+      */
+    uint8_t begin(void);
+
+    /**
+      * @brief  Formats the area: all the logical sectors are erased.
+      * @retval memory status
+      */
+    uint8_t format(void);
+
+    /**
+      * @brief  Reads a logical sector. A sector never written reads as 0xFF.
+      * @param  sector : Logical sector number
+      * @param  pData  : Buffer of MX25R6435F_SECTOR_SIZE bytes
+      * @retval memory status
+      */
+    uint8_t readSector(uint32_t sector, uint8_t *pData);
+
+    /**
+      * @brief  Writes a logical sector.
+      * @param  sector : Logical sector number
+      * @param  pData  : Data of MX25R6435F_SECTOR_SIZE bytes
+      * @retval memory status
+      */
+    uint8_t writeSector(uint32_t sector, uint8_t *pData);
+
+    /**
+      * @brief  Releases a logical sector, read as 0xFF afterwards.
+      * @param  sector : Logical sector number
+      * @retval memory status
+      */
+    uint8_t trimSector(uint32_t sector);
+
+    /* Return the number of logical sectors */
+    uint32_t sectors(void);
+
+    /* Saves the map in a new checkpoint, emptying the journal */
+    uint8_t checkpoint(void);
+
+    /* Copy the wear-leveling counters */
+    void stats(memory_ftl_stats_t *stats);
+
+  private:
+    /* Journal entry, the last change of the map */
+    typedef struct {
+      uint16_t logical;
+      uint16_t physical;
+      uint32_t erases;
+      uint32_t seq;
+      uint32_t crc;
+    } entry_t;
+
+    /* Checkpoint header, followed by the map and the erase counts */
+    typedef struct {
+      uint32_t magic;
+      uint32_t seq;
+      uint16_t physical;
+      uint16_t logical;
+      uint32_t crc;
+    } header_t;
+
+    MX25R6435FDevice &_device;
+    uint32_t _addr;
+    uint32_t _physical;   /* Data sectors */
+    uint32_t _logical;    /* Logical sectors */
+    uint8_t _mounted;
+    uint8_t _bank;        /* Bank of the current checkpoint */
+    uint32_t _seq;        /* Sequence number of the current checkpoint */
+    uint32_t _journal;    /* Offset of the next journal entry in the bank */
+    uint32_t _writes;     /* Writes since the last heat decay */
+
+    uint16_t _map[MX25R6435F_FTL_MAX_SECTORS];    /* Physical sector of each logical one */
+    uint16_t _owner[MX25R6435F_FTL_MAX_SECTORS];  /* Logical sector of each physical one */
+    uint32_t _erases[MX25R6435F_FTL_MAX_SECTORS]; /* Erase count of each physical sector */
+    uint8_t _heat[MX25R6435F_FTL_MAX_SECTORS];    /* Recent writes of each logical sector */
+    uint8_t _page[MX25R6435F_PAGE_SIZE];
+    memory_ftl_stats_t _stats;
+
+    uint32_t bankAddr(uint8_t bank);
+    uint32_t sectorAddr(uint16_t physical);
+    uint32_t journalStart(void);
+    uint8_t loadCheckpoint(uint8_t bank, uint32_t seq);
+    uint8_t replayJournal(void);
+    uint8_t writeCheckpoint(void);
+    uint8_t append(uint16_t logical, uint16_t physical);
+    uint16_t allocate(bool hot);
+    void remap(uint16_t logical, uint16_t physical);
+    uint8_t move(void);
+};
+
+#endif /* _MX25R6435F_FTL_H_ */
@@ -0,0 +1,684 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FKvStore.cpp
+  * @brief   Log-structured key-value store of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FKvStore.h"
+#ifdef ARDUINO
+#include "Arduino.h"
+#endif
+
+#if (MX25R6435F_KV_MAX_KEYS & (MX25R6435F_KV_MAX_KEYS - 1)) != 0
+#error "MX25R6435F_KV_MAX_KEYS must be a power of 2"
+#endif
+
+#if MX25R6435F_KV_GC_FREE < 1
+#error "MX25R6435F_KV_GC_FREE must be at least 1"
+#endif
+
+#if (MX25R6435F_KV_MAX_VALUE + 64) > MX25R6435F_SECTOR_SIZE
+#error "MX25R6435F_KV_MAX_VALUE does not fit in a sector"
+#endif
+
+#define KV_MAGIC        0x3153564B /* "KVS1" */
+#define KV_DATA         0xDA7A     /* Record holding a value */
+#define KV_DELETE       0xDE1E     /* Record removing a key */
+#define KV_NONE         0xFFFFFFFF /* Empty slot of the index */
+#define KV_ENTRY_SIZE   6          /* Key and offset of a record in a sector index */
+#define KV_REMOVED      0x8000     /* Offset flag of the removal records in a sector index */
+#define KV_KEYS_LIMIT   ((MX25R6435F_KV_MAX_KEYS / 4) * 3)
+#define KV_MASK         (MX25R6435F_KV_MAX_KEYS - 1)
+
+/* Size of a record in the log, aligned on 4 bytes */
+#define KV_LENGTH(size) ((sizeof(record_t) + (size) + 3) & ~3UL)
+
+/* The last record of a sector closed with its index ends at the index */
+#if MX25R6435F_KV_INDEX_PAGES
+#define KV_RECORDS_END  (MX25R6435F_SECTOR_SIZE - sizeof(trailer_t))
+#else
+#define KV_RECORDS_END  MX25R6435F_SECTOR_SIZE
+#endif
+
+static uint32_t kvHash(uint32_t key)
+{
+  return ((key * 2654435761UL) >> 16) & KV_MASK;
+}
+
+MX25R6435FKvStore::MX25R6435FKvStore(MX25R6435FDevice &device, uint32_t addr, uint32_t size): _device(device),
+  _addr(addr - (addr % MX25R6435F_SECTOR_SIZE)), _sectors(size / MX25R6435F_SECTOR_SIZE), _mounted(0), _seq(0),
+  _head(0), _headOffset(0), _headCount(0), _tail(0), _used(0), _gcOffset(0), _gcLimit(0),
+#ifdef ARDUINO
+  _clock(micros),
+#else
+  _clock(NULL),
+#endif
+  _count(0)
+{
+  memset(_keys, 0xFF, sizeof(_keys));
+}
+
+uint32_t MX25R6435FKvStore::sectorAddr(uint32_t sector)
+{
+  return _addr + (sector * MX25R6435F_SECTOR_SIZE);
+}
+
+uint32_t MX25R6435FKvStore::find(uint32_t key)
+{
+  uint32_t i = kvHash(key);
+
+  /* Linear probing, the table is never full */
+  while ((_keys[i] != KV_NONE) && (_keys[i] != key)) {
+    i = (i + 1) & KV_MASK;
+  }
+
+  return i;
+}
+
+uint8_t MX25R6435FKvStore::indexSet(uint32_t key, uint32_t loc)
+{
+  uint32_t i = find(key);
+
+  if (_keys[i] == KV_NONE) {
+    if (_count >= KV_KEYS_LIMIT) {
+      return MEMORY_ERROR;
+    }
+    _keys[i] = key;
+    _count++;
+  }
+  _locs[i] = loc;
+
+  return MEMORY_OK;
+}
+
+void MX25R6435FKvStore::indexRemove(uint32_t key)
+{
+  uint32_t i = find(key);
+  uint32_t j = i;
+
+  if (_keys[i] == KV_NONE) {
+    return;
+  }
+
+  /* Shift back the following keys which would not be found past the hole */
+  for (;;) {
+    uint32_t home;
+
+    j = (j + 1) & KV_MASK;
+    if (_keys[j] == KV_NONE) {
+      break;
+    }
+
+    home = kvHash(_keys[j]);
+    if (((j > i) && ((home <= i) || (home > j))) || ((j < i) && (home <= i) && (home > j))) {
+      _keys[i] = _keys[j];
+      _locs[i] = _locs[j];
+      i = j;
+    }
+  }
+
+  _keys[i] = KV_NONE;
+  _count--;
+}
+
+bool MX25R6435FKvStore::blank(uint32_t addr, uint32_t size)
+{
+  while (size > 0) {
+    uint32_t chunk = (size < MX25R6435F_PAGE_SIZE) ? size : MX25R6435F_PAGE_SIZE;
+
+    if (_device.read(_page, addr, chunk) != MEMORY_OK) {
+      return false;
+    }
+    for (uint32_t i = 0; i < chunk; i++) {
+      if (_page[i] != 0xFF) {
+        return false;
+      }
+    }
+    addr += chunk;
+    size -= chunk;
+  }
+
+  return true;
+}
+
+uint8_t MX25R6435FKvStore::readRecord(uint32_t addr, uint32_t limit, record_t *record)
+{
+  uint32_t crc;
+
+  if (((addr + sizeof(record_t)) > limit) ||
+      (_device.read((uint8_t *)record, addr, sizeof(record_t)) != MEMORY_OK) ||
+      (record->key == KV_NONE) || ((record->type != KV_DATA) && (record->type != KV_DELETE)) ||
+      (record->size > MX25R6435F_KV_MAX_VALUE) || ((addr + KV_LENGTH(record->size)) > limit)) {
+    return MEMORY_ERROR;
+  }
+
+  crc = memory_crc32(0, (uint8_t *)record, sizeof(record_t) - sizeof(uint32_t));
+  for (uint32_t done = 0; done < record->size;) {
+    uint32_t chunk = record->size - done;
+
+    if (chunk > MX25R6435F_PAGE_SIZE) {
+      chunk = MX25R6435F_PAGE_SIZE;
+    }
+    if (_device.read(_page, addr + sizeof(record_t) + done, chunk) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+    crc = memory_crc32(crc, _page, chunk);
+    done += chunk;
+  }
+
+  return (crc == record->crc) ? MEMORY_OK : MEMORY_ERROR;
+}
+
+uint8_t MX25R6435FKvStore::readTrailer(uint32_t sector, trailer_t *trailer)
+{
+  uint32_t base = sectorAddr(sector);
+  uint32_t size;
+  uint32_t crc = 0;
+
+  if ((_device.read((uint8_t *)trailer, base + KV_RECORDS_END, sizeof(trailer_t)) != MEMORY_OK) ||
+      (trailer->offset < sizeof(sector_t)) ||
+      ((uint32_t)(trailer->offset + (trailer->count * KV_ENTRY_SIZE)) > KV_RECORDS_END)) {
+    return MEMORY_ERROR;
+  }
+
+  size = trailer->count * KV_ENTRY_SIZE;
+  for (uint32_t done = 0; done < size;) {
+    uint32_t chunk = ((size - done) < MX25R6435F_PAGE_SIZE) ? (size - done) : MX25R6435F_PAGE_SIZE;
+
+    if (_device.read(_page, base + trailer->offset + done, chunk) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+    crc = memory_crc32(crc, _page, chunk);
+    done += chunk;
+  }
+  crc = memory_crc32(crc, (uint8_t *)trailer, sizeof(trailer_t) - sizeof(uint32_t));
+
+  return (crc == trailer->crc) ? MEMORY_OK : MEMORY_ERROR;
+}
+
+uint8_t MX25R6435FKvStore::loadSector(uint32_t sector, bool head)
+{
+  uint32_t base = sectorAddr(sector);
+  uint32_t offset = sizeof(sector_t);
+  uint32_t count = 0;
+  record_t record;
+
+#if MX25R6435F_KV_INDEX_PAGES
+  trailer_t trailer;
+
+  /* A closed sector is loaded from its index, without reading the records */
+  if (!head && (readTrailer(sector, &trailer) == MEMORY_OK)) {
+    const uint32_t chunkEntries = MX25R6435F_PAGE_SIZE / KV_ENTRY_SIZE;
+
+    for (uint32_t done = 0; done < trailer.count;) {
+      uint32_t entries = ((trailer.count - done) < chunkEntries) ? (trailer.count - done) : chunkEntries;
+
+      if (_device.read(_page, base + trailer.offset + (done * KV_ENTRY_SIZE), entries * KV_ENTRY_SIZE) != MEMORY_OK) {
+        return MEMORY_ERROR;
+      }
+      for (uint32_t i = 0; i < entries; i++) {
+        uint32_t key;
+        uint16_t loc;
+
+        memcpy(&key, &_page[i * KV_ENTRY_SIZE], sizeof(key));
+        memcpy(&loc, &_page[(i * KV_ENTRY_SIZE) + sizeof(key)], sizeof(loc));
+        if ((loc & KV_REMOVED) != 0) {
+          indexRemove(key);
+        } else if (indexSet(key, base + loc) != MEMORY_OK) {
+          return MEMORY_ERROR;
+        }
+      }
+      done += entries;
+    }
+    return MEMORY_OK;
+  }
+#endif
+
+  /* Otherwise the records are read up to the first invalid one */
+  while (readRecord(base + offset, base + KV_RECORDS_END, &record) == MEMORY_OK) {
+    if (record.type == KV_DELETE) {
+      indexRemove(record.key);
+    } else if (indexSet(record.key, base + offset) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+    offset += KV_LENGTH(record.size);
+    count++;
+  }
+
+  if (head) {
+    _headOffset = offset;
+    _headCount = count;
+    /* Nothing is appended after a record torn by a power loss */
+    if (!blank(base + offset, MX25R6435F_SECTOR_SIZE - offset)) {
+      _headOffset = MX25R6435F_SECTOR_SIZE;
+    }
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::begin(void)
+{
+  sector_t header;
+  uint32_t valid = 0;
+  uint32_t first = 0;
+  uint32_t last = 0;
+
+  _mounted = 0;
+  memset(_keys, 0xFF, sizeof(_keys));
+  _count = 0;
+
+  if (_sectors < 3) {
+    return MEMORY_ERROR;
+  }
+
+  /* The log goes from the oldest sector to the newest one */
+  for (uint32_t i = 0; i < _sectors; i++) {
+    if ((_device.read((uint8_t *)&header, sectorAddr(i), sizeof(sector_t)) != MEMORY_OK) ||
+        (header.magic != KV_MAGIC) ||
+        (header.crc != memory_crc32(0, (uint8_t *)&header, sizeof(sector_t) - sizeof(uint32_t)))) {
+      continue;
+    }
+    if ((valid == 0) || ((int32_t)(header.seq - first) < 0)) {
+      first = header.seq;
+      _tail = i;
+    }
+    if ((valid == 0) || ((int32_t)(header.seq - last) > 0)) {
+      last = header.seq;
+      _head = i;
+    }
+    valid++;
+  }
+
+  if (valid == 0) {
+    return MEMORY_ERROR;
+  }
+
+  _seq = last;
+  _used = ((_head + _sectors - _tail) % _sectors) + 1;
+  _gcOffset = 0;
+
+  for (uint32_t i = 0; i < _used; i++) {
+    if (loadSector((_tail + i) % _sectors, (i + 1) == _used) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  _mounted = 1;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::format(void)
+{
+  _mounted = 0;
+
+  if (_sectors < 3) {
+    return MEMORY_ERROR;
+  }
+
+  for (uint32_t i = 0; i < _sectors; i++) {
+    if (_device.eraseSector(sectorAddr(i)) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  memset(_keys, 0xFF, sizeof(_keys));
+  _count = 0;
+  _seq = 0;
+  _tail = 0;
+  _used = 0;
+  _gcOffset = 0;
+
+  if (openSector(0) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  _mounted = 1;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::openSector(uint32_t sector)
+{
+  uint32_t addr = sectorAddr(sector);
+  sector_t header;
+
+  if (!blank(addr, MX25R6435F_SECTOR_SIZE) && (_device.eraseSector(addr) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  header.magic = KV_MAGIC;
+  header.seq = _seq + 1;
+  header.crc = memory_crc32(0, (uint8_t *)&header, sizeof(sector_t) - sizeof(uint32_t));
+
+  if (_device.write((uint8_t *)&header, addr, sizeof(sector_t)) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  _seq++;
+  _head = sector;
+  _headOffset = sizeof(sector_t);
+  _headCount = 0;
+  _used++;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::closeHead(void)
+{
+#if MX25R6435F_KV_INDEX_PAGES
+  uint32_t base = sectorAddr(_head);
+  uint32_t offset = sizeof(sector_t);
+  uint32_t out = base + _headOffset;
+  uint32_t pos = 0;
+  uint32_t crc = 0;
+  trailer_t trailer;
+  record_t record;
+
+  /* No index after a torn record */
+  if ((_headOffset + (_headCount * KV_ENTRY_SIZE)) > KV_RECORDS_END) {
+    return MEMORY_OK;
+  }
+
+  for (uint32_t i = 0; i < _headCount; i++) {
+    uint16_t loc = offset;
+
+    if (_device.read((uint8_t *)&record, base + offset, sizeof(record_t)) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+    if (record.type == KV_DELETE) {
+      loc |= KV_REMOVED;
+    }
+    memcpy(&_page[pos], &record.key, sizeof(record.key));
+    memcpy(&_page[pos + sizeof(record.key)], &loc, sizeof(loc));
+    pos += KV_ENTRY_SIZE;
+    offset += KV_LENGTH(record.size);
+
+    if (((pos + KV_ENTRY_SIZE) > MX25R6435F_PAGE_SIZE) || ((i + 1) == _headCount)) {
+      if (_device.write(_page, out, pos) != MEMORY_OK) {
+        return MEMORY_ERROR;
+      }
+      crc = memory_crc32(crc, _page, pos);
+      out += pos;
+      pos = 0;
+    }
+  }
+
+  trailer.count = _headCount;
+  trailer.offset = _headOffset;
+  trailer.crc = memory_crc32(crc, (uint8_t *)&trailer, sizeof(trailer_t) - sizeof(uint32_t));
+
+  return _device.write((uint8_t *)&trailer, base + KV_RECORDS_END, sizeof(trailer_t));
+#else
+  return MEMORY_OK;
+#endif
+}
+
+bool MX25R6435FKvStore::fits(uint32_t size)
+{
+#if MX25R6435F_KV_INDEX_PAGES
+  /* Room is kept for the index of the sector */
+  size += (_headCount + 1) * KV_ENTRY_SIZE;
+#endif
+
+  return (_headOffset + size) <= KV_RECORDS_END;
+}
+
+uint8_t MX25R6435FKvStore::reserve(uint32_t size, bool user, uint32_t *pAddr)
+{
+  uint32_t steps = 0;
+
+  /* The last free sector is kept for the copies of the garbage collection.
+     Once it is used, the sector being reclaimed must be erased before the
+     application appends again, else the copies might not fit. */
+  while (user && ((freeSectors() == 0) || (!fits(size) && (freeSectors() < 2)))) {
+    if ((steps++ > (_sectors * (MX25R6435F_SECTOR_SIZE / sizeof(record_t)))) || (gcStep() != MEMORY_OK)) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  if (!fits(size)) {
+    if ((freeSectors() == 0) || (closeHead() != MEMORY_OK) ||
+        (openSector((_head + 1) % _sectors) != MEMORY_OK)) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  *pAddr = sectorAddr(_head) + _headOffset;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::append(uint32_t key, uint16_t type, uint8_t *pData, uint16_t size, uint32_t *pAddr)
+{
+  uint32_t len = KV_LENGTH(size);
+  record_t record;
+
+  record.key = key;
+  record.size = size;
+  record.type = type;
+  record.crc = memory_crc32(memory_crc32(0, (uint8_t *)&record, sizeof(record_t) - sizeof(uint32_t)), pData, size);
+
+  if (reserve(len, true, pAddr) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  /* A small record is programmed at once */
+  if ((sizeof(record_t) + size) <= MX25R6435F_PAGE_SIZE) {
+    memcpy(_page, &record, sizeof(record_t));
+    if (size > 0) {
+      memcpy(_page + sizeof(record_t), pData, size);
+    }
+    if (_device.write(_page, *pAddr, sizeof(record_t) + size) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  } else if ((_device.write((uint8_t *)&record, *pAddr, sizeof(record_t)) != MEMORY_OK) ||
+             (_device.write(pData, *pAddr + sizeof(record_t), size) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  _headOffset += len;
+  _headCount++;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::set(uint32_t key, uint8_t *pData, uint16_t size)
+{
+  uint32_t addr;
+
+  if ((_mounted == 0) || (key == KV_NONE) || (size > MX25R6435F_KV_MAX_VALUE) ||
+      ((pData == NULL) && (size != 0))) {
+    return MEMORY_ERROR;
+  }
+
+  if (!exists(key) && (_count >= KV_KEYS_LIMIT)) {
+    return MEMORY_ERROR;
+  }
+
+  if (append(key, KV_DATA, pData, size, &addr) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  return indexSet(key, addr);
+}
+
+uint8_t MX25R6435FKvStore::get(uint32_t key, uint8_t *pData, uint16_t maxSize, uint16_t *pSize)
+{
+  uint32_t i = find(key);
+  uint32_t loc = _locs[i];
+  uint32_t crc;
+  uint16_t size;
+  record_t record;
+
+  if ((_mounted == 0) || (_keys[i] == KV_NONE) || ((pData == NULL) && (maxSize != 0)) ||
+      (_device.read((uint8_t *)&record, loc, sizeof(record_t)) != MEMORY_OK) || (record.key != key)) {
+    return MEMORY_ERROR;
+  }
+
+  size = (record.size < maxSize) ? record.size : maxSize;
+  if (_device.read(pData, loc + sizeof(record_t), size) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  /* The CRC covers the part of the value not copied as well */
+  crc = memory_crc32(memory_crc32(0, (uint8_t *)&record, sizeof(record_t) - sizeof(uint32_t)), pData, size);
+  for (uint32_t done = size; done < record.size;) {
+    uint32_t chunk = ((record.size - done) < MX25R6435F_PAGE_SIZE) ? (record.size - done) : MX25R6435F_PAGE_SIZE;
+
+    if (_device.read(_page, loc + sizeof(record_t) + done, chunk) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+    crc = memory_crc32(crc, _page, chunk);
+    done += chunk;
+  }
+
+  if (crc != record.crc) {
+    return MEMORY_ERROR;
+  }
+
+  if (pSize != NULL) {
+    *pSize = record.size;
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::remove(uint32_t key)
+{
+  uint32_t addr;
+
+  if (_mounted == 0) {
+    return MEMORY_ERROR;
+  }
+
+  if (!exists(key)) {
+    return MEMORY_OK;
+  }
+
+  if (append(key, KV_DELETE, NULL, 0, &addr) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  indexRemove(key);
+
+  return MEMORY_OK;
+}
+
+bool MX25R6435FKvStore::exists(uint32_t key)
+{
+  return (key != KV_NONE) && (_keys[find(key)] == key);
+}
+
+uint32_t MX25R6435FKvStore::count(void)
+{
+  return _count;
+}
+
+uint32_t MX25R6435FKvStore::freeSectors(void)
+{
+  return _sectors - _used;
+}
+
+uint8_t MX25R6435FKvStore::gcStep(void)
+{
+  uint32_t base = sectorAddr(_tail);
+  record_t record;
+
+  if (_used < 2) {
+    return MEMORY_OK;
+  }
+
+  if (_gcOffset == 0) {
+    _gcOffset = sizeof(sector_t);
+    _gcLimit = KV_RECORDS_END;
+#if MX25R6435F_KV_INDEX_PAGES
+    trailer_t trailer;
+
+    if (readTrailer(_tail, &trailer) == MEMORY_OK) {
+      _gcLimit = trailer.offset;
+    }
+#endif
+  }
+
+  /* Copy the next record of the oldest sector if it is the last one of its
+     key. Removal records are dropped: the older records of their key are all
+     in this sector. */
+  if (readRecord(base + _gcOffset, base + _gcLimit, &record) == MEMORY_OK) {
+    uint32_t len = KV_LENGTH(record.size);
+    uint32_t i = find(record.key);
+    uint32_t addr;
+
+    if ((record.type == KV_DATA) && (_keys[i] == record.key) && (_locs[i] == (base + _gcOffset))) {
+      if (reserve(len, false, &addr) != MEMORY_OK) {
+        return MEMORY_ERROR;
+      }
+      for (uint32_t done = 0; done < len;) {
+        uint32_t chunk = ((len - done) < MX25R6435F_PAGE_SIZE) ? (len - done) : MX25R6435F_PAGE_SIZE;
+
+        if ((_device.read(_page, base + _gcOffset + done, chunk) != MEMORY_OK) ||
+            (_device.write(_page, addr + done, chunk) != MEMORY_OK)) {
+          return MEMORY_ERROR;
+        }
+        done += chunk;
+      }
+      _locs[i] = addr;
+      _headOffset += len;
+      _headCount++;
+    }
+
+    _gcOffset += len;
+    return MEMORY_OK;
+  }
+
+  /* The sector holds no more live record */
+  if (_device.eraseSector(base) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  _tail = (_tail + 1) % _sectors;
+  _used--;
+  _gcOffset = 0;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FKvStore::gc(uint32_t budget)
+{
+  uint32_t start = (_clock != NULL) ? _clock() : 0;
+
+  if (_mounted == 0) {
+    return MEMORY_ERROR;
+  }
+
+  do {
+    if (freeSectors() >= MX25R6435F_KV_GC_FREE) {
+      break;
+    }
+    if (gcStep() != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+  } while ((_clock != NULL) && ((_clock() - start) < budget));
+
+  return MEMORY_OK;
+}
+
+void MX25R6435FKvStore::setClock(uint32_t (*clock)(void))
+{
+  _clock = clock;
+}
@@ -0,0 +1,183 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FKvStore.h
+  * @brief   Log-structured key-value store of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_KVSTORE_H_
+#define _MX25R6435F_KVSTORE_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Size of the RAM index, power of 2. 3/4 of it can be used by keys. */
+#ifndef MX25R6435F_KV_MAX_KEYS
+#define MX25R6435F_KV_MAX_KEYS        1024
+#endif
+
+/* Maximum size of a value */
+#ifndef MX25R6435F_KV_MAX_VALUE
+#define MX25R6435F_KV_MAX_VALUE       512
+#endif
+
+/* Free sectors below which gc() reclaims the oldest sector */
+#ifndef MX25R6435F_KV_GC_FREE
+#define MX25R6435F_KV_GC_FREE         2
+#endif
+
+/* Set to 1 to close each sector with an index of its records, read at mount */
+#ifndef MX25R6435F_KV_INDEX_PAGES
+#define MX25R6435F_KV_INDEX_PAGES     1
+#endif
+
+/*
+ * Key-value store appending the records to a circular log over an area of a
+ * MX25R6435FDevice: an update costs the program of the record, the index of
+ * the keys lives in RAM. gc() copies the live records of the oldest sector to
+ * the head of the log, one record per step within a time budget, then erases
+ * it.
+ */
+class MX25R6435FKvStore {
+  public:
+    /**
+      * @brief  Constructor.
+      * @param  device : Device holding the area
+      * @param  addr   : Start address of the area, aligned on a sector
+      * @param  size   : Size of the area, multiple of the sector size (3 sectors minimum)
+      */
+    MX25R6435FKvStore(MX25R6435FDevice &device, uint32_t addr, uint32_t size);
+
+    /**
+      * @brief  Mounts the store and builds the index.
+      * @retval memory status, MEMORY_ERROR if the area is not formatted
+      */
+    uint8_t begin(void);
+
+    /**
+      * @brief  Erases the area and creates an empty store.
+      * @retval memory status
+      */
+    uint8_t format(void);
+
+    /**
+      * @brief  Stores a value.
+      * @param  key   : Key of the value, 0xFFFFFFFF is reserved
+      * @param  pData : Value
+      * @param  size  : Size of the value, up to MX25R6435F_KV_MAX_VALUE
+      * @retval memory status, MEMORY_ERROR if the store is full
+      */
+    uint8_t set(uint32_t key, uint8_t *pData, uint16_t size);
+
+    /**
+      * @brief  Reads a value.
+      * @param  key     : Key of the value
+      * @param  pData   : Buffer of the value
+      * @param  maxSize : Size of the buffer, the value is truncated if larger
+      * @param  pSize   : Size of the value, can be NULL
+      * @retval memory status, MEMORY_ERROR if the key is unknown
+      */
+    uint8_t get(uint32_t key, uint8_t *pData, uint16_t maxSize, uint16_t *pSize = NULL);
+
+    /**
+      * @brief  Removes a value.
+      * @param  key : Key of the value
+      * @retval memory status
+      */
+    uint8_t remove(uint32_t key);
+
+    /* Return true if the key has a value */
+    bool exists(uint32_t key);
+
+    /* Return the number of keys */
+    uint32_t count(void);
+
+    /* Return the number of erased sectors ahead of the log */
+    uint32_t freeSectors(void);
+
+    /**
+      * @brief  Reclaims space when less than MX25R6435F_KV_GC_FREE sectors are
+      *         free. Live records of the oldest sector are copied until the
+      *         budget is spent, the sector is erased once empty.
+      * @param  budget : Time budget in units of the clock, at least one step
+      *                  (a record copy or a sector erase) is done
+      * @retval memory status
+      */
+    uint8_t gc(uint32_t budget);
+
+    /**
+      * @brief  Set the clock of the gc() budget, micros() by default on Arduino.
+      * @param  clock : Function returning the current time
+      */
+    void setClock(uint32_t (*clock)(void));
+
+  private:
+    /* Header of the sectors of the log */
+    typedef struct {
+      uint32_t magic;
+      uint32_t seq;
+      uint32_t crc;
+    } sector_t;
+
+    /* Header of the records, followed by the value */
+    typedef struct {
+      uint32_t key;
+      uint16_t size;
+      uint16_t type;
+      uint32_t crc;
+    } record_t;
+
+    /* End of a sector closed with its index */
+    typedef struct {
+      uint16_t count;
+      uint16_t offset;
+      uint32_t crc;
+    } trailer_t;
+
+    MX25R6435FDevice &_device;
+    uint32_t _addr;
+    uint32_t _sectors;
+    uint8_t _mounted;
+    uint32_t _seq;         /* Sequence number of the head sector */
+    uint32_t _head;        /* Sector appended */
+    uint32_t _headOffset;
+    uint32_t _headCount;   /* Records of the head sector */
+    uint32_t _tail;        /* Oldest sector */
+    uint32_t _used;        /* Sectors from the tail to the head */
+    uint32_t _gcOffset;    /* Next record of the tail to reclaim, 0 if not started */
+    uint32_t _gcLimit;     /* End of the records of the tail */
+    uint32_t (*_clock)(void);
+
+    uint32_t _keys[MX25R6435F_KV_MAX_KEYS];
+    uint32_t _locs[MX25R6435F_KV_MAX_KEYS];  /* Address of the last record of each key */
+    uint32_t _count;
+    uint8_t _page[MX25R6435F_PAGE_SIZE];
+
+    uint32_t sectorAddr(uint32_t sector);
+    uint32_t find(uint32_t key);
+    uint8_t indexSet(uint32_t key, uint32_t loc);
+    void indexRemove(uint32_t key);
+    bool blank(uint32_t addr, uint32_t size);
+    uint8_t readRecord(uint32_t addr, uint32_t limit, record_t *record);
+    uint8_t readTrailer(uint32_t sector, trailer_t *trailer);
+    uint8_t loadSector(uint32_t sector, bool head);
+    uint8_t openSector(uint32_t sector);
+    uint8_t closeHead(void);
+    bool fits(uint32_t size);
+    uint8_t reserve(uint32_t size, bool user, uint32_t *pAddr);
+    uint8_t append(uint32_t key, uint16_t type, uint8_t *pData, uint16_t size, uint32_t *pAddr);
+    uint8_t gcStep(void);
+};
+
+#endif /* _MX25R6435F_KVSTORE_H_ */
@@ -0,0 +1,409 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FLog.cpp
+  * @brief   Circular record log of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FLog.h"
+
+#if (MX25R6435F_LOG_READ_SIZE < 64) || (MX25R6435F_LOG_READ_SIZE > MX25R6435F_SECTOR_SIZE)
+#error "MX25R6435F_LOG_READ_SIZE must be between 64 and the sector size"
+#endif
+
+#define LOG_MAGIC       0x31474F4C /* "LOG1" */
+
+/* Size of a record in the log, aligned on 4 bytes */
+#define LOG_LENGTH(size) ((sizeof(record_t) + (size) + 3) & ~3UL)
+
+MX25R6435FLog::MX25R6435FLog(MX25R6435FDevice &device, uint32_t addr, uint32_t size): _device(device),
+  _addr(addr - (addr % MX25R6435F_SECTOR_SIZE)), _sectors(size / MX25R6435F_SECTOR_SIZE), _mounted(0), _seq(0),
+  _head(0), _headOffset(0), _flushed(0), _tail(0), _readSector(0), _readOffset(0), _bufAddr(0), _bufSize(0)
+{
+}
+
+uint32_t MX25R6435FLog::sectorAddr(uint32_t sector)
+{
+  return _addr + (sector * MX25R6435F_SECTOR_SIZE);
+}
+
+uint8_t MX25R6435FLog::readHeader(uint32_t sector, uint32_t *pSeq)
+{
+  sector_t header;
+
+  if ((_device.read((uint8_t *)&header, sectorAddr(sector), sizeof(sector_t)) != MEMORY_OK) ||
+      (header.magic != LOG_MAGIC) ||
+      (header.crc != memory_crc32(0, (uint8_t *)&header, sizeof(sector_t) - sizeof(uint32_t)))) {
+    return MEMORY_ERROR;
+  }
+
+  *pSeq = header.seq;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FLog::findHead(uint32_t *pFirst)
+{
+  uint32_t first = _sectors;
+  uint32_t seq = 0;
+  uint32_t low = 0;
+  uint32_t high = _sectors;
+
+  /* The log starts at sector 0, which the writer erases when it wraps: one of
+     the first 3 sectors belongs to the log */
+  for (uint32_t i = 0; (i < 3) && (first == _sectors); i++) {
+    if (readHeader(i, &seq) == MEMORY_OK) {
+      first = i;
+    }
+  }
+
+  if (first == _sectors) {
+    return MEMORY_ERROR;
+  }
+
+  /* From there, the sequence numbers follow the sectors up to the head and
+     not after: erased sectors, older sectors or sectors of a former log */
+  while ((high - low) > 1) {
+    uint32_t mid = (low + high) / 2;
+    uint32_t cur;
+
+    if ((readHeader((first + mid) % _sectors, &cur) == MEMORY_OK) && (cur == (seq + mid))) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  _head = (first + low) % _sectors;
+  _seq = seq + low;
+  *pFirst = first;
+
+  return MEMORY_OK;
+}
+
+bool MX25R6435FLog::blank(uint32_t sector)
+{
+  uint32_t addr = sectorAddr(sector);
+
+  /* The reader buffer is used */
+  _bufSize = 0;
+
+  for (uint32_t done = 0; done < MX25R6435F_SECTOR_SIZE; done += MX25R6435F_LOG_READ_SIZE) {
+    uint32_t chunk = MX25R6435F_SECTOR_SIZE - done;
+
+    if (chunk > MX25R6435F_LOG_READ_SIZE) {
+      chunk = MX25R6435F_LOG_READ_SIZE;
+    }
+    if (_device.read(_buf, addr + done, chunk) != MEMORY_OK) {
+      return false;
+    }
+    for (uint32_t i = 0; i < chunk; i++) {
+      if (_buf[i] != 0xFF) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+uint8_t MX25R6435FLog::erase(uint32_t sector)
+{
+  if (blank(sector)) {
+    return MEMORY_OK;
+  }
+
+  return _device.eraseSector(sectorAddr(sector));
+}
+
+uint8_t MX25R6435FLog::begin(void)
+{
+  uint32_t first;
+  record_t record;
+
+  _mounted = 0;
+  _bufSize = 0;
+
+  if ((_sectors < 3) || (findHead(&first) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  /* The oldest sector follows the erased one(s), if the log has wrapped */
+  _tail = first;
+  for (uint32_t i = 1; i <= 3; i++) {
+    uint32_t seq;
+
+    if ((readHeader((_head + i) % _sectors, &seq) == MEMORY_OK) && (seq == (_seq - _sectors + i))) {
+      _tail = (_head + i) % _sectors;
+      break;
+    }
+  }
+
+  /* The end of the records of the head sector */
+  _headOffset = sizeof(sector_t);
+  for (;;) {
+    uint32_t addr = sectorAddr(_head) + _headOffset;
+    uint32_t limit = sectorAddr(_head) + MX25R6435F_SECTOR_SIZE;
+    uint8_t *pData = fetch(addr, sizeof(record_t), limit);
+
+    if (pData == NULL) {
+      break;
+    }
+    memcpy(&record, pData, sizeof(record_t));
+    if ((record.check != (uint16_t)~record.size) || ((addr + LOG_LENGTH(record.size)) > limit)) {
+      break;
+    }
+    pData = fetch(addr + sizeof(record_t), record.size, limit);
+    if ((pData == NULL) ||
+        (memory_crc32(memory_crc32(0, (uint8_t *)&record, sizeof(uint32_t)), pData, record.size) != record.crc)) {
+      break;
+    }
+    _headOffset += LOG_LENGTH(record.size);
+  }
+
+  /* Nothing is appended after a record torn by a power loss */
+  for (uint32_t i = _headOffset; i < MX25R6435F_SECTOR_SIZE;) {
+    uint32_t chunk = MX25R6435F_PAGE_SIZE - (i % MX25R6435F_PAGE_SIZE);
+
+    if (_device.read(_page, sectorAddr(_head) + i, chunk) != MEMORY_OK) {
+      return MEMORY_ERROR;
+    }
+    for (uint32_t j = 0; j < chunk; j++) {
+      if (_page[j] != 0xFF) {
+        _headOffset = MX25R6435F_SECTOR_SIZE;
+      }
+    }
+    i += chunk;
+  }
+  _flushed = _headOffset;
+  _mounted = 1;
+
+  rewind();
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FLog::format(void)
+{
+  uint32_t first;
+
+  _mounted = 0;
+  _bufSize = 0;
+
+  if (_sectors < 3) {
+    return MEMORY_ERROR;
+  }
+
+  /* The new log is numbered after the former one, so that its sectors left
+     in the area are never taken for the new ones */
+  if (findHead(&first) != MEMORY_OK) {
+    _seq = 0;
+  }
+  _seq += _sectors;
+
+  _head = _sectors - 1;
+  _headOffset = MX25R6435F_SECTOR_SIZE;
+  _flushed = MX25R6435F_SECTOR_SIZE;
+  _tail = 0;
+  _mounted = 1;
+
+  if ((nextSector() != MEMORY_OK) || (flush() != MEMORY_OK)) {
+    _mounted = 0;
+    return MEMORY_ERROR;
+  }
+
+  rewind();
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FLog::put(const uint8_t *pData, uint32_t size)
+{
+  while (size > 0) {
+    uint32_t offset = _headOffset % MX25R6435F_PAGE_SIZE;
+    uint32_t chunk = MX25R6435F_PAGE_SIZE - offset;
+
+    if (chunk > size) {
+      chunk = size;
+    }
+    if (pData != NULL) {
+      memcpy(&_page[offset], pData, chunk);
+      pData += chunk;
+    } else {
+      memset(&_page[offset], 0xFF, chunk);
+    }
+    _headOffset += chunk;
+    size -= chunk;
+
+    /* A full page is programmed at once */
+    if (((_headOffset % MX25R6435F_PAGE_SIZE) == 0) && (flush() != MEMORY_OK)) {
+      return MEMORY_ERROR;
+    }
+  }
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FLog::flush(void)
+{
+  uint32_t offset = _flushed % MX25R6435F_PAGE_SIZE;
+
+  if ((_mounted == 0) || (_flushed >= _headOffset)) {
+    return (_mounted != 0) ? MEMORY_OK : MEMORY_ERROR;
+  }
+
+  if (_device.write(&_page[offset], sectorAddr(_head) + _flushed, _headOffset - _flushed) != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+  _flushed = _headOffset;
+
+  return MEMORY_OK;
+}
+
+uint8_t MX25R6435FLog::nextSector(void)
+{
+  uint32_t next = (_head + 1) % _sectors;
+  uint32_t ahead = (_head + 2) % _sectors;
+  sector_t header;
+
+  if (flush() != MEMORY_OK) {
+    return MEMORY_ERROR;
+  }
+
+  /* The next sector is normally erased already. The one after is erased now,
+     dropping the oldest records once the log has wrapped. */
+  if ((erase(next) != MEMORY_OK) || (erase(ahead) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  if (ahead == _tail) {
+    _tail = (ahead + 1) % _sectors;
+    if (_readSector == ahead) {
+      rewind();
+    }
+  }
+
+  _head = next;
+  _seq++;
+  _headOffset = 0;
+  _flushed = 0;
+
+  header.magic = LOG_MAGIC;
+  header.seq = _seq;
+  header.crc = memory_crc32(0, (uint8_t *)&header, sizeof(sector_t) - sizeof(uint32_t));
+
+  return put((uint8_t *)&header, sizeof(sector_t));
+}
+
+uint8_t MX25R6435FLog::append(uint8_t *pData, uint16_t size)
+{
+  uint32_t len = LOG_LENGTH(size);
+  record_t record;
+
+  if ((_mounted == 0) || ((pData == NULL) && (size != 0)) ||
+      ((sizeof(record_t) + size) > MX25R6435F_LOG_READ_SIZE)) {
+    return MEMORY_ERROR;
+  }
+
+  if (((_headOffset + len) > MX25R6435F_SECTOR_SIZE) && (nextSector() != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  record.size = size;
+  record.check = ~size;
+  record.crc = memory_crc32(memory_crc32(0, (uint8_t *)&record, sizeof(uint32_t)), pData, size);
+
+  if ((put((uint8_t *)&record, sizeof(record_t)) != MEMORY_OK) || (put(pData, size) != MEMORY_OK) ||
+      (put(NULL, len - sizeof(record_t) - size) != MEMORY_OK)) {
+    return MEMORY_ERROR;
+  }
+
+  return MEMORY_OK;
+}
+
+void MX25R6435FLog::rewind(void)
+{
+  _readSector = _tail;
+  _readOffset = sizeof(sector_t);
+  _bufSize = 0;
+}
+
+uint8_t *MX25R6435FLog::fetch(uint32_t addr, uint32_t size, uint32_t limit)
+{
+  /* Large reads are done ahead, up to the end of the readable data */
+  if ((addr < _bufAddr) || ((addr + size) > (_bufAddr + _bufSize))) {
+    if ((size > MX25R6435F_LOG_READ_SIZE) || ((addr + size) > limit)) {
+      return NULL;
+    }
+    _bufAddr = addr;
+    _bufSize = limit - addr;
+    if (_bufSize > MX25R6435F_LOG_READ_SIZE) {
+      _bufSize = MX25R6435F_LOG_READ_SIZE;
+    }
+    if (_device.read(_buf, _bufAddr, _bufSize) != MEMORY_OK) {
+      _bufSize = 0;
+      return NULL;
+    }
+  }
+
+  return &_buf[addr - _bufAddr];
+}
+
+uint8_t MX25R6435FLog::read(uint8_t *pData, uint16_t maxSize, uint16_t *pSize)
+{
+  if ((_mounted == 0) || ((pData == NULL) && (maxSize != 0))) {
+    return MEMORY_ERROR;
+  }
+
+  for (;;) {
+    uint32_t base = sectorAddr(_readSector);
+    uint32_t limit = base + ((_readSector == _head) ? _flushed : MX25R6435F_SECTOR_SIZE);
+    uint32_t addr = base + _readOffset;
+    record_t record;
+    uint8_t *pRecord = fetch(addr, sizeof(record_t), limit);
+    uint32_t crc;
+
+    if (pRecord != NULL) {
+      memcpy(&record, pRecord, sizeof(record_t));
+      if ((record.check == (uint16_t)~record.size) && ((addr + LOG_LENGTH(record.size)) <= limit)) {
+        uint16_t size = (record.size < maxSize) ? record.size : maxSize;
+
+        pRecord = fetch(addr + sizeof(record_t), record.size, limit);
+        if (pRecord != NULL) {
+          crc = memory_crc32(memory_crc32(0, (uint8_t *)&record, sizeof(uint32_t)), pRecord, record.size);
+        }
+
+        if ((pRecord != NULL) && (crc == record.crc)) {
+          if (size > 0) {
+            memcpy(pData, pRecord, size);
+          }
+          _readOffset += LOG_LENGTH(record.size);
+          if (pSize != NULL) {
+            *pSize = record.size;
+          }
+          return MEMORY_OK;
+        }
+      }
+    }
+
+    /* End of the records of the sector */
+    if (_readSector == _head) {
+      return MEMORY_ERROR;
+    }
+    _readSector = (_readSector + 1) % _sectors;
+    _readOffset = sizeof(sector_t);
+  }
+}
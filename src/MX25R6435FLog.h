@@ -0,0 +1,131 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FLog.h
+  * @brief   Circular record log of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_LOG_H_
+#define _MX25R6435F_LOG_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Size of the buffer of the reader, the size of its read requests. Records
+   are limited to this size minus 8 bytes. */
+#ifndef MX25R6435F_LOG_READ_SIZE
+#define MX25R6435F_LOG_READ_SIZE      1024
+#endif
+
+/*
+ * Records appended to an area of a MX25R6435FDevice used as a ring: once the
+ * area is full, the oldest sector is erased for the new records. Each sector
+ * starts with a sequence number, so begin() finds the newest sector by a
+ * binary search. The records are gathered in a page buffer and programmed a
+ * page at a time; the sector following the one written is kept erased.
+ */
+class MX25R6435FLog {
+  public:
+    /**
+      * @brief  Constructor.
+      * @param  device : Device holding the area
+      * @param  addr   : Start address of the area, aligned on a sector
+      * @param  size   : Size of the area, multiple of the sector size (3 sectors minimum)
+      */
+    MX25R6435FLog(MX25R6435FDevice &device, uint32_t addr, uint32_t size);
+
+    /**
+      * @brief  Mounts the log and places the reader on the oldest record.
+      * @retval memory status, MEMORY_ERROR if the area is not formatted
+      */
+    uint8_t begin(void);
+
+    /**
+      * @brief  Empties the log. Only the first 2 sectors are erased.
+      * @retval memory status
+      */
+    uint8_t format(void);
+
+    /**
+      * @brief  Appends a record. It is programmed when its page is full or
+      *         by flush().
+      * @param  pData : Record
+      * @param  size  : Size of the record, up to MX25R6435F_LOG_READ_SIZE minus 8 bytes
+      * @retval memory status
+      */
+    uint8_t append(uint8_t *pData, uint16_t size);
+
+    /**
+      * @brief  Programs the records still in the page buffer.
+      * @retval memory status
+      */
+    uint8_t flush(void);
+
+    /* Place the reader on the oldest record */
+    void rewind(void);
+
+    /**
+      * @brief  Reads the next record. The records still in the page buffer are
+      *         not seen. A reader overtaken by the writer goes on from the
+      *         oldest record.
+      * @param  pData   : Buffer of the record
+      * @param  maxSize : Size of the buffer, the record is truncated if larger
+      * @param  pSize   : Size of the record, can be NULL
+      * @retval memory status, MEMORY_ERROR when there is no more record
+      */
+    uint8_t read(uint8_t *pData, uint16_t maxSize, uint16_t *pSize = NULL);
+
+  private:
+    /* Header of the sectors */
+    typedef struct {
+      uint32_t magic;
+      uint32_t seq;
+      uint32_t crc;
+    } sector_t;
+
+    /* Header of the records, followed by the data */
+    typedef struct {
+      uint16_t size;
+      uint16_t check;   /* ~size */
+      uint32_t crc;
+    } record_t;
+
+    MX25R6435FDevice &_device;
+    uint32_t _addr;
+    uint32_t _sectors;
+    uint8_t _mounted;
+    uint32_t _seq;         /* Sequence number of the head sector */
+    uint32_t _head;        /* Sector written */
+    uint32_t _headOffset;  /* End of the records, buffered ones included */
+    uint32_t _flushed;     /* End of the records programmed */
+    uint32_t _tail;        /* Oldest sector */
+    uint32_t _readSector;
+    uint32_t _readOffset;
+    uint32_t _bufAddr;     /* Address of the data of the reader buffer */
+    uint32_t _bufSize;
+
+    uint8_t _page[MX25R6435F_PAGE_SIZE];
+    uint8_t _buf[MX25R6435F_LOG_READ_SIZE];
+
+    uint32_t sectorAddr(uint32_t sector);
+    uint8_t readHeader(uint32_t sector, uint32_t *pSeq);
+    uint8_t findHead(uint32_t *pFirst);
+    bool blank(uint32_t sector);
+    uint8_t erase(uint32_t sector);
+    uint8_t put(const uint8_t *pData, uint32_t size);
+    uint8_t nextSector(void);
+    uint8_t *fetch(uint32_t addr, uint32_t size, uint32_t limit);
+};
+
+#endif /* _MX25R6435F_LOG_H_ */
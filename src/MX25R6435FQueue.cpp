@@ -0,0 +1,323 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FQueue.cpp
+  * @brief   Prioritized request queue of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "MX25R6435FQueue.h"
+#ifdef ARDUINO
+#include "Arduino.h"
+#endif
+
+/* Start and end addresses of the area still to be accessed by a request */
+static uint32_t requestStart(uint8_t type, uint32_t addr, uint32_t done)
+{
+  if (type == MEMORY_QUEUE_ERASE) {
+    return addr - (addr % MX25R6435F_SECTOR_SIZE);
+  }
+  return addr + done;
+}
+
+static uint32_t requestEnd(uint8_t type, uint32_t addr, uint32_t size)
+{
+  if (type == MEMORY_QUEUE_ERASE) {
+    return addr - (addr % MX25R6435F_SECTOR_SIZE) + MX25R6435F_SECTOR_SIZE;
+  }
+  return addr + size;
+}
+
+MX25R6435FQueue::MX25R6435FQueue(MX25R6435FDevice &device): _device(device), _seq(0),
+#ifdef ARDUINO
+  _clock(micros),
+#else
+  _clock(NULL),
+#endif
+  _status(MEMORY_OK)
+{
+  memset(_req, 0, sizeof(_req));
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+uint8_t MX25R6435FQueue::read(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback, void *arg)
+{
+  return submit(MEMORY_QUEUE_READ, pData, addr, size, callback, arg);
+}
+
+uint8_t MX25R6435FQueue::write(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback, void *arg)
+{
+  return submit(MEMORY_QUEUE_WRITE, pData, addr, size, callback, arg);
+}
+
+uint8_t MX25R6435FQueue::eraseSector(uint32_t addr, memory_callback_t callback, void *arg)
+{
+  return submit(MEMORY_QUEUE_ERASE, NULL, addr, 0, callback, arg);
+}
+
+uint8_t MX25R6435FQueue::submit(memory_queue_class_t type, uint8_t *pData, uint32_t addr, uint32_t size,
+                                memory_callback_t callback, void *arg)
+{
+  request_t *req = NULL;
+
+  if ((type != MEMORY_QUEUE_ERASE) && ((pData == NULL) || (size == 0))) {
+    return MEMORY_ERROR;
+  }
+
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    if (_req[i].used == 0) {
+      req = &_req[i];
+      break;
+    }
+  }
+
+  if (req == NULL) {
+    return MEMORY_BUSY;
+  }
+
+  req->used     = 1;
+  req->type     = type;
+  req->started  = 0;
+  req->pData    = pData;
+  req->addr     = addr;
+  req->size     = size;
+  req->done     = 0;
+  req->seq      = _seq++;
+  req->time     = (_clock != NULL) ? _clock() : 0;
+  req->callback = callback;
+  req->arg      = arg;
+
+  _stats.submitted[type]++;
+  _stats.depth++;
+  if (_stats.depth > _stats.maxDepth) {
+    _stats.maxDepth = _stats.depth;
+  }
+
+  return MEMORY_OK;
+}
+
+bool MX25R6435FQueue::blocked(const request_t *req)
+{
+  uint32_t start = requestStart(req->type, req->addr, req->done);
+  uint32_t end = requestEnd(req->type, req->addr, req->size);
+
+  /* An older request of another class on the same addresses goes first */
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    const request_t *other = &_req[i];
+
+    if ((other->used != 0) && (other->type != req->type) && ((int32_t)(other->seq - req->seq) < 0) &&
+        (requestStart(other->type, other->addr, other->done) < end) &&
+        (requestEnd(other->type, other->addr, other->size) > start)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void MX25R6435FQueue::start(request_t *req)
+{
+  uint32_t wait;
+
+  if (req->started != 0) {
+    return;
+  }
+
+  req->started = 1;
+  wait = (_clock != NULL) ? (_clock() - req->time) : 0;
+  _stats.waitTotal[req->type] += wait;
+  if (wait > _stats.waitMax[req->type]) {
+    _stats.waitMax[req->type] = wait;
+  }
+}
+
+void MX25R6435FQueue::complete(request_t *req, uint8_t status)
+{
+  memory_callback_t callback = req->callback;
+  void *arg = req->arg;
+
+  start(req);
+  req->used = 0;
+  _stats.completed[req->type]++;
+  _stats.depth--;
+
+  if (status != MEMORY_OK) {
+    _status = MEMORY_ERROR;
+  }
+
+  if (callback != NULL) {
+    callback(status, arg);
+  }
+}
+
+bool MX25R6435FQueue::process(void)
+{
+  request_t *req = NULL;
+  uint8_t status;
+
+  /* Oldest request of the highest class which is not blocked */
+  for (uint8_t type = 0; (type < MEMORY_QUEUE_CLASSES) && (req == NULL); type++) {
+    for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+      request_t *cur = &_req[i];
+
+      if ((cur->used != 0) && (cur->type == type) &&
+          ((req == NULL) || ((int32_t)(cur->seq - req->seq) < 0)) && !blocked(cur)) {
+        req = cur;
+      }
+    }
+  }
+
+  if (req == NULL) {
+    return false;
+  }
+
+  start(req);
+
+  switch (req->type) {
+    case MEMORY_QUEUE_READ:
+      status = _device.read(req->pData, req->addr, req->size);
+      complete(req, status);
+      break;
+    case MEMORY_QUEUE_WRITE:
+      processWrite(req);
+      break;
+    default:
+      processErase(req);
+      break;
+  }
+
+  return true;
+}
+
+uint8_t MX25R6435FQueue::processWrite(request_t *req)
+{
+  uint32_t addr = req->addr + req->done;
+  uint32_t page = addr - (addr % MX25R6435F_PAGE_SIZE);
+  uint32_t low = addr - page;
+  uint32_t high = MX25R6435F_PAGE_SIZE;
+  bool merged[MX25R6435F_QUEUE_DEPTH];
+  uint8_t status;
+
+  if ((req->size - req->done) < (high - low)) {
+    high = low + (req->size - req->done);
+  }
+
+  memset(_page, 0xFF, MX25R6435F_PAGE_SIZE);
+  memcpy(_page + low, req->pData + req->done, high - low);
+
+  /* Gather the other writes of the page: programming only clears bits, so
+     their order does not matter */
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    request_t *other = &_req[i];
+
+    merged[i] = false;
+    if ((other == req) || (other->used == 0) || (other->type != MEMORY_QUEUE_WRITE) ||
+        (other->done != 0) || (other->addr < page) ||
+        ((other->addr + other->size) > (page + MX25R6435F_PAGE_SIZE)) || blocked(other)) {
+      continue;
+    }
+
+    for (uint32_t j = 0; j < other->size; j++) {
+      _page[other->addr - page + j] &= other->pData[j];
+    }
+    if ((other->addr - page) < low) {
+      low = other->addr - page;
+    }
+    if ((other->addr + other->size - page) > high) {
+      high = other->addr + other->size - page;
+    }
+    merged[i] = true;
+  }
+
+  status = _device.write(_page + low, page + low, high - low);
+
+  req->done += (page + MX25R6435F_PAGE_SIZE) - addr;
+  if ((req->done >= req->size) || (status != MEMORY_OK)) {
+    complete(req, status);
+  }
+
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    if (merged[i]) {
+      _stats.mergedWrites++;
+      complete(&_req[i], status);
+    }
+  }
+
+  return status;
+}
+
+uint8_t MX25R6435FQueue::processErase(request_t *req)
+{
+  uint32_t sector = req->addr - (req->addr % MX25R6435F_SECTOR_SIZE);
+  bool merged[MX25R6435F_QUEUE_DEPTH];
+  uint8_t status;
+
+  /* The other erases of the sector not waiting for an older request are
+     done by this one */
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    request_t *other = &_req[i];
+
+    merged[i] = (other != req) && (other->used != 0) && (other->type == MEMORY_QUEUE_ERASE) &&
+                ((other->addr - (other->addr % MX25R6435F_SECTOR_SIZE)) == sector) && !blocked(other);
+  }
+
+  status = _device.eraseSector(sector);
+  complete(req, status);
+
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    if (merged[i]) {
+      _stats.mergedErases++;
+      complete(&_req[i], status);
+    }
+  }
+
+  return status;
+}
+
+uint8_t MX25R6435FQueue::flush(void)
+{
+  _status = MEMORY_OK;
+
+  while (process()) {
+  }
+
+  return _status;
+}
+
+uint32_t MX25R6435FQueue::depth(void)
+{
+  return _stats.depth;
+}
+
+void MX25R6435FQueue::setClock(uint32_t (*clock)(void))
+{
+  _clock = clock;
+}
+
+void MX25R6435FQueue::stats(memory_queue_stats_t *stats)
+{
+  if (stats != NULL) {
+    *stats = _stats;
+  }
+}
+
+void MX25R6435FQueue::resetStats(void)
+{
+  uint32_t depth = _stats.depth;
+
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.depth = depth;
+  _stats.maxDepth = depth;
+}
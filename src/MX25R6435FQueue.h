@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * @file    MX25R6435FQueue.h
+  * @brief   Prioritized request queue of the MX25R6435F library
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#ifndef _MX25R6435F_QUEUE_H_
+#define _MX25R6435F_QUEUE_H_
+
+#include "MX25R6435FDevice.h"
+
+/* Maximum number of pending requests */
+#ifndef MX25R6435F_QUEUE_DEPTH
+#define MX25R6435F_QUEUE_DEPTH  16
+#endif
+
+/* Request classes, by decreasing priority */
+typedef enum {
+  MEMORY_QUEUE_READ,
+  MEMORY_QUEUE_WRITE,
+  MEMORY_QUEUE_ERASE,
+  MEMORY_QUEUE_CLASSES
+} memory_queue_class_t;
+
+/* Queue counters. The times are in units of the queue clock. */
+typedef struct {
+  uint32_t depth;                            /* Number of pending requests */
+  uint32_t maxDepth;                         /* Highest number of pending requests */
+  uint32_t submitted[MEMORY_QUEUE_CLASSES];  /* Requests accepted */
+  uint32_t completed[MEMORY_QUEUE_CLASSES];  /* Requests completed */
+  uint32_t waitTotal[MEMORY_QUEUE_CLASSES];  /* Sum of the waits before the first dispatch */
+  uint32_t waitMax[MEMORY_QUEUE_CLASSES];    /* Longest wait before the first dispatch */
+  uint32_t mergedWrites;                     /* Writes programmed with another one */
+  uint32_t mergedErases;                     /* Erases done by another erase of the sector */
+} memory_queue_stats_t;
+
+/*
+ * Request queue in front of a MX25R6435FDevice. Reads are served before
+ * writes and writes before erases, a request never overtaking an older one
+ * on the same addresses. Writes are programmed one page at a time, gathering
+ * the other pending writes of the page, and the pending erases of a sector
+ * are done once. The requests are served by process(), from the loop or a
+ * single task; the callbacks are called from there.
+ */
+class MX25R6435FQueue {
+  public:
+    MX25R6435FQueue(MX25R6435FDevice &device);
+
+    /**
+      * @brief  Queues a read.
+      * @param  pData    : Pointer to data to be read
+      * @param  addr     : Read start address
+      * @param  size     : Size of data to read
+      * @param  callback : Function called when the read is done
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status, MEMORY_BUSY when the queue is full
+      */
+    uint8_t read(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback = NULL, void *arg = NULL);
+
+    /**
+      * @brief  Queues a write.
+      * @param  pData    : Pointer to data to be written, kept until the callback
+      * @param  addr     : Write start address
+      * @param  size     : Size of data to write
+      * @param  callback : Function called when the write is done
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status, MEMORY_BUSY when the queue is full
+      */
+    uint8_t write(uint8_t *pData, uint32_t addr, uint32_t size, memory_callback_t callback = NULL, void *arg = NULL);
+
+    /**
+      * @brief  Queues the erase of a sector.
+      * @param  addr     : Address in the sector
+      * @param  callback : Function called when the erase is done
+      * @param  arg      : Parameter given to the callback
+      * @retval memory status, MEMORY_BUSY when the queue is full
+      */
+    uint8_t eraseSector(uint32_t addr, memory_callback_t callback = NULL, void *arg = NULL);
+
+    /**
+      * @brief  Serves the request of highest priority: a read, a page of a
+      *         write or a sector erase.
+      * @retval true if a request was served, false if none is pending
+      */
+    bool process(void);
+
+    /**
+      * @brief  Serves all the pending requests.
+      * @retval memory status, MEMORY_ERROR if a request failed
+      */
+    uint8_t flush(void);
+
+    /* Return the number of pending requests */
+    uint32_t depth(void);
+
+    /**
+      * @brief  Set the clock used to measure the waits, micros() by default
+      *         on Arduino.
+      * @param  clock : Function returning the current time
+      */
+    void setClock(uint32_t (*clock)(void));
+
+    /* Copy the counters of the queue */
+    void stats(memory_queue_stats_t *stats);
+
+    /* Clear the counters of the queue, except the current depth */
+    void resetStats(void);
+
+  private:
+    typedef struct {
+      uint8_t used;
+      uint8_t type;          /* memory_queue_class_t */
+      uint8_t started;       /* Wait already counted */
+      uint8_t *pData;
+      uint32_t addr;
+      uint32_t size;
+      uint32_t done;         /* Bytes already written */
+      uint32_t seq;          /* Order of submission */
+      uint32_t time;         /* Time of submission */
+      memory_callback_t callback;
+      void *arg;
+    } request_t;
+
+    MX25R6435FDevice &_device;
+    request_t _req[MX25R6435F_QUEUE_DEPTH];
+    uint32_t _seq;
+    uint32_t (*_clock)(void);
+    memory_queue_stats_t _stats;
+    uint8_t _status;       /* MEMORY_ERROR once a request failed */
+    uint8_t _page[MX25R6435F_PAGE_SIZE];
+
+    uint8_t submit(memory_queue_class_t type, uint8_t *pData, uint32_t addr, uint32_t size,
+                   memory_callback_t callback, void *arg);
+    bool blocked(const request_t *req);
+    void start(request_t *req);
+    void complete(request_t *req, uint8_t status);
+    uint8_t processWrite(request_t *req);
+    uint8_t processErase(request_t *req);
+};
+
+#endif /* _MX25R6435F_QUEUE_H_ */
@@ -35,6 +35,11 @@ extern "C" {
 #define MX25R6435F_SECTOR_SIZE               0x1000    /* 2048 sectors of 4kBytes */
 #define MX25R6435F_PAGE_SIZE                 0x100     /* 32768 pages of 256 bytes */
 
+#define MX25R6435F_MANUFACTURER_ID           0xC2      /* Macronix */
+#define MX25R6435F_JEDEC_ID                  0xC22817  /* MX25R1635F: 0xC22815, MX25R3235F: 0xC22816 */
+
+#define MX25R6435F_HIGH_PERF_MAX_FREQ        80000000  /* Clock frequency limit in high performance mode */
+#define MX25R6435F_LOW_POWER_MAX_FREQ        33000000  /* Clock frequency limit in ultra low power mode */
 #define MX25R6435F_DUMMY_CYCLES_READ         8
 #define MX25R6435F_DUMMY_CYCLES_READ_DUAL    4
 #define MX25R6435F_DUMMY_CYCLES_READ_QUAD    4
@@ -49,6 +54,11 @@ extern "C" {
 #define MX25R6435F_SUBBLOCK_ERASE_MAX_TIME   3000
 #define MX25R6435F_SECTOR_ERASE_MAX_TIME     240
 
+#define MX25R6435F_CHIP_ERASE_TYP_TIME       50000
+#define MX25R6435F_BLOCK_ERASE_TYP_TIME      480
+#define MX25R6435F_SUBBLOCK_ERASE_TYP_TIME   240
+#define MX25R6435F_SECTOR_ERASE_TYP_TIME     40
+
 /**
   * @brief  MX25R6435F Commands
   */
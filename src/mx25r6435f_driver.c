@@ -22,6 +22,7 @@ extern "C" {
 #endif
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "core_debug.h"
 #include "mx25r6435f_driver.h"
 
@@ -32,27 +33,327 @@ extern "C" {
 #define QSPI_HIGH_PERF_DISABLE  0x0
 #define QSPI_HIGH_PERF_ENABLE   0x1
 
+/* Number of bytes of the quad read pattern checked by the calibration */
+#define QSPI_CALIB_PATTERN_SIZE 64
+#define QSPI_CALIB_SFDP_SIZE    16
+
+/* Serial flash discoverable parameters (JESD216) */
+#define QSPI_SFDP_SIGNATURE     0x50444653 /* "SFDP" */
+#define QSPI_SFDP_HEADER_SIZE   16 /* SFDP header and basic parameter header */
+#define QSPI_SFDP_BFPT_ID       0x00
+#define QSPI_SFDP_BFPT_MIN      9  /* DWORDs up to the erase types */
+#define QSPI_SFDP_BFPT_MAX      11 /* DWORDs up to the chip erase time */
+#define QSPI_JEDEC_ID_SIZE      3
+
+/* Number of bytes read at once by the blank check in indirect mode */
+#define QSPI_BLANK_CHUNK_SIZE   512
+
+/* Vectored reads: elements closer than the gap are read by one command */
+#define QSPI_VEC_BUFFER_SIZE    256
+#define QSPI_VEC_MAX_GAP        32
+
+/* Header of the table of the retired sectors, followed by the map in the next page */
+#define QSPI_RETIRED_MAGIC      0x31544552 /* "RET1" */
+
+/* Address of a free write cache slot or read cache line */
+#define QSPI_CACHE_FREE         0xFFFFFFFF
+
+/* Maximum number of bytes moved by one asynchronous transfer */
+#define QSPI_ASYNC_MAX_TRANSFER 0x8000
+
+/* Steps of the asynchronous page programming and erase */
+#define QSPI_ASYNC_STEP_WREN    0x0 /* Write enable command sent */
+#define QSPI_ASYNC_STEP_WEL     0x1 /* Waiting for the write enable latch */
+#define QSPI_ASYNC_STEP_PROGRAM 0x2 /* Page program data transfer or erase command */
+#define QSPI_ASYNC_STEP_WIP     0x3 /* Waiting for the end of program or erase */
+#define QSPI_ASYNC_STEP_CHECK   0x4 /* Reading the security register (fail flags) */
+
+/* Suspend state of the asynchronous page programming and erase */
+#define QSPI_ASYNC_RUNNING      0x0 /* Steps chained from interrupt */
+#define QSPI_ASYNC_PAUSING      0x1 /* Stop requested at the next step */
+#define QSPI_ASYNC_PAUSED       0x2 /* Stopped, the current step is run by the resume */
+
+/* Statistics: no operation recorded, shortest duration of the histogram (log2 of cycles) */
+#define QSPI_STATS_NONE         0xFF
+#define QSPI_STATS_MIN_LOG2     8
+
+#if defined(OCTOSPI2)
+#define QSPI_INSTANCE_NUMBER    2
+#else
+#define QSPI_INSTANCE_NUMBER    1
+#endif
+
+/* Private types -------------------------------------------------------------*/
+/* Index of the command templates */
+typedef enum {
+  QSPI_CMD_READ,
+  QSPI_CMD_PAGE_PROG,
+  QSPI_CMD_SECTOR_ERASE,  /* Erase commands follow the QSPI_ERASE_xxx order */
+  QSPI_CMD_SUBBLOCK_ERASE,
+  QSPI_CMD_BLOCK_ERASE,
+  QSPI_CMD_CHIP_ERASE,
+  QSPI_CMD_READ_STATUS_REG,
+  QSPI_CMD_READ_CFG_REG,
+  QSPI_CMD_WRITE_STATUS_CFG_REG,
+  QSPI_CMD_READ_SEC_REG,
+  QSPI_CMD_READ_SFDP,
+  QSPI_CMD_READ_ID,
+  QSPI_CMD_WRITE_ENABLE,
+  QSPI_CMD_SUSPEND,
+  QSPI_CMD_RESUME,
+  QSPI_CMD_DEEP_POWER_DOWN,
+  QSPI_CMD_NOP,
+  QSPI_CMD_RESET_ENABLE,
+  QSPI_CMD_RESET_MEMORY,
+  QSPI_CMD_RELEASE_READ_ENHANCED,
+  QSPI_CMD_NUMBER
+} QSPI_CmdTypeDef;
+
+#if MX25R6435F_STATS
+/* Operation measured until the end of the scope of QSPI_STATS() */
+typedef struct {
+  QSPI_t *obj;
+  uint8_t op;      /* QSPI_STATS_NONE if not recorded */
+  uint8_t depth;   /* Nesting level of the thread calls incremented */
+  uint32_t size;
+  uint32_t start;  /* Cycle counter at the call */
+} QSPI_StatsScope;
+#endif
+
+/* Private macros ------------------------------------------------------------*/
+/*
+ * Statistics of an operation, measured from the declaration to the return of
+ * the function. QSPI_STATS_ASYNC() extends the measure of an asynchronous
+ * operation to its completion. Nothing is compiled without MX25R6435F_STATS.
+ */
+#if MX25R6435F_STATS
+#define QSPI_STATS(obj, op, size) \
+  QSPI_StatsScope qspi_stats __attribute__((cleanup(QSPI_StatsEnd))) = QSPI_StatsBegin((obj), (op), (size))
+#define QSPI_STATS_ASYNC(obj)     QSPI_StatsAsync((obj), &qspi_stats)
+#else
+#define QSPI_STATS(obj, op, size)
+#define QSPI_STATS_ASYNC(obj)
+#endif
+
+/*
+ * Command template: instruction on 1 line, 24-bit address, 8-bit alternate
+ * bytes. Address, alternate bytes and data modes are given as NONE, 1_LINE
+ * or 4_LINES.
+ */
+#ifdef OCTOSPI
+#define QSPI_CMD(inst, addr, alt, data, dummy, nbdata) {                   \
+    .OperationType         = HAL_OSPI_OPTYPE_COMMON_CFG,                   \
+    .FlashId               = HAL_OSPI_FLASH_ID_1,                          \
+    .Instruction           = (inst),                                       \
+    .InstructionMode       = HAL_OSPI_INSTRUCTION_1_LINE,                  \
+    .InstructionSize       = HAL_OSPI_INSTRUCTION_8_BITS,                  \
+    .InstructionDtrMode    = HAL_OSPI_INSTRUCTION_DTR_DISABLE,             \
+    .AddressMode           = HAL_OSPI_ADDRESS_##addr,                      \
+    .AddressSize           = HAL_OSPI_ADDRESS_24_BITS,                     \
+    .AddressDtrMode        = HAL_OSPI_ADDRESS_DTR_DISABLE,                 \
+    .AlternateBytes        = MX25R6435F_ALT_BYTES_NO_PE_MODE,              \
+    .AlternateBytesMode    = HAL_OSPI_ALTERNATE_BYTES_##alt,               \
+    .AlternateBytesSize    = HAL_OSPI_ALTERNATE_BYTES_8_BITS,              \
+    .AlternateBytesDtrMode = HAL_OSPI_ALTERNATE_BYTES_DTR_DISABLE,         \
+    .DataMode              = HAL_OSPI_DATA_##data,                         \
+    .NbData                = (nbdata),                                     \
+    .DataDtrMode           = HAL_OSPI_DATA_DTR_DISABLE,                    \
+    .DummyCycles           = (dummy),                                      \
+    .DQSMode               = HAL_OSPI_DQS_DISABLE,                         \
+    .SIOOMode              = HAL_OSPI_SIOO_INST_EVERY_CMD                  \
+  }
+
+#define QSPI_POLLING(match, mask) {                                        \
+    .Match                 = (match),                                      \
+    .Mask                  = (mask),                                       \
+    .MatchMode             = HAL_OSPI_MATCH_MODE_AND,                      \
+    .AutomaticStop         = HAL_OSPI_AUTOMATIC_STOP_ENABLE,               \
+    .Interval              = 0x10                                          \
+  }
+#else /* OCTOSPI */
+#define QSPI_CMD(inst, addr, alt, data, dummy, nbdata) {                   \
+    .Instruction           = (inst),                                       \
+    .AlternateBytes        = MX25R6435F_ALT_BYTES_NO_PE_MODE,              \
+    .AddressSize           = QSPI_ADDRESS_24_BITS,                         \
+    .AlternateBytesSize    = QSPI_ALTERNATE_BYTES_8_BITS,                  \
+    .DummyCycles           = (dummy),                                      \
+    .InstructionMode       = QSPI_INSTRUCTION_1_LINE,                      \
+    .AddressMode           = QSPI_ADDRESS_##addr,                          \
+    .AlternateByteMode     = QSPI_ALTERNATE_BYTES_##alt,                   \
+    .DataMode              = QSPI_DATA_##data,                             \
+    .NbData                = (nbdata),                                     \
+    .DdrMode               = QSPI_DDR_MODE_DISABLE,                        \
+    .DdrHoldHalfCycle      = QSPI_DDR_HHC_ANALOG_DELAY,                    \
+    .SIOOMode              = QSPI_SIOO_INST_EVERY_CMD                      \
+  }
+
+#define QSPI_POLLING(match, mask) {                                        \
+    .Match                 = (match),                                      \
+    .Mask                  = (mask),                                       \
+    .Interval              = 0x10,                                         \
+    .StatusBytesSize       = 1,                                            \
+    .MatchMode             = QSPI_MATCH_MODE_AND,                          \
+    .AutomaticStop         = QSPI_AUTOMATIC_STOP_ENABLE                    \
+  }
+#endif /* OCTOSPI */
+
+/* Private variables ---------------------------------------------------------*/
+/* Command templates, only the address and the data length are set per call */
+static const XSPI_CommandTypeDef qspi_cmd[QSPI_CMD_NUMBER] = {
+  /*                                          Instruction                        Address  Alternate Data     Dummy cycles                       NbData */
+  [QSPI_CMD_READ]                  = QSPI_CMD(QUAD_INOUT_READ_CMD,               4_LINES, 4_LINES,  4_LINES, MX25R6435F_DUMMY_CYCLES_READ_QUAD, 0),
+  [QSPI_CMD_PAGE_PROG]             = QSPI_CMD(QUAD_PAGE_PROG_CMD,                4_LINES, NONE,     4_LINES, 0,                                 0),
+  [QSPI_CMD_SECTOR_ERASE]          = QSPI_CMD(SECTOR_ERASE_CMD,                  1_LINE,  NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_SUBBLOCK_ERASE]        = QSPI_CMD(SUBBLOCK_ERASE_CMD,                1_LINE,  NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_BLOCK_ERASE]           = QSPI_CMD(BLOCK_ERASE_CMD,                   1_LINE,  NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_CHIP_ERASE]            = QSPI_CMD(CHIP_ERASE_CMD,                    NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_READ_STATUS_REG]       = QSPI_CMD(READ_STATUS_REG_CMD,               NONE,    NONE,     1_LINE,  0,                                 1),
+  [QSPI_CMD_READ_CFG_REG]          = QSPI_CMD(READ_CFG_REG_CMD,                  NONE,    NONE,     1_LINE,  0,                                 2),
+  [QSPI_CMD_WRITE_STATUS_CFG_REG]  = QSPI_CMD(WRITE_STATUS_CFG_REG_CMD,          NONE,    NONE,     1_LINE,  0,                                 1),
+  [QSPI_CMD_READ_SEC_REG]          = QSPI_CMD(READ_SEC_REG_CMD,                  NONE,    NONE,     1_LINE,  0,                                 1),
+  [QSPI_CMD_READ_SFDP]             = QSPI_CMD(READ_SERIAL_FLASH_DISCO_PARAM_CMD, 1_LINE,  NONE,     1_LINE,  MX25R6435F_DUMMY_CYCLES_READ,      0),
+  [QSPI_CMD_READ_ID]               = QSPI_CMD(READ_ID_CMD,                       NONE,    NONE,     1_LINE,  0,                                 QSPI_JEDEC_ID_SIZE),
+  [QSPI_CMD_WRITE_ENABLE]          = QSPI_CMD(WRITE_ENABLE_CMD,                  NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_SUSPEND]               = QSPI_CMD(PROG_ERASE_SUSPEND_CMD,            NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_RESUME]                = QSPI_CMD(PROG_ERASE_RESUME_CMD,             NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_DEEP_POWER_DOWN]       = QSPI_CMD(DEEP_POWER_DOWN_CMD,               NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_NOP]                   = QSPI_CMD(NO_OPERATION_CMD,                  NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_RESET_ENABLE]          = QSPI_CMD(RESET_ENABLE_CMD,                  NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_RESET_MEMORY]          = QSPI_CMD(RESET_MEMORY_CMD,                  NONE,    NONE,     NONE,    0,                                 0),
+  [QSPI_CMD_RELEASE_READ_ENHANCED] = QSPI_CMD(RELEASE_READ_ENHANCED_CMD,         NONE,    NONE,     NONE,    0,                                 0),
+};
+
+/* Erase durations in ms by unit of the SFDP erase time fields */
+static const uint32_t qspi_sfdp_erase_unit[4] = {1, 16, 128, 1000};
+static const uint32_t qspi_sfdp_chip_erase_unit[4] = {16, 256, 4000, 64000};
+
+/* Automatic polling templates of the status register */
+static const XSPI_AutoPollingTypeDef qspi_polling_wel   = QSPI_POLLING(MX25R6435F_SR_WEL, MX25R6435F_SR_WEL);
+static const XSPI_AutoPollingTypeDef qspi_polling_ready = QSPI_POLLING(0, MX25R6435F_SR_WIP);
+
+/* Objects served by the xSPI interrupt handlers */
+static QSPI_t *qspi_obj[QSPI_INSTANCE_NUMBER] = {NULL};
+#if MX25R6435F_DMA
+static DMA_HandleTypeDef *qspi_hdma = NULL;
+#endif
+
 /* Private functions ---------------------------------------------------------*/
+static uint8_t QSPI_Command(XSPI_HandleTypeDef *hxspi, QSPI_CmdTypeDef Cmd, uint32_t Address, uint32_t NbData);
+static uint8_t QSPI_Command_IT(XSPI_HandleTypeDef *hxspi, QSPI_CmdTypeDef Cmd, uint32_t Address);
+static uint8_t QSPI_Erase(QSPI_t *obj, QSPI_CmdTypeDef Cmd, uint32_t Address, uint32_t Timeout);
+static uint8_t QSPI_EraseArea(QSPI_t *obj, QSPI_CmdTypeDef Cmd, uint32_t Address, uint32_t Timeout, uint8_t Started);
+static uint8_t QSPI_EraseCheck(QSPI_t *obj);
+static uint8_t QSPI_EraseSuspend(QSPI_t *obj, uint8_t *pSuspended);
+static uint8_t QSPI_EraseResume(QSPI_t *obj, uint8_t status);
+static uint8_t QSPI_EraseSuspendAsync(QSPI_t *obj);
+static uint8_t QSPI_EraseResumeAsync(QSPI_t *obj, uint8_t status);
+static uint8_t QSPI_CheckFail(XSPI_HandleTypeDef *hxspi, uint8_t Flag, uint8_t *pFail);
+static void QSPI_Retire(QSPI_t *obj, uint32_t Address);
+static void QSPI_RetiredErased(QSPI_t *obj, uint32_t Address, uint32_t Size);
+static uint8_t QSPI_RetiredLoad(QSPI_t *obj);
+#if MX25R6435F_RETIRED_TABLE
+static void QSPI_RetiredSave(QSPI_t *obj);
+#endif
+static uint8_t QSPI_EraseType(const QSPI_Info *pInfo, uint32_t Address, uint32_t Size);
+static uint8_t QSPI_ScanBlank(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t *pBlank);
+static uint8_t QSPI_BlankMapGet(QSPI_t *obj, uint32_t Address);
+static void QSPI_BlankMapUpdate(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t Blank);
+static uint8_t QSPI_Program(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
+static uint8_t QSPI_ReadDirect(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size);
+#if MX25R6435F_READ_CACHE
+static uint8_t QSPI_ReadCached(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size);
+#endif
+static void QSPI_ReadCacheInvalidate(QSPI_t *obj, uint32_t Address, uint32_t Size);
+static uint8_t QSPI_WriteDirect(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
+static uint8_t QSPI_SortVec(QSPI_IoVec *pVec, uint32_t Count);
+#if MX25R6435F_WRITE_CACHE
+static uint8_t QSPI_CacheWrite(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
+static uint8_t QSPI_CacheFlushSlot(QSPI_t *obj, QSPI_CacheSlot *pSlot);
+#endif
+static void QSPI_CacheMerge(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size);
+static void QSPI_CacheDiscard(QSPI_t *obj, uint32_t Address, uint32_t Size);
+static uint8_t QSPI_ProgramInPlace(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, uint8_t *pErase);
+static uint8_t QSPI_RewriteSector(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, uint8_t *pSector);
+static uint8_t QSPI_ReadStatus(XSPI_HandleTypeDef *hxspi);
+static uint8_t QSPI_SuspendMemory(XSPI_HandleTypeDef *hxspi);
+static uint8_t QSPI_ResumeMemory(XSPI_HandleTypeDef *hxspi);
+static uint8_t QSPI_ReadRegister(XSPI_HandleTypeDef *hxspi, QSPI_CmdTypeDef Cmd, uint8_t *pData, uint32_t Size);
+static uint8_t QSPI_ReadCommand(QSPI_t *obj, uint32_t Address, uint32_t NbData);
+static uint8_t QSPI_ExitContinuousRead(QSPI_t *obj);
+static uint8_t QSPI_MemoryMapped(QSPI_t *obj);
+static uint8_t QSPI_EnterIndirectMode(QSPI_t *obj);
+static uint8_t QSPI_RestoreMappedMode(QSPI_t *obj, uint8_t status);
 static uint8_t QSPI_ResetMemory(XSPI_HandleTypeDef *hxspi);
 static uint8_t QSPI_WriteEnable(XSPI_HandleTypeDef *hxspi);
+static uint8_t QSPI_AutoPolling(XSPI_HandleTypeDef *hxspi, const XSPI_AutoPollingTypeDef *pConfig, uint32_t Timeout);
 static uint8_t QSPI_AutoPollingMemReady(XSPI_HandleTypeDef *hxspi, uint32_t Timeout);
 static uint8_t QSPI_QuadMode(XSPI_HandleTypeDef *hxspi, uint8_t Operation);
 static uint8_t QSPI_HighPerfMode(XSPI_HandleTypeDef *hxspi, uint8_t Operation);
-static uint8_t qspi_setClockPrescaler(void);
+static uint8_t QSPI_ReadSFDP(XSPI_HandleTypeDef *hxspi, uint32_t Address, uint8_t *pData, uint32_t Size);
+static void QSPI_DefaultInfo(QSPI_Info *pInfo);
+static uint8_t QSPI_Discover(QSPI_t *obj);
+#ifdef OCTOSPI
+static uint8_t QSPI_SetTiming(XSPI_HandleTypeDef *hxspi, uint32_t ClockPrescaler, uint32_t SampleShifting, uint32_t DelayHoldQuarterCycle);
+static uint8_t QSPI_ReadPattern(XSPI_HandleTypeDef *hxspi, uint8_t *pSfdp, uint8_t *pData);
+#endif
+static uint32_t qspi_getKernelClock(void);
+static uint8_t qspi_setClockPrescaler(uint32_t MaxFreq);
+static uint8_t qspi_getIndex(XSPI_TypeDef *instance);
+static uint8_t *qspi_getMappedAddress(QSPI_t *obj);
+static uint8_t qspi_isErased(const uint8_t *pData, uint32_t Size);
+static QSPI_t *qspi_getObj(XSPI_HandleTypeDef *hxspi);
+static uint8_t QSPI_AutoPolling_IT(XSPI_HandleTypeDef *hxspi, const XSPI_AutoPollingTypeDef *pConfig);
+static uint8_t QSPI_ReadChunk_Async(QSPI_t *obj);
+static uint8_t QSPI_WritePage_Async(QSPI_t *obj);
+static uint8_t QSPI_AsyncNextVec(QSPI_t *obj);
+static uint8_t QSPI_AsyncPause(QSPI_t *obj);
+static uint8_t QSPI_AsyncRunning(QSPI_t *obj);
+static uint8_t QSPI_AsyncSuspend(QSPI_t *obj);
+static uint8_t QSPI_AsyncResume(QSPI_t *obj, uint8_t status);
+static void QSPI_AsyncNextStep(QSPI_t *obj);
+static void QSPI_AsyncComplete(QSPI_t *obj, uint8_t status);
+#if MX25R6435F_STATS
+static QSPI_StatsScope QSPI_StatsBegin(QSPI_t *obj, uint8_t Op, uint32_t Size);
+static void QSPI_StatsEnd(QSPI_StatsScope *pScope);
+static void QSPI_StatsAsync(QSPI_t *obj, QSPI_StatsScope *pScope);
+static void QSPI_StatsAsyncEnd(QSPI_t *obj);
+static void QSPI_StatsRecord(QSPI_t *obj, uint8_t Op, uint32_t Size, uint32_t Cycles);
+static uint32_t QSPI_StatsVecSize(const QSPI_IoVec *pVec, uint32_t Count);
+#endif
 
 /* Exported functions ---------------------------------------------------------*/
+/**
+  * @brief  Return the kernel clock frequency of the xSPI interface.
+  *         QSPI clock is connected to AHB bus clock. OCTOSPI clock has its
+  *         own source selection.
+  * @retval Kernel clock frequency in Hz
+  */
+static uint32_t qspi_getKernelClock(void)
+{
+#if defined(OCTOSPI) && defined(RCC_PERIPHCLK_OSPI)
+  uint32_t freq = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_OSPI);
+
+  if (freq != 0) {
+    return freq;
+  }
+#endif
+  return HAL_RCC_GetHCLKFreq();
+}
+
 /**
   * @brief  Select a prescaler to have a clock frequency lower than the maximum.
-  *         The MX25R6435F supports a maximum frequency of 80MHz.
-  *         QSPI clock is connected to AHB bus clock.
-  * @retval Clock prescaler. 0 means error.
+  *         The MX25R6435F supports a maximum frequency of 80MHz in high
+  *         performance mode.
+  * @param  MaxFreq : Maximum clock frequency of the memory
+  * @retval Clock prescaler (division factor of the kernel clock). 0 means error.
   */
-static uint8_t qspi_setClockPrescaler(void)
+static uint8_t qspi_setClockPrescaler(uint32_t MaxFreq)
 {
+  uint32_t freq = qspi_getKernelClock();
   uint8_t i;
 
   for (i = 1; i < 255; i++) {
-    if ((HAL_RCC_GetHCLKFreq() / i) <= 80000000) {
+    if ((freq / i) <= MaxFreq) {
       return i;
     }
   }
@@ -60,6 +361,110 @@ static uint8_t qspi_setClockPrescaler(void)
   return 0;
 }
 
+/**
+  * @brief  Return the index of the xSPI instance in the object table.
+  * @param  instance : xSPI instance
+  * @retval Index of the instance
+  */
+static uint8_t qspi_getIndex(XSPI_TypeDef *instance)
+{
+#if defined(OCTOSPI2)
+  if (instance == OCTOSPI2) {
+    return 1;
+  }
+#else
+  UNUSED(instance);
+#endif
+  return 0;
+}
+
+/**
+  * @brief  Return the address of the memory in memory-mapped mode.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval Base address of the mapped window
+  */
+static uint8_t *qspi_getMappedAddress(QSPI_t *obj)
+{
+#if defined(OCTOSPI2)
+  if (obj->qspi == OCTOSPI2) {
+    return (uint8_t *)OCTOSPI2_BASE;
+  }
+#else
+  UNUSED(obj);
+#endif
+#ifdef OCTOSPI
+  return (uint8_t *)OCTOSPI1_BASE;
+#else
+  return (uint8_t *)QSPI_BASE;
+#endif
+}
+
+/**
+  * @brief  Check that a buffer only contains erased bytes (0xFF). The bytes
+  *         are compared by 32-bit words.
+  * @param  pData : Pointer to the data
+  * @param  Size  : Size of the data
+  * @retval 1 if all the bytes are erased, else 0
+  */
+static uint8_t qspi_isErased(const uint8_t *pData, uint32_t Size)
+{
+  const uint32_t *word;
+
+  /* Bytes up to the first word boundary */
+  while ((Size > 0) && (((uintptr_t)pData & 0x3) != 0)) {
+    if (*pData != 0xFF) {
+      return 0;
+    }
+    pData++;
+    Size--;
+  }
+
+  /* 4 words at once */
+  word = (const uint32_t *)pData;
+  while (Size >= 16) {
+    if ((word[0] & word[1] & word[2] & word[3]) != 0xFFFFFFFF) {
+      return 0;
+    }
+    word += 4;
+    Size -= 16;
+  }
+
+  /* Remaining words and bytes */
+  while (Size >= 4) {
+    if (*word != 0xFFFFFFFF) {
+      return 0;
+    }
+    word++;
+    Size -= 4;
+  }
+
+  pData = (const uint8_t *)word;
+  while (Size > 0) {
+    if (*pData != 0xFF) {
+      return 0;
+    }
+    pData++;
+    Size--;
+  }
+
+  return 1;
+}
+
+/**
+  * @brief  Return the object owning a xSPI handle.
+  * @param  hxspi : QSPI handle
+  * @retval pointer to QSPI_t structure, NULL if the handle is not used by this driver
+  */
+static QSPI_t *qspi_getObj(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_t *obj = qspi_obj[qspi_getIndex(hxspi->Instance)];
+
+  if ((obj != NULL) && (&(obj->handle) == hxspi)) {
+    return obj;
+  }
+  return NULL;
+}
+
 /**
   * @brief  Initializes the QSPI interface.
   * @param  obj : pointer to QSPI_t structure
@@ -101,6 +506,46 @@ uint8_t BSP_QSPI_Init(QSPI_t *obj)
   }
 
   handle->Instance = obj->qspi;
+  obj->async_op = QSPI_ASYNC_NONE;
+  obj->async_pause = QSPI_ASYNC_RUNNING;
+  /* A failed read leaves its erase suspended */
+  obj->erase_suspended = 0;
+  obj->continuous_read = 0;
+  obj->enhanced = 0;
+  obj->mapped = 0;
+  obj->erase_pending = 0;
+  obj->erase_suspended = 0;
+  QSPI_DefaultInfo(&(obj->info));
+#if MX25R6435F_STATS
+  /* Start the cycle counter measuring the operations */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#ifdef DWT_LSR_SLK_Msk
+  if ((DWT->LSR & DWT_LSR_SLK_Msk) != 0) {
+    DWT->LAR = 0xC5ACCE55;
+  }
+#endif
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  memset(&(obj->stats), 0, sizeof(obj->stats));
+  obj->stats_depth = 0;
+  obj->stats_async_op = QSPI_STATS_NONE;
+#endif
+#if MX25R6435F_BLANK_MAP
+  memset(obj->blank_map, 0, sizeof(obj->blank_map));
+#endif
+#if MX25R6435F_WRITE_CACHE
+  for (uint8_t i = 0; i < MX25R6435F_WRITE_CACHE; i++) {
+    obj->wcache[i].addr = QSPI_CACHE_FREE;
+  }
+  obj->wcache_stamp = 0;
+#endif
+#if MX25R6435F_READ_CACHE
+  for (uint8_t i = 0; i < MX25R6435F_READ_CACHE; i++) {
+    obj->rcache_addr[i] = QSPI_CACHE_FREE;
+  }
+  obj->rcache_next = QSPI_CACHE_FREE;
+  obj->rcache_slot = 0;
+#endif
+  qspi_obj[qspi_getIndex(obj->qspi)] = obj;
 
   /* Call the DeInit function to reset the driver */
   if (HAL_XSPI_DeInit(handle) != HAL_OK) {
@@ -119,7 +564,7 @@ uint8_t BSP_QSPI_Init(QSPI_t *obj)
   handle->Init.ChipSelectHighTime    = 1;
   handle->Init.FreeRunningClock      = HAL_OSPI_FREERUNCLK_DISABLE;
   handle->Init.ClockMode             = HAL_OSPI_CLOCK_MODE_0;
-  handle->Init.ClockPrescaler        = 4; /* QSPI clock = 110MHz / ClockPrescaler = 27.5 MHz */
+  handle->Init.ClockPrescaler        = qspi_setClockPrescaler(MX25R6435F_LOW_POWER_MAX_FREQ); /* OSPI clock = kernel clock / ClockPrescaler */
   handle->Init.SampleShifting        = HAL_OSPI_SAMPLE_SHIFTING_NONE;
   handle->Init.DelayHoldQuarterCycle = HAL_OSPI_DHQC_ENABLE;
   handle->Init.ChipSelectBoundary    = 0;
@@ -127,7 +572,7 @@ uint8_t BSP_QSPI_Init(QSPI_t *obj)
 #else /* OCTOSPI */
   /* QSPI initialization */
   /* High performance mode clock is limited to 80 MHz */
-  handle->Init.ClockPrescaler     = qspi_setClockPrescaler() + 1; /* QSPI clock = systemCoreClock / (ClockPrescaler+1) */
+  handle->Init.ClockPrescaler     = qspi_setClockPrescaler(MX25R6435F_HIGH_PERF_MAX_FREQ) + 1; /* QSPI clock = systemCoreClock / (ClockPrescaler+1) */
   handle->Init.FifoThreshold      = 4;
   handle->Init.SampleShifting     = QSPI_SAMPLE_SHIFTING_NONE;
   handle->Init.FlashSize          = POSITION_VAL(MX25R6435F_FLASH_SIZE) - 1;
@@ -154,9 +599,24 @@ uint8_t BSP_QSPI_Init(QSPI_t *obj)
     return QSPI_ERROR;
   }
 
-  /* Re-configure the clock for the high performance mode */
+  /* Read the size and the parameters of the memory */
+  if (QSPI_Discover(obj) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Re-configure the clock for the high performance mode and the memory size */
   /* High performance mode clock is limited to 80 MHz */
-  handle->Init.ClockPrescaler = qspi_setClockPrescaler(); /* QSPI clock = systemCoreClock / (ClockPrescaler+1) */
+#ifdef OCTOSPI
+  handle->Init.DeviceSize = POSITION_VAL(obj->info.FlashSize);
+
+  /* The OSPI configuration is only applied from the reset state */
+  if (QSPI_SetTiming(handle, qspi_setClockPrescaler(MX25R6435F_HIGH_PERF_MAX_FREQ),
+                     handle->Init.SampleShifting, handle->Init.DelayHoldQuarterCycle) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+#else /* OCTOSPI */
+  handle->Init.ClockPrescaler = qspi_setClockPrescaler(MX25R6435F_HIGH_PERF_MAX_FREQ); /* QSPI clock = systemCoreClock / (ClockPrescaler+1) */
+  handle->Init.FlashSize      = POSITION_VAL(obj->info.FlashSize) - 1;
 
   if (HAL_XSPI_Init(handle) != HAL_OK) {
     return QSPI_ERROR;
@@ -165,6 +625,12 @@ uint8_t BSP_QSPI_Init(QSPI_t *obj)
   if (HAL_XSPI_Init(handle) != HAL_OK) {
     return QSPI_ERROR;
   }
+#endif /* OCTOSPI */
+
+  /* Read the table of the retired sectors */
+  if (QSPI_RetiredLoad(obj) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
 
   return QSPI_OK;
 }
@@ -178,6 +644,13 @@ uint8_t BSP_QSPI_DeInit(QSPI_t *obj)
 {
   XSPI_HandleTypeDef *handle = &(obj->handle);
 
+  /* Program the data still in the write cache */
+  BSP_QSPI_Flush(obj);
+
+  /* Leave the memory-mapped mode and the continuous read mode */
+  QSPI_EnterIndirectMode(obj);
+  obj->mapped = 0;
+
   /* Call the DeInit function to reset the driver */
   if (HAL_XSPI_DeInit(handle) != HAL_OK) {
     return QSPI_ERROR;
@@ -186,6 +659,9 @@ uint8_t BSP_QSPI_DeInit(QSPI_t *obj)
   /* System level De-initialization */
   BSP_QSPI_MspDeInit(obj);
 
+  obj->async_op = QSPI_ASYNC_NONE;
+  qspi_obj[qspi_getIndex(obj->qspi)] = NULL;
+
   return QSPI_OK;
 }
 
@@ -196,64 +672,64 @@ uint8_t BSP_QSPI_DeInit(QSPI_t *obj)
   * @param  ReadAddr : Read start address
   * @param  Size     : Size of data to read
   * @retval QSPI memory status
+  * @note With MX25R6435F_READ_CACHE, the reads smaller than a cache line are
+  *       served by the read cache. A running asynchronous erase or write is
+  *       suspended during the read.
   */
 uint8_t BSP_QSPI_Read(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the read command */
-  sCommand.OperationType         = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId               = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction           = QUAD_INOUT_READ_CMD;
-  sCommand.InstructionMode       = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize       = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode    = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.Address               = ReadAddr;
-  sCommand.AddressMode           = HAL_OSPI_ADDRESS_4_LINES;
-  sCommand.AddressSize           = HAL_OSPI_ADDRESS_24_BITS;
-  sCommand.AddressDtrMode        = HAL_OSPI_ADDRESS_DTR_DISABLE;
-  sCommand.AlternateBytes        = MX25R6435F_ALT_BYTES_NO_PE_MODE;
-  sCommand.AlternateBytesMode    = HAL_OSPI_ALTERNATE_BYTES_4_LINES;
-  sCommand.AlternateBytesSize    = HAL_OSPI_ALTERNATE_BYTES_8_BITS;
-  sCommand.AlternateBytesDtrMode = HAL_OSPI_ALTERNATE_BYTES_DTR_DISABLE;
-  sCommand.DataMode              = HAL_OSPI_DATA_4_LINES;
-  sCommand.NbData                = Size;
-  sCommand.DataDtrMode           = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles           = MX25R6435F_DUMMY_CYCLES_READ_QUAD;
-  sCommand.DQSMode               = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode              = HAL_OSPI_SIOO_INST_EVERY_CMD;
+  uint8_t suspended;
+  uint8_t status;
 
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the read command */
-  sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction        = QUAD_INOUT_READ_CMD;
-  sCommand.AddressMode        = QSPI_ADDRESS_4_LINES;
-  sCommand.AddressSize        = QSPI_ADDRESS_24_BITS;
-  sCommand.Address            = ReadAddr;
-  sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
-  sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-  sCommand.AlternateBytes     = MX25R6435F_ALT_BYTES_NO_PE_MODE;
-  sCommand.DataMode           = QSPI_DATA_4_LINES;
-  sCommand.DummyCycles        = MX25R6435F_DUMMY_CYCLES_READ_QUAD;
-  sCommand.NbData             = Size;
-  sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  QSPI_STATS(obj, QSPI_STATS_READ, Size);
 
-  /* Configure the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  /* Suspend the asynchronous erase or write for the time of the read */
+  if (QSPI_AsyncRunning(obj) != 0) {
+    status = QSPI_AsyncSuspend(obj);
+    if (status == QSPI_OK) {
+      status = BSP_QSPI_Read(obj, pData, ReadAddr, Size);
+    }
+    return QSPI_AsyncResume(obj, status);
   }
 
-  /* Reception of the data */
-  if (HAL_XSPI_Receive(handle, pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  /* Same for a sector erase started without waiting */
+  if (obj->erase_pending != 0) {
+    status = QSPI_EraseSuspend(obj, &suspended);
+    if ((status == QSPI_OK) && (suspended != 0)) {
+      status = BSP_QSPI_Read(obj, pData, ReadAddr, Size);
+      return QSPI_EraseResume(obj, status);
+    }
+    if (status != QSPI_OK) {
+      return status;
+    }
+  }
+
+  /* Copy the data from the mapped window */
+  if (HAL_XSPI_GetState(&(obj->handle)) == HAL_XSPI_STATE_BUSY_MEM_MAPPED) {
+    if ((ReadAddr > obj->info.FlashSize) || (Size > (obj->info.FlashSize - ReadAddr))) {
+      return QSPI_ERROR;
+    }
+    memcpy(pData, qspi_getMappedAddress(obj) + ReadAddr, Size);
+    return QSPI_OK;
+  }
+
+#if MX25R6435F_READ_CACHE
+  /* The data of a suspended erase or write are not cached */
+  if ((Size < MX25R6435F_READ_CACHE_LINE_SIZE) && (obj->async_op == QSPI_ASYNC_NONE) && (obj->erase_pending == 0)) {
+    status = QSPI_ReadCached(obj, pData, ReadAddr, Size);
+  } else {
+    status = QSPI_ReadDirect(obj, pData, ReadAddr, Size);
   }
+#else
+  status = QSPI_ReadDirect(obj, pData, ReadAddr, Size);
+#endif
+
+  if (status != QSPI_OK) {
+    return status;
+  }
+
+  /* Apply the data not yet programmed */
+  QSPI_CacheMerge(obj, pData, ReadAddr, Size);
 
   return QSPI_OK;
 }
@@ -265,1196 +741,3873 @@ uint8_t BSP_QSPI_Read(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t S
   * @param  WriteAddr : Write start address
   * @param  Size      : Size of data to write
   * @retval QSPI memory status
+  * @note With MX25R6435F_WRITE_CACHE, the data may only be programmed by a
+  *       later write or BSP_QSPI_Flush().
   */
 uint8_t BSP_QSPI_Write(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
-  uint32_t end_addr, current_size, current_addr;
+  QSPI_STATS(obj, QSPI_STATS_WRITE, Size);
 
-  /* Calculation of the size between the write address and the end of the page */
-  current_size = MX25R6435F_PAGE_SIZE - (WriteAddr % MX25R6435F_PAGE_SIZE);
+  QSPI_BlankMapUpdate(obj, WriteAddr, Size, 0);
 
-  /* Check if the size of the data is less than the remaining place in the page */
-  if (current_size > Size) {
-    current_size = Size;
+#if MX25R6435F_WRITE_CACHE
+  if (obj->mapped == 0) {
+    return QSPI_CacheWrite(obj, pData, WriteAddr, Size);
   }
+#endif
 
-  /* Initialize the adress variables */
-  current_addr = WriteAddr;
-  end_addr = WriteAddr + Size;
+  return QSPI_WriteDirect(obj, pData, WriteAddr, Size);
+}
 
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the program command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = QUAD_PAGE_PROG_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_4_LINES;
-  sCommand.AddressSize        = HAL_OSPI_ADDRESS_24_BITS;
-  sCommand.AddressDtrMode     = HAL_OSPI_ADDRESS_DTR_DISABLE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_4_LINES;
-  sCommand.DataDtrMode        = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the program command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = QUAD_PAGE_PROG_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_4_LINES;
-  sCommand.AddressSize       = QSPI_ADDRESS_24_BITS;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_4_LINES;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+/**
+  * @brief  Programs the data kept in the write cache and saves the table of
+  *         the retired sectors if it changed.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+uint8_t BSP_QSPI_Flush(QSPI_t *obj)
+{
+  QSPI_STATS(obj, QSPI_STATS_FLUSH, 0);
 
-  /* Perform the write page by page */
-  do {
-    sCommand.Address = current_addr;
-    sCommand.NbData  = current_size;
+#if MX25R6435F_WRITE_CACHE || MX25R6435F_RETIRED_TABLE
+  uint8_t status = QSPI_OK;
 
-    /* Enable write operations */
-    if (QSPI_WriteEnable(handle) != QSPI_OK) {
-      return QSPI_ERROR;
-    }
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
 
-    /* Configure the command */
-    if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-      return QSPI_ERROR;
+#if MX25R6435F_WRITE_CACHE
+  for (uint8_t i = 0; i < MX25R6435F_WRITE_CACHE; i++) {
+    if (QSPI_CacheFlushSlot(obj, &(obj->wcache[i])) != QSPI_OK) {
+      status = QSPI_ERROR;
     }
+  }
+#endif
 
-    /* Transmission of the data */
-    if (HAL_XSPI_Transmit(handle, pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-      return QSPI_ERROR;
-    }
+#if MX25R6435F_RETIRED_TABLE
+  /* Save the sectors retired since the last flush */
+  if (obj->retired_dirty != 0) {
+    uint8_t erase = QSPI_EnterIndirectMode(obj);
 
-    /* Configure automatic polling mode to wait for end of program */
-    if (QSPI_AutoPollingMemReady(handle, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
-      return QSPI_ERROR;
+    if (erase == QSPI_OK) {
+      erase = QSPI_EraseCheck(obj);
+    }
+    if (erase == QSPI_OK) {
+      QSPI_RetiredSave(obj);
+    } else {
+      status = erase;
     }
+    status = QSPI_RestoreMappedMode(obj, status);
+  }
+#endif
 
-    /* Update the address and size variables for next page programming */
-    current_addr += current_size;
-    pData += current_size;
-    current_size = ((current_addr + MX25R6435F_PAGE_SIZE) > end_addr) ? (end_addr - current_addr) : MX25R6435F_PAGE_SIZE;
-  } while (current_addr < end_addr);
+  return status;
+#else
+  UNUSED(obj);
 
   return QSPI_OK;
+#endif
 }
 
 /**
-  * @brief  Erases the specified block of the QSPI memory.
+  * @brief  Writes an amount of data to the QSPI memory, taking the content of
+  *         the memory into account: the pages already holding the data are
+  *         skipped and the pages where bits only go from 1 to 0 are programmed
+  *         without erase. A sector is erased and rewritten only when a bit has
+  *         to go from 0 to 1.
   * @param  obj : pointer to QSPI_t structure
-  * @param  BlockAddress : Block address to erase
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write
+  * @param  pSector   : Buffer of EraseSectorSize bytes to keep the rest of a
+  *                     sector to erase. If NULL, a sector to erase is an error.
   * @retval QSPI memory status
   */
-uint8_t BSP_QSPI_Erase_Block(QSPI_t *obj, uint32_t BlockAddress)
+uint8_t BSP_QSPI_Program(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, uint8_t *pSector)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = BLOCK_ERASE_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.Address            = BlockAddress;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_1_LINE;
-  sCommand.AddressSize        = HAL_OSPI_ADDRESS_24_BITS;
-  sCommand.AddressDtrMode     = HAL_OSPI_ADDRESS_DTR_DISABLE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = BLOCK_ERASE_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_1_LINE;
-  sCommand.AddressSize       = QSPI_ADDRESS_24_BITS;
-  sCommand.Address           = BlockAddress;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  uint32_t sector_size = obj->info.EraseSectorSize;
+  uint32_t current_size;
+  uint8_t erase;
 
-  /* Enable write operations */
-  if (QSPI_WriteEnable(handle) != QSPI_OK) {
+  QSPI_STATS(obj, QSPI_STATS_PROGRAM, Size);
+
+  if ((pData == NULL) || (WriteAddr > obj->info.FlashSize) || (Size > (obj->info.FlashSize - WriteAddr))) {
     return QSPI_ERROR;
   }
 
-  /* Send the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  /* Configure automatic polling mode to wait for end of erase */
-  if (QSPI_AutoPollingMemReady(handle, MX25R6435F_BLOCK_ERASE_MAX_TIME) != QSPI_OK) {
-    return QSPI_ERROR;
+  while (Size > 0) {
+    current_size = sector_size - (WriteAddr % sector_size);
+    if (current_size > Size) {
+      current_size = Size;
+    }
+
+    if (QSPI_ProgramInPlace(obj, pData, WriteAddr, current_size, &erase) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    if ((erase != 0) && (QSPI_RewriteSector(obj, pData, WriteAddr, current_size, pSector) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+
+    pData     += current_size;
+    WriteAddr += current_size;
+    Size      -= current_size;
   }
+
   return QSPI_OK;
 }
 
 /**
-  * @brief  Erases the specified sector of the QSPI memory.
+  * @brief  Reads an amount of data from the QSPI memory without blocking.
   * @param  obj : pointer to QSPI_t structure
-  * @param  Sector : Sector address to erase (0 to 255)
+  * @param  pData    : Pointer to data to be read
+  * @param  ReadAddr : Read start address
+  * @param  Size     : Size of data to read
+  * @param  Callback : Function called from interrupt when the read is completed
+  * @param  Context  : Parameter given to the callback
   * @retval QSPI memory status
-  * @note This function is non blocking meaning that sector erase
-  *       operation is started but not completed when the function
-  *       returns. Application has to call BSP_QSPI_GetStatus()
-  *       to know when the device is available again (i.e. erase operation
-  *       completed).
+  * @note The data are moved by the DMA if MX25R6435F_DMA is enabled, else
+  *       by interrupt. pData must remain valid until the callback is called.
+  *       A sector erase started without waiting is suspended during the
+  *       read. If the read fails, BSP_QSPI_ResumeErase() resumes it.
   */
-uint8_t BSP_QSPI_Erase_Sector(QSPI_t *obj, uint32_t Sector)
+uint8_t BSP_QSPI_Read_Async(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size, QSPI_Callback Callback, void *Context)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t status;
+
+  QSPI_STATS(obj, QSPI_STATS_READ_ASYNC, Size);
 
-  if (Sector >= (uint32_t)(MX25R6435F_FLASH_SIZE / MX25R6435F_SECTOR_SIZE)) {
+  if ((pData == NULL) || (Size == 0) || (ReadAddr > obj->info.FlashSize) || (Size > (obj->info.FlashSize - ReadAddr))) {
     return QSPI_ERROR;
   }
 
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = SECTOR_ERASE_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.Address            = (Sector * MX25R6435F_SECTOR_SIZE);
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_1_LINE;
-  sCommand.AddressSize        = HAL_OSPI_ADDRESS_24_BITS;
-  sCommand.AddressDtrMode     = HAL_OSPI_ADDRESS_DTR_DISABLE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = SECTOR_ERASE_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_1_LINE;
-  sCommand.AddressSize       = QSPI_ADDRESS_24_BITS;
-  sCommand.Address           = (Sector * MX25R6435F_SECTOR_SIZE);
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
 
-  /* Enable write operations */
-  if (QSPI_WriteEnable(handle) != QSPI_OK) {
+  /* The transfer reads the memory directly */
+  if ((BSP_QSPI_Flush(obj) != QSPI_OK) || (QSPI_EraseSuspendAsync(obj) != QSPI_OK)) {
     return QSPI_ERROR;
   }
 
-  /* Send the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  /* Copy the data from the mapped window */
+  if (HAL_XSPI_GetState(&(obj->handle)) == HAL_XSPI_STATE_BUSY_MEM_MAPPED) {
+    memcpy(pData, qspi_getMappedAddress(obj) + ReadAddr, Size);
+    status = QSPI_EraseResumeAsync(obj, QSPI_OK);
+    if (Callback != NULL) {
+      Callback(status, Context);
+    }
+    return status;
+  }
+
+  obj->async_op      = QSPI_ASYNC_READ;
+  obj->async_count   = 0;
+  obj->async_data    = pData;
+  obj->async_addr    = ReadAddr;
+  obj->async_end     = ReadAddr + Size;
+  obj->async_cb      = Callback;
+  obj->async_context = Context;
+
+  QSPI_STATS_ASYNC(obj);
+
+  /* Start the transfer of the first chunk, the next ones are chained from interrupt */
+  if (QSPI_ReadChunk_Async(obj) != QSPI_OK) {
+    obj->async_op = QSPI_ASYNC_NONE;
+    return QSPI_EraseResumeAsync(obj, QSPI_ERROR);
   }
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  Erases the entire QSPI memory.
+  * @brief  Writes an amount of data to the QSPI memory without blocking.
   * @param  obj : pointer to QSPI_t structure
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write
+  * @param  Callback  : Function called from interrupt when the write is completed
+  * @param  Context   : Parameter given to the callback
   * @retval QSPI memory status
+  * @note Each page is programmed by an interrupt driven sequence:
+  *       write enable, write enable latch polling, page program and
+  *       end of program polling. The CPU never waits for the memory,
+  *       except for the end of a sector erase started without waiting.
+  *       pData must remain valid until the callback is called.
   */
-uint8_t BSP_QSPI_Erase_Chip(QSPI_t *obj)
+uint8_t BSP_QSPI_Write_Async(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, QSPI_Callback Callback, void *Context)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t status;
 
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = CHIP_ERASE_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = CHIP_ERASE_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  QSPI_STATS(obj, QSPI_STATS_WRITE_ASYNC, Size);
 
-  /* Enable write operations */
-  if (QSPI_WriteEnable(handle) != QSPI_OK) {
+  if ((pData == NULL) || (Size == 0)) {
     return QSPI_ERROR;
   }
 
-  /* Send the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  /* Configure automatic polling mode to wait for end of erase */
-  if (QSPI_AutoPollingMemReady(handle, MX25R6435F_CHIP_ERASE_MAX_TIME) != QSPI_OK) {
-    return QSPI_ERROR;
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  /* The memory ignores the command while a sector erase started without
+     waiting is running: wait for its end */
+  status = QSPI_EraseCheck(obj);
+  if (status != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, status);
+  }
+
+  QSPI_BlankMapUpdate(obj, WriteAddr, Size, 0);
+  QSPI_ReadCacheInvalidate(obj, WriteAddr, Size);
+
+  obj->async_op      = QSPI_ASYNC_WRITE;
+  obj->async_step    = QSPI_ASYNC_STEP_WREN;
+  obj->async_resume_tick = HAL_GetTick();
+  obj->async_retry   = 0;
+  obj->async_cmd     = QSPI_CMD_PAGE_PROG;
+  obj->async_count   = 0;
+  obj->async_data    = pData;
+  obj->async_addr    = WriteAddr;
+  obj->async_end     = WriteAddr + Size;
+  obj->async_cb      = Callback;
+  obj->async_context = Context;
+
+  QSPI_STATS_ASYNC(obj);
+
+  /* Start the sequence of the first page, the next steps are chained from interrupt */
+  if (QSPI_Command_IT(&(obj->handle), QSPI_CMD_WRITE_ENABLE, 0) != QSPI_OK) {
+    obj->async_op = QSPI_ASYNC_NONE;
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
   }
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  Reads current status of the QSPI memory.
+  * @brief  Reads several areas of the QSPI memory. The areas are sorted by
+  *         address and the close ones are read by a single command.
   * @param  obj : pointer to QSPI_t structure
+  * @param  pVec  : Array of the areas to read, sorted in place by the function
+  * @param  Count : Number of areas
   * @retval QSPI memory status
   */
-uint8_t BSP_QSPI_GetStatus(QSPI_t *obj)
+uint8_t BSP_QSPI_ReadV(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
-  uint8_t reg;
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the read security register command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = READ_SEC_REG_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_1_LINE;
-  sCommand.NbData             = 1;
-  sCommand.DataDtrMode        = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the read security register command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = READ_SEC_REG_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_1_LINE;
-  sCommand.DummyCycles       = 0;
-  sCommand.NbData            = 1;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  uint8_t buffer[QSPI_VEC_BUFFER_SIZE];
+  uint32_t first, last, start, end, i;
+  uint8_t suspended;
+  uint8_t status;
+
+  QSPI_STATS(obj, QSPI_STATS_READV, QSPI_StatsVecSize(pVec, Count));
+
+  /* Suspend the asynchronous erase or write once for all the areas */
+  if (QSPI_AsyncRunning(obj) != 0) {
+    status = QSPI_AsyncSuspend(obj);
+    if (status == QSPI_OK) {
+      status = BSP_QSPI_ReadV(obj, pVec, Count);
+    }
+    return QSPI_AsyncResume(obj, status);
+  }
 
-  /* Configure the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
-
-  /* Reception of the data */
-  if (HAL_XSPI_Receive(handle, &reg, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (obj->erase_pending != 0) {
+    status = QSPI_EraseSuspend(obj, &suspended);
+    if ((status == QSPI_OK) && (suspended != 0)) {
+      status = BSP_QSPI_ReadV(obj, pVec, Count);
+      return QSPI_EraseResume(obj, status);
+    }
+    if (status != QSPI_OK) {
+      return status;
+    }
   }
 
-  /* Check the value of the register */
-  if ((reg & (MX25R6435F_SECR_P_FAIL | MX25R6435F_SECR_E_FAIL)) != 0) {
+  if (QSPI_SortVec(pVec, Count) != QSPI_OK) {
     return QSPI_ERROR;
-  } else if ((reg & (MX25R6435F_SECR_PSB | MX25R6435F_SECR_ESB)) != 0) {
-    return QSPI_SUSPENDED;
   }
 
-  /* Initialize the read status register command */
-  sCommand.Instruction = READ_STATUS_REG_CMD;
+  for (first = 0; first < Count; first = last) {
+    start = pVec[first].Address;
+    end = start + pVec[first].Size;
+
+    /* An area larger than the buffer is read alone, the areas it contains
+       are copied from its data */
+    if ((end - start) > QSPI_VEC_BUFFER_SIZE) {
+      if (BSP_QSPI_Read(obj, pVec[first].pData, start, end - start) != QSPI_OK) {
+        return QSPI_ERROR;
+      }
+      for (last = first + 1; (last < Count) && ((pVec[last].Address + pVec[last].Size) <= end); last++) {
+        memmove(pVec[last].pData, pVec[first].pData + (pVec[last].Address - start), pVec[last].Size);
+      }
+      continue;
+    }
 
-  /* Configure the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+    /* Gather the next areas fitting in the buffer with a small gap, the
+       whole span stays within the buffer */
+    for (last = first + 1; last < Count; last++) {
+      if (pVec[last].Address > (end + QSPI_VEC_MAX_GAP)) {
+        break;
+      }
+      if ((pVec[last].Address + pVec[last].Size) > end) {
+        if ((pVec[last].Address + pVec[last].Size - start) > QSPI_VEC_BUFFER_SIZE) {
+          break;
+        }
+        end = pVec[last].Address + pVec[last].Size;
+      }
+    }
 
-  /* Reception of the data */
-  if (HAL_XSPI_Receive(handle, &reg, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+    if (last == (first + 1)) {
+      if ((end > start) && (BSP_QSPI_Read(obj, pVec[first].pData, start, end - start) != QSPI_OK)) {
+        return QSPI_ERROR;
+      }
+    } else {
+      if (BSP_QSPI_Read(obj, buffer, start, end - start) != QSPI_OK) {
+        return QSPI_ERROR;
+      }
+      for (i = first; i < last; i++) {
+        memcpy(pVec[i].pData, buffer + (pVec[i].Address - start), pVec[i].Size);
+      }
+    }
   }
 
-  /* Check the value of the register */
-  if ((reg & MX25R6435F_SR_WIP) != 0) {
-    return QSPI_BUSY;
-  } else {
-    return QSPI_OK;
-  }
+  return QSPI_OK;
 }
 
 /**
-  * @brief  Return the configuration of the QSPI memory.
-  * @param  pInfo : pointer on the configuration structure
+  * @brief  Writes several areas of the QSPI memory. The areas are sorted by
+  *         address and the data falling in the same page are programmed
+  *         together.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pVec  : Array of the areas to write, sorted in place by the function
+  * @param  Count : Number of areas
   * @retval QSPI memory status
+  * @note The overlapping data are ANDed, as when written one after the other.
   */
-uint8_t BSP_QSPI_GetInfo(QSPI_Info *pInfo)
+uint8_t BSP_QSPI_WriteV(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count)
 {
-  /* Configure the structure with the memory configuration */
-  pInfo->FlashSize          = MX25R6435F_FLASH_SIZE;
-  pInfo->EraseSectorSize    = MX25R6435F_SECTOR_SIZE;
-  pInfo->EraseSectorsNumber = (MX25R6435F_FLASH_SIZE / MX25R6435F_SECTOR_SIZE);
-  pInfo->ProgPageSize       = MX25R6435F_PAGE_SIZE;
-  pInfo->ProgPagesNumber    = (MX25R6435F_FLASH_SIZE / MX25R6435F_PAGE_SIZE);
+  uint8_t page[MX25R6435F_PAGE_SIZE];
+  uint32_t page_addr = QSPI_CACHE_FREE;
+  uint32_t low = 0, high = 0;
+  uint32_t addr, size, offset, current_size, i, j;
+  uint8_t *data;
+
+  QSPI_STATS(obj, QSPI_STATS_WRITEV, QSPI_StatsVecSize(pVec, Count));
+
+  if (QSPI_SortVec(pVec, Count) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  for (i = 0; i <= Count; i++) {
+    addr = (i < Count) ? pVec[i].Address : QSPI_CACHE_FREE;
+    data = (i < Count) ? pVec[i].pData : NULL;
+    size = (i < Count) ? pVec[i].Size : 1;
+
+    while (size > 0) {
+      offset = addr % MX25R6435F_PAGE_SIZE;
+
+      /* Program the gathered data when the next data is in another page */
+      if ((addr - offset) != page_addr) {
+        if ((page_addr != QSPI_CACHE_FREE) &&
+            (BSP_QSPI_Write(obj, page + low, page_addr + low, high - low) != QSPI_OK)) {
+          return QSPI_ERROR;
+        }
+        if (i == Count) {
+          break;
+        }
+        page_addr = addr - offset;
+        memset(page, 0xFF, MX25R6435F_PAGE_SIZE);
+        low = offset;
+        high = offset;
+      }
+
+      current_size = MX25R6435F_PAGE_SIZE - offset;
+      if (current_size > size) {
+        current_size = size;
+      }
+
+      for (j = 0; j < current_size; j++) {
+        page[offset + j] &= data[j];
+      }
+      if (offset < low) {
+        low = offset;
+      }
+      if ((offset + current_size) > high) {
+        high = offset + current_size;
+      }
+
+      data += current_size;
+      addr += current_size;
+      size -= current_size;
+    }
+  }
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  Configure the QSPI in memory-mapped mode
+  * @brief  Reads several areas of the QSPI memory without blocking. The areas
+  *         are sorted by address and read one after the other by the same
+  *         asynchronous operation.
   * @param  obj : pointer to QSPI_t structure
+  * @param  pVec     : Array of the areas to read, sorted in place by the function
+  * @param  Count    : Number of areas
+  * @param  Callback : Function called from interrupt when the reads are completed
+  * @param  Context  : Parameter given to the callback
   * @retval QSPI memory status
+  * @note pVec and the buffers must remain valid until the callback is called.
+  *       A sector erase started without waiting is suspended during the
+  *       reads, as with BSP_QSPI_Read_Async().
   */
-uint8_t BSP_QSPI_EnableMemoryMappedMode(QSPI_t *obj)
+uint8_t BSP_QSPI_ReadV_Async(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count, QSPI_Callback Callback, void *Context)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t status;
+  uint32_t i;
 
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef      sCommand;
-  OSPI_MemoryMappedTypeDef sMemMappedCfg;
+  QSPI_STATS(obj, QSPI_STATS_READV_ASYNC, QSPI_StatsVecSize(pVec, Count));
 
-  /* Configure the command for the read instruction */
-  sCommand.OperationType         = HAL_OSPI_OPTYPE_READ_CFG;
-  sCommand.FlashId               = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction           = QUAD_INOUT_READ_CMD;
-  sCommand.InstructionMode       = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize       = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode    = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode           = HAL_OSPI_ADDRESS_4_LINES;
-  sCommand.AddressSize           = HAL_OSPI_ADDRESS_24_BITS;
-  sCommand.AddressDtrMode        = HAL_OSPI_ADDRESS_DTR_DISABLE;
-  sCommand.AlternateBytes        = MX25R6435F_ALT_BYTES_NO_PE_MODE;
-  sCommand.AlternateBytesMode    = HAL_OSPI_ALTERNATE_BYTES_4_LINES;
-  sCommand.AlternateBytesSize    = HAL_OSPI_ALTERNATE_BYTES_8_BITS;
-  sCommand.AlternateBytesDtrMode = HAL_OSPI_ALTERNATE_BYTES_DTR_DISABLE;
-  sCommand.DataMode              = HAL_OSPI_DATA_4_LINES;
-  sCommand.DataDtrMode           = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles           = MX25R6435F_DUMMY_CYCLES_READ_QUAD;
-  sCommand.DQSMode               = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode              = HAL_OSPI_SIOO_INST_EVERY_CMD;
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
 
-  /* Configure the command */
-  if (HAL_OSPI_Command(handle, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  if (QSPI_SortVec(pVec, Count) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
-  /* Configure the command for the program instruction */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_WRITE_CFG;
-  sCommand.Instruction        = QUAD_PAGE_PROG_CMD;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DummyCycles        = 0;
+  for (i = 0; i < Count; i++) {
+    if ((pVec[i].Address > obj->info.FlashSize) || (pVec[i].Size > (obj->info.FlashSize - pVec[i].Address))) {
+      return QSPI_ERROR;
+    }
+  }
 
-  /* Configure the command */
-  if (HAL_OSPI_Command(handle, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  /* The transfer reads the memory directly */
+  if ((BSP_QSPI_Flush(obj) != QSPI_OK) || (QSPI_EraseSuspendAsync(obj) != QSPI_OK)) {
     return QSPI_ERROR;
   }
 
-  /* Configure the memory mapped mode */
-  sMemMappedCfg.TimeOutActivation = HAL_OSPI_TIMEOUT_COUNTER_DISABLE;
+  /* Copy the data from the mapped window */
+  if (HAL_XSPI_GetState(&(obj->handle)) == HAL_XSPI_STATE_BUSY_MEM_MAPPED) {
+    for (i = 0; i < Count; i++) {
+      memcpy(pVec[i].pData, qspi_getMappedAddress(obj) + pVec[i].Address, pVec[i].Size);
+    }
+    status = QSPI_EraseResumeAsync(obj, QSPI_OK);
+    if (Callback != NULL) {
+      Callback(status, Context);
+    }
+    return status;
+  }
 
-  if (HAL_OSPI_MemoryMapped(handle, &sMemMappedCfg) != HAL_OK) {
-    return QSPI_ERROR;
+  obj->async_vec   = pVec;
+  obj->async_count = Count;
+
+  if (QSPI_AsyncNextVec(obj) == 0) {
+    return QSPI_EraseResumeAsync(obj, QSPI_ERROR);
   }
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef      sCommand;
-  QSPI_MemoryMappedTypeDef sMemMappedCfg;
 
-  /* Configure the command for the read instruction */
-  sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction        = QUAD_INOUT_READ_CMD;
-  sCommand.AddressMode        = QSPI_ADDRESS_4_LINES;
-  sCommand.AddressSize        = QSPI_ADDRESS_24_BITS;
-  sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
-  sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-  sCommand.AlternateBytes     = MX25R6435F_ALT_BYTES_NO_PE_MODE;
-  sCommand.DataMode           = QSPI_DATA_4_LINES;
-  sCommand.DummyCycles        = MX25R6435F_DUMMY_CYCLES_READ_QUAD;
-  sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+  obj->async_op      = QSPI_ASYNC_READ;
+  obj->async_cb      = Callback;
+  obj->async_context = Context;
 
-  /* Configure the memory mapped mode */
-  sMemMappedCfg.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+  QSPI_STATS_ASYNC(obj);
 
-  if (HAL_QSPI_MemoryMapped(handle, &sCommand, &sMemMappedCfg) != HAL_OK) {
-    return QSPI_ERROR;
+  /* Start the transfer of the first chunk, the next ones are chained from interrupt */
+  if (QSPI_ReadChunk_Async(obj) != QSPI_OK) {
+    obj->async_op = QSPI_ASYNC_NONE;
+    return QSPI_EraseResumeAsync(obj, QSPI_ERROR);
   }
-#endif /* OCTOSPI */
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  This function suspends an ongoing erase command.
+  * @brief  Writes several areas of the QSPI memory without blocking. The areas
+  *         are sorted by address and programmed one after the other by the
+  *         same asynchronous operation.
   * @param  obj : pointer to QSPI_t structure
+  * @param  pVec     : Array of the areas to write, sorted in place by the function
+  * @param  Count    : Number of areas
+  * @param  Callback : Function called from interrupt when the writes are completed
+  * @param  Context  : Parameter given to the callback
   * @retval QSPI memory status
+  * @note pVec and the data must remain valid until the callback is called.
+  *       A sector erase started without waiting is completed first.
   */
-uint8_t BSP_QSPI_SuspendErase(QSPI_t *obj)
+uint8_t BSP_QSPI_WriteV_Async(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count, QSPI_Callback Callback, void *Context)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t status;
+  uint32_t i;
 
-  /* Check whether the device is busy (erase operation is
-  in progress).
-  */
-  if (BSP_QSPI_GetStatus(obj) == QSPI_BUSY) {
-#ifdef OCTOSPI
-    OSPI_RegularCmdTypeDef sCommand;
-
-    /* Initialize the suspend command */
-    sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-    sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-    sCommand.Instruction        = PROG_ERASE_SUSPEND_CMD;
-    sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-    sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-    sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-    sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-    sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-    sCommand.DummyCycles        = 0;
-    sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-    sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-    QSPI_CommandTypeDef sCommand;
-
-    /* Initialize the erase command */
-    sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-    sCommand.Instruction       = PROG_ERASE_SUSPEND_CMD;
-    sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode          = QSPI_DATA_NONE;
-    sCommand.DummyCycles       = 0;
-    sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
-    /* Send the command */
-    if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-      return QSPI_ERROR;
-    }
+  QSPI_STATS(obj, QSPI_STATS_WRITEV_ASYNC, QSPI_StatsVecSize(pVec, Count));
 
-    if (BSP_QSPI_GetStatus(obj) == QSPI_SUSPENDED) {
-      return QSPI_OK;
-    }
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
 
+  if (QSPI_SortVec(pVec, Count) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  /* The memory ignores the command while a sector erase started without
+     waiting is running: wait for its end */
+  status = QSPI_EraseCheck(obj);
+  if (status != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, status);
+  }
+
+  for (i = 0; i < Count; i++) {
+    QSPI_BlankMapUpdate(obj, pVec[i].Address, pVec[i].Size, 0);
+    QSPI_ReadCacheInvalidate(obj, pVec[i].Address, pVec[i].Size);
+  }
+
+  obj->async_vec   = pVec;
+  obj->async_count = Count;
+
+  if (QSPI_AsyncNextVec(obj) == 0) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  obj->async_op      = QSPI_ASYNC_WRITE;
+  obj->async_step    = QSPI_ASYNC_STEP_WREN;
+  obj->async_resume_tick = HAL_GetTick();
+  obj->async_retry   = 0;
+  obj->async_cmd     = QSPI_CMD_PAGE_PROG;
+  obj->async_cb      = Callback;
+  obj->async_context = Context;
+
+  QSPI_STATS_ASYNC(obj);
+
+  /* Start the sequence of the first page, the next steps are chained from interrupt */
+  if (QSPI_Command_IT(&(obj->handle), QSPI_CMD_WRITE_ENABLE, 0) != QSPI_OK) {
+    obj->async_op = QSPI_ASYNC_NONE;
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
   return QSPI_OK;
 }
 
 /**
-  * @brief  This function resumes a paused erase command.
+  * @brief  Erases a sector, a sub-block, a block or the entire QSPI memory
+  *         without blocking.
   * @param  obj : pointer to QSPI_t structure
+  * @param  EraseType : QSPI_ERASE_SECTOR, QSPI_ERASE_SUBBLOCK, QSPI_ERASE_BLOCK
+  *                     or QSPI_ERASE_CHIP
+  * @param  Address   : Address in the area to erase (ignored for chip erase)
+  * @param  Callback  : Function called from interrupt when the erase is completed
+  * @param  Context   : Parameter given to the callback
   * @retval QSPI memory status
+  * @note The end of the erase is detected by the automatic polling of the
+  *       status register in interrupt mode. A sector erase started without
+  *       waiting is completed first.
   */
-uint8_t BSP_QSPI_ResumeErase(QSPI_t *obj)
+uint8_t BSP_QSPI_Erase_Async(QSPI_t *obj, uint8_t EraseType, uint32_t Address, QSPI_Callback Callback, void *Context)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
-
-  /* Check whether the device is in suspended state */
-  if (BSP_QSPI_GetStatus(obj) == QSPI_SUSPENDED) {
-#ifdef OCTOSPI
-    OSPI_RegularCmdTypeDef sCommand;
-
-    /* Initialize the resume command */
-    sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-    sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-    sCommand.Instruction        = PROG_ERASE_RESUME_CMD;
-    sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-    sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-    sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-    sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-    sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-    sCommand.DummyCycles        = 0;
-    sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-    sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-    QSPI_CommandTypeDef sCommand;
-
-    /* Initialize the erase command */
-    sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-    sCommand.Instruction       = PROG_ERASE_RESUME_CMD;
-    sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode          = QSPI_DATA_NONE;
-    sCommand.DummyCycles       = 0;
-    sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
-    /* Send the command */
-    if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-      return QSPI_ERROR;
-    }
-    /*
-    When this command is executed, the status register write in progress bit is set to 1, and
-    the flag status register program erase controller bit is set to 0. This command is ignored
-    if the device is not in a suspended state.
-    */
+  uint8_t status;
 
-    if (BSP_QSPI_GetStatus(obj) == QSPI_BUSY) {
-      return QSPI_OK;
-    }
+  QSPI_STATS(obj, QSPI_STATS_ERASE_ASYNC, (EraseType <= QSPI_ERASE_CHIP) ? obj->info.EraseSize[EraseType] : 0);
 
+  if ((EraseType > QSPI_ERASE_CHIP) || (Address >= obj->info.FlashSize)) {
     return QSPI_ERROR;
   }
 
+  if (obj->info.EraseSize[EraseType] == 0) {
+    return QSPI_NOT_SUPPORTED;
+  }
+
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
+
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  /* The memory ignores the command while a sector erase started without
+     waiting is running: wait for its end */
+  status = QSPI_EraseCheck(obj);
+  if (status != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, status);
+  }
+
+  /* The erased area is known once the erase is completed */
+  QSPI_BlankMapUpdate(obj, Address - (Address % obj->info.EraseSize[EraseType]), obj->info.EraseSize[EraseType], 0);
+  QSPI_CacheDiscard(obj, Address - (Address % obj->info.EraseSize[EraseType]), obj->info.EraseSize[EraseType]);
+  QSPI_ReadCacheInvalidate(obj, Address - (Address % obj->info.EraseSize[EraseType]), obj->info.EraseSize[EraseType]);
+
+  obj->async_op      = QSPI_ASYNC_ERASE;
+  obj->async_step    = QSPI_ASYNC_STEP_WREN;
+  obj->async_resume_tick = HAL_GetTick();
+  obj->async_retry   = 0;
+  obj->async_count   = 0;
+  obj->async_cmd     = QSPI_CMD_SECTOR_ERASE + EraseType;
+  obj->async_addr    = Address;
+  obj->async_cb      = Callback;
+  obj->async_context = Context;
+
+  QSPI_STATS_ASYNC(obj);
+
+  /* Start the sequence, the next steps are chained from interrupt */
+  if (QSPI_Command_IT(&(obj->handle), QSPI_CMD_WRITE_ENABLE, 0) != QSPI_OK) {
+    obj->async_op = QSPI_ASYNC_NONE;
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
   return QSPI_OK;
 }
 
 /**
-  * @brief  This function enter the QSPI memory in deep power down mode.
+  * @brief  Erases the specified block of the QSPI memory.
   * @param  obj : pointer to QSPI_t structure
+  * @param  BlockAddress : Block address to erase
   * @retval QSPI memory status
   */
-uint8_t BSP_QSPI_EnterDeepPowerDown(QSPI_t *obj)
+uint8_t BSP_QSPI_Erase_Block(QSPI_t *obj, uint32_t BlockAddress)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
+  QSPI_STATS(obj, QSPI_STATS_ERASE_BLOCK, obj->info.EraseSize[QSPI_ERASE_BLOCK]);
 
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the deep power down command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = DEEP_POWER_DOWN_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the deep power down command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = DEEP_POWER_DOWN_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  if (obj->info.EraseSize[QSPI_ERASE_BLOCK] == 0) {
+    return QSPI_NOT_SUPPORTED;
+  }
 
-  /* Send the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  return QSPI_Erase(obj, QSPI_CMD_BLOCK_ERASE, BlockAddress, obj->info.EraseMaxTime[QSPI_ERASE_BLOCK]);
+}
+
+/**
+  * @brief  Erases the specified sector of the QSPI memory.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Sector : Sector to erase (0 to EraseSectorsNumber - 1)
+  * @retval QSPI memory status
+  * @note This function is non blocking meaning that sector erase
+  *       operation is started but not completed when the function
+  *       returns. Application has to call BSP_QSPI_GetStatus()
+  *       to know when the device is available again (i.e. erase operation
+  *       completed). In memory-mapped mode, the function waits for the end
+  *       of the erase. The result of the erase is checked, and the erase
+  *       retried, by BSP_QSPI_GetStatus() or the next program or erase.
+  */
+uint8_t BSP_QSPI_Erase_Sector(QSPI_t *obj, uint32_t Sector)
+{
+  QSPI_STATS(obj, QSPI_STATS_ERASE_SECTOR, obj->info.EraseSectorSize);
+
+  if (Sector >= obj->info.EraseSectorsNumber) {
     return QSPI_ERROR;
   }
 
-  /* ---          Memory takes 10us max to enter deep power down          --- */
-  /* --- At least 30us should be respected before leaving deep power down --- */
+  /* The mapped mode is restored only once the memory is ready */
+  return QSPI_Erase(obj, QSPI_CMD_SECTOR_ERASE, (Sector * obj->info.EraseSectorSize),
+                    (obj->mapped != 0) ? obj->info.EraseMaxTime[QSPI_ERASE_SECTOR] : 0);
+}
 
-  return QSPI_OK;
+/**
+  * @brief  Erases the entire QSPI memory.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+uint8_t BSP_QSPI_Erase_Chip(QSPI_t *obj)
+{
+  QSPI_STATS(obj, QSPI_STATS_ERASE_CHIP, obj->info.FlashSize);
+
+  return QSPI_Erase(obj, QSPI_CMD_CHIP_ERASE, 0, obj->info.EraseMaxTime[QSPI_ERASE_CHIP]);
 }
 
 /**
-  * @brief  This function leave the QSPI memory from deep power down mode.
+  * @brief  Split an area of the QSPI memory in the smallest number of erases:
+  *         the largest erase aligned in the area is used at each step, the
+  *         chip erase if the area is the entire memory.
   * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Start address of the area, aligned on a sector
+  * @param  Size    : Size of the area, multiple of the sector size
+  * @param  pCount  : Number of erases of each granularity (QSPI_ERASE_NUMBER values)
   * @retval QSPI memory status
   */
-uint8_t BSP_QSPI_LeaveDeepPowerDown(QSPI_t *obj)
+uint8_t BSP_QSPI_Erase_Plan(QSPI_t *obj, uint32_t Address, uint32_t Size, uint32_t *pCount)
 {
-  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t type;
 
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = NO_OPERATION_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the erase command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = NO_OPERATION_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  memset(pCount, 0, QSPI_ERASE_NUMBER * sizeof(uint32_t));
 
-  /* Send the command */
-  if (HAL_XSPI_Command(handle, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  if ((Address > obj->info.FlashSize) || (Size > (obj->info.FlashSize - Address))) {
     return QSPI_ERROR;
   }
 
-  /* --- A NOP command is sent to the memory, as the nCS should be low for at least 20 ns --- */
-  /* ---                  Memory takes 35us min to leave deep power down                  --- */
+  while (Size > 0) {
+    type = QSPI_EraseType(&(obj->info), Address, Size);
+    if (type == QSPI_ERASE_NUMBER) {
+      return QSPI_ERROR;
+    }
+
+    pCount[type]++;
+    Address += obj->info.EraseSize[type];
+    Size    -= obj->info.EraseSize[type];
+  }
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  Initializes the QSPI MSP.
+  * @brief  Erases an area of the QSPI memory with the smallest number of
+  *         erases (see BSP_QSPI_Erase_Plan()).
   * @param  obj : pointer to QSPI_t structure
-  * @retval None
+  * @param  Address   : Start address of the area, aligned on a sector
+  * @param  Size      : Size of the area, multiple of the sector size
+  * @param  SkipBlank : 1 to check each erase area and skip it if already erased
+  * @retval QSPI memory status
   */
-__weak void BSP_QSPI_MspInit(QSPI_t *obj)
+uint8_t BSP_QSPI_Erase_Range(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t SkipBlank)
 {
-#ifdef OCTOSPI
+  uint32_t count[QSPI_ERASE_NUMBER];
+  uint8_t type;
+  uint8_t blank = 0;
 
-  /* Enable the OctoSPI memory interface clock */
-  /* Reset the OctoSPI memory interface */
-#if defined(OCTOSPI1)
-  if (obj->qspi == OCTOSPI1) {
-    __HAL_RCC_OSPI1_CLK_ENABLE();
+  QSPI_STATS(obj, QSPI_STATS_ERASE_RANGE, Size);
 
-    __HAL_RCC_OSPI1_FORCE_RESET();
-    __HAL_RCC_OSPI1_RELEASE_RESET();
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
-#endif
-#if defined(OCTOSPI2)
-  if (obj->qspi == OCTOSPI2) {
-    __HAL_RCC_OSPI2_CLK_ENABLE();
 
-    __HAL_RCC_OSPI2_FORCE_RESET();
-    __HAL_RCC_OSPI2_RELEASE_RESET();
+  /* Nothing is erased if the area can't be covered entirely */
+  if (BSP_QSPI_Erase_Plan(obj, Address, Size, count) != QSPI_OK) {
+    return QSPI_ERROR;
   }
-#endif
-#else /* OCTOSPI */
-  /* Enable the QuadSPI memory interface clock */
-  __HAL_RCC_QSPI_CLK_ENABLE();
 
-  /* Reset the QuadSPI memory interface */
-  __HAL_RCC_QSPI_FORCE_RESET();
-  __HAL_RCC_QSPI_RELEASE_RESET();
-#endif /* OCTOSPI */
+  while (Size > 0) {
+    type = QSPI_EraseType(&(obj->info), Address, Size);
 
-  /* Configure QSPI GPIO pins */
-  pinmap_pinout(obj->pin_d0, PinMap_XSPI_DATA0);
-  pinmap_pinout(obj->pin_d1, PinMap_XSPI_DATA1);
-  pinmap_pinout(obj->pin_d2, PinMap_XSPI_DATA2);
-  pinmap_pinout(obj->pin_d3, PinMap_XSPI_DATA3);
-  pinmap_pinout(obj->pin_sclk, PinMap_XSPI_SCLK);
-  pinmap_pinout(obj->pin_ssel, PinMap_XSPI_SSEL);
+    if ((SkipBlank != 0) &&
+        (BSP_QSPI_IsBlank(obj, Address, obj->info.EraseSize[type], &blank) != QSPI_OK)) {
+      blank = 0;
+    }
+
+    if ((blank == 0) &&
+        (QSPI_Erase(obj, QSPI_CMD_SECTOR_ERASE + type, Address, obj->info.EraseMaxTime[type]) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+
+    Address += obj->info.EraseSize[type];
+    Size    -= obj->info.EraseSize[type];
+  }
+
+  return QSPI_OK;
 }
 
 /**
-  * @brief  De-Initializes the QSPI MSP.
+  * @brief  Checks whether an area of the QSPI memory is erased. The area is
+  *         read in place in memory-mapped mode, by large reads otherwise.
   * @param  obj : pointer to QSPI_t structure
-  * @retval None
+  * @param  Address : Start address of the area
+  * @param  Size    : Size of the area
+  * @param  pBlank  : Set to 1 if all the bytes are 0xFF, else 0
+  * @retval QSPI memory status
+  * @note The sectors known to be erased by MX25R6435F_BLANK_MAP are not read.
   */
-__weak void BSP_QSPI_MspDeInit(QSPI_t *obj)
+uint8_t BSP_QSPI_IsBlank(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t *pBlank)
 {
-  /* QSPI CLK, CS, D0-D3 GPIO pins de-configuration  */
+  uint32_t sector_size = obj->info.EraseSectorSize;
+  uint32_t current_size;
 
-  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d0), STM_GPIO_PIN(obj->pin_d0));
-  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d1), STM_GPIO_PIN(obj->pin_d1));
-  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d2), STM_GPIO_PIN(obj->pin_d2));
-  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d3), STM_GPIO_PIN(obj->pin_d3));
-  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_sclk), STM_GPIO_PIN(obj->pin_sclk));
-  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_ssel), STM_GPIO_PIN(obj->pin_ssel));
+  QSPI_STATS(obj, QSPI_STATS_IS_BLANK, Size);
 
-#ifdef OCTOSPI
-#if defined(OCTOSPI1)
-  /* Reset the OctoSPI memory interface */
-  /* Disable the OctoSPI memory interface clock */
-  if (obj->qspi == OCTOSPI1) {
-    __HAL_RCC_OSPI1_FORCE_RESET();
-    __HAL_RCC_OSPI1_RELEASE_RESET();
+  *pBlank = 0;
 
-    __HAL_RCC_OSPI1_CLK_DISABLE();
+  if ((Address > obj->info.FlashSize) || (Size > (obj->info.FlashSize - Address))) {
+    return QSPI_ERROR;
   }
-#endif
-#if defined(OCTOSPI2)
-  if (obj->qspi == OCTOSPI2) {
-    __HAL_RCC_OSPI2_FORCE_RESET();
-    __HAL_RCC_OSPI2_RELEASE_RESET();
 
-    __HAL_RCC_OSPI2_CLK_DISABLE();
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
-#endif
-#else /* OCTOSPI */
-  /* Reset the QuadSPI memory interface */
-  __HAL_RCC_QSPI_FORCE_RESET();
-  __HAL_RCC_QSPI_RELEASE_RESET();
 
-  /* Disable the QuadSPI memory interface clock */
-  __HAL_RCC_QSPI_CLK_DISABLE();
-#endif /* OCTOSPI */
+  /* Check sector by sector to update the blank map */
+  while (Size > 0) {
+    current_size = sector_size - (Address % sector_size);
+    if (current_size > Size) {
+      current_size = Size;
+    }
+
+    if (QSPI_BlankMapGet(obj, Address) == 0) {
+      if (QSPI_ScanBlank(obj, Address, current_size, pBlank) != QSPI_OK) {
+        *pBlank = 0;
+        return QSPI_ERROR;
+      }
+
+      if (current_size == sector_size) {
+        QSPI_BlankMapUpdate(obj, Address, current_size, *pBlank);
+      }
+
+      if (*pBlank == 0) {
+        return QSPI_OK;
+      }
+    }
+
+    Address += current_size;
+    Size    -= current_size;
+  }
+
+  *pBlank = 1;
+
+  return QSPI_OK;
 }
 
 /**
-  * @brief  This function reset the QSPI memory.
-  * @param  hxspi : QSPI handle
-  * @retval None
+  * @brief  Reads current status of the QSPI memory.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
   */
-static uint8_t QSPI_ResetMemory(XSPI_HandleTypeDef *hxspi)
+uint8_t BSP_QSPI_GetStatus(QSPI_t *obj)
 {
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Initialize the reset enable command */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = RESET_ENABLE_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
-
-  /* Initialize the reset enable command */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = RESET_ENABLE_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  uint8_t status;
 
-  /* Send the command */
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  QSPI_STATS(obj, QSPI_STATS_GET_STATUS, 0);
+
+  /* The interface is owned by an asynchronous operation */
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  /* Send the reset memory command */
-  sCommand.Instruction = RESET_MEMORY_CMD;
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  status = QSPI_EnterIndirectMode(obj);
+
+  if (status == QSPI_OK) {
+    status = QSPI_ReadStatus(&(obj->handle));
+
+    /* End of a sector erase started without waiting: check its result */
+    if ((obj->erase_pending != 0) && (status != QSPI_BUSY) && (status != QSPI_SUSPENDED)) {
+      status = QSPI_EraseCheck(obj);
+    }
   }
 
-  /* Configure automatic polling mode to wait the memory is ready */
-  if (QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
+  return QSPI_RestoreMappedMode(obj, status);
+}
+
+/**
+  * @brief  Check whether a sector of the QSPI memory is retired: a program or
+  *         an erase still failed after the retries, or it holds the table.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address  : Address in the sector
+  * @param  pRetired : Set to 1 if the sector is retired, else 0
+  * @retval QSPI memory status, QSPI_NOT_SUPPORTED without MX25R6435F_RETIRED_TABLE
+  */
+uint8_t BSP_QSPI_IsRetired(QSPI_t *obj, uint32_t Address, uint8_t *pRetired)
+{
+#if MX25R6435F_RETIRED_TABLE
+  uint32_t sector = Address / obj->info.EraseSectorSize;
+
+  if ((Address >= obj->info.FlashSize) || (sector >= MX25R6435F_RETIRED_SECTORS)) {
     return QSPI_ERROR;
   }
 
+  *pRetired = ((obj->retired_map[sector / 8] & (1U << (sector % 8))) == 0) ? 1 : 0;
+
   return QSPI_OK;
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+
+  *pRetired = 0;
+
+  return QSPI_NOT_SUPPORTED;
+#endif
 }
 
 /**
-  * @brief  This function send a Write Enable and wait it is effective.
-  * @param  hxspi : QSPI handle
-  * @retval None
+  * @brief  Return the number of retired sectors of the QSPI memory.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pCount : Number of retired sectors, including the sector of the table
+  * @retval QSPI memory status, QSPI_NOT_SUPPORTED without MX25R6435F_RETIRED_TABLE
   */
-static uint8_t QSPI_WriteEnable(XSPI_HandleTypeDef *hxspi)
+uint8_t BSP_QSPI_GetRetiredCount(QSPI_t *obj, uint32_t *pCount)
 {
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-  OSPI_AutoPollingTypeDef sConfig;
-
-  /* Enable write operations */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = WRITE_ENABLE_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_NONE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
+#if MX25R6435F_RETIRED_TABLE
+  uint32_t sector;
 
-  if (HAL_OSPI_Command(hxspi, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  *pCount = 0;
+  for (sector = 0; (sector < obj->info.EraseSectorsNumber) && (sector < MX25R6435F_RETIRED_SECTORS); sector++) {
+    if ((obj->retired_map[sector / 8] & (1U << (sector % 8))) == 0) {
+      (*pCount)++;
+    }
   }
 
-  /* Configure automatic polling mode to wait for write enabling */
-  sConfig.Match         = MX25R6435F_SR_WEL;
-  sConfig.Mask          = MX25R6435F_SR_WEL;
-  sConfig.MatchMode     = HAL_OSPI_MATCH_MODE_AND;
-  sConfig.Interval      = 0x10;
-  sConfig.AutomaticStop = HAL_OSPI_AUTOMATIC_STOP_ENABLE;
+  return QSPI_OK;
+#else
+  UNUSED(obj);
 
-  sCommand.Instruction  = READ_STATUS_REG_CMD;
-  sCommand.DataMode     = HAL_OSPI_DATA_1_LINE;
-  sCommand.NbData       = 1;
-  sCommand.DataDtrMode  = HAL_OSPI_DATA_DTR_DISABLE;
+  *pCount = 0;
 
-  if (HAL_OSPI_Command(hxspi, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+  return QSPI_NOT_SUPPORTED;
+#endif
+}
 
-  if (HAL_OSPI_AutoPolling(hxspi, &sConfig, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+/**
+  * @brief  Return the configuration of the QSPI memory.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pInfo : pointer on the configuration structure
+  * @retval QSPI memory status
+  * @note The configuration is read from the memory by BSP_QSPI_Init(). The
+  *       MX25R6435F configuration is returned before.
+  */
+uint8_t BSP_QSPI_GetInfo(QSPI_t *obj, QSPI_Info *pInfo)
+{
+  if (obj->info.FlashSize == 0) {
+    QSPI_DefaultInfo(pInfo);
+  } else {
+    *pInfo = obj->info;
   }
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef     sCommand;
-  QSPI_AutoPollingTypeDef sConfig;
 
-  /* Enable write operations */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = WRITE_ENABLE_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_NONE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
+  return QSPI_OK;
+}
 
-  if (HAL_QSPI_Command(hxspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+/**
+  * @brief  Return the base address of the window of the QSPI memory in
+  *         memory-mapped mode.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval Address of the first byte of the memory in the window
+  */
+uint8_t *BSP_QSPI_GetMappedAddress(QSPI_t *obj)
+{
+  return qspi_getMappedAddress(obj);
+}
 
-  /* Configure automatic polling mode to wait for write enabling */
-  sConfig.Match           = MX25R6435F_SR_WEL;
-  sConfig.Mask            = MX25R6435F_SR_WEL;
-  sConfig.MatchMode       = QSPI_MATCH_MODE_AND;
-  sConfig.StatusBytesSize = 1;
-  sConfig.Interval        = 0x10;
-  sConfig.AutomaticStop   = QSPI_AUTOMATIC_STOP_ENABLE;
+/**
+  * @brief  Configure the QSPI in memory-mapped mode
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+uint8_t BSP_QSPI_EnableMemoryMappedMode(QSPI_t *obj)
+{
+  QSPI_STATS(obj, QSPI_STATS_MAPPED, 0);
 
-  sCommand.Instruction    = READ_STATUS_REG_CMD;
-  sCommand.DataMode       = QSPI_DATA_1_LINE;
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
 
-  if (HAL_QSPI_AutoPolling(hxspi, &sCommand, &sConfig, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (HAL_XSPI_GetState(&(obj->handle)) != HAL_XSPI_STATE_BUSY_MEM_MAPPED) {
+    /* The mapped window shows the programmed data only */
+    if ((BSP_QSPI_Flush(obj) != QSPI_OK) || (QSPI_MemoryMapped(obj) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
   }
-#endif /* OCTOSPI */
+
+  obj->mapped = 1;
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  This function read the SR of the memory and wait the EOP.
-  * @param  hxspi   : QSPI handle
-  * @param  Timeout : Timeout for auto-polling
-  * @retval None
+  * @brief  Leave the memory-mapped mode
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
   */
-static uint8_t QSPI_AutoPollingMemReady(XSPI_HandleTypeDef *hxspi, uint32_t Timeout)
+uint8_t BSP_QSPI_DisableMemoryMappedMode(QSPI_t *obj)
 {
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-  OSPI_AutoPollingTypeDef sConfig;
-
-  /* Configure automatic polling mode to wait for memory ready */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = READ_STATUS_REG_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_1_LINE;
-  sCommand.NbData             = 1;
-  sCommand.DataDtrMode        = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles        = 0;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-
-  sConfig.Match         = 0;
-  sConfig.Mask          = MX25R6435F_SR_WIP;
-  sConfig.MatchMode     = HAL_OSPI_MATCH_MODE_AND;
-  sConfig.Interval      = 0x10;
-  sConfig.AutomaticStop = HAL_OSPI_AUTOMATIC_STOP_ENABLE;
-
-  if (HAL_OSPI_Command(hxspi, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+  QSPI_STATS(obj, QSPI_STATS_MAPPED, 0);
 
-  if (HAL_OSPI_AutoPolling(hxspi, &sConfig, Timeout) != HAL_OK) {
-    return QSPI_ERROR;
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef     sCommand;
-  QSPI_AutoPollingTypeDef sConfig;
-
-  /* Configure automatic polling mode to wait for memory ready */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = READ_STATUS_REG_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_1_LINE;
-  sCommand.DummyCycles       = 0;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-
-  sConfig.Match           = 0;
-  sConfig.Mask            = MX25R6435F_SR_WIP;
-  sConfig.MatchMode       = QSPI_MATCH_MODE_AND;
-  sConfig.StatusBytesSize = 1;
-  sConfig.Interval        = 0x10;
-  sConfig.AutomaticStop   = QSPI_AUTOMATIC_STOP_ENABLE;
 
-  if (HAL_QSPI_AutoPolling(hxspi, &sCommand, &sConfig, Timeout) != HAL_OK) {
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
     return QSPI_ERROR;
   }
-#endif /* OCTOSPI */
+
+  obj->mapped = 0;
 
   return QSPI_OK;
 }
 
 /**
-  * @brief  This function enables/disables the Quad mode of the memory.
-  * @param  hxspi     : QSPI handle
-  * @param  Operation : QSPI_QUAD_ENABLE or QSPI_QUAD_DISABLE mode
-  * @retval None
+  * @brief  This function suspends an ongoing erase command, started by
+  *         BSP_QSPI_Erase_Async() or not.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
   */
-static uint8_t QSPI_QuadMode(XSPI_HandleTypeDef *hxspi, uint8_t Operation)
+uint8_t BSP_QSPI_SuspendErase(QSPI_t *obj)
 {
-  uint8_t reg;
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Read status register */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = READ_STATUS_REG_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_1_LINE;
-  sCommand.DataDtrMode        = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles        = 0;
-  sCommand.NbData             = 1;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
+  uint8_t status;
 
-  /* Read status register */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = READ_STATUS_REG_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_1_LINE;
-  sCommand.DummyCycles       = 0;
-  sCommand.NbData            = 1;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  QSPI_STATS(obj, QSPI_STATS_SUSPEND, 0);
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (obj->async_op == QSPI_ASYNC_ERASE) {
+    return QSPI_RestoreMappedMode(obj, QSPI_AsyncSuspend(obj));
+  } else if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  if (HAL_XSPI_Receive(hxspi, &reg, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+  status = QSPI_EnterIndirectMode(obj);
 
-  /* Enable write operations */
-  if (QSPI_WriteEnable(hxspi) != QSPI_OK) {
-    return QSPI_ERROR;
+  if (status == QSPI_OK) {
+    status = QSPI_SuspendMemory(&(obj->handle));
   }
 
-  /* Activate/deactivate the Quad mode */
-  if (Operation == QSPI_QUAD_ENABLE) {
-    SET_BIT(reg, MX25R6435F_SR_QE);
-  } else {
-    CLEAR_BIT(reg, MX25R6435F_SR_QE);
-  }
+  return QSPI_RestoreMappedMode(obj, status);
+}
 
-  sCommand.Instruction = WRITE_STATUS_CFG_REG_CMD;
+/**
+  * @brief  This function resumes a paused erase command.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+uint8_t BSP_QSPI_ResumeErase(QSPI_t *obj)
+{
+  uint8_t status;
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+  QSPI_STATS(obj, QSPI_STATS_RESUME, 0);
 
-  if (HAL_XSPI_Transmit(hxspi, &reg, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if ((obj->async_op == QSPI_ASYNC_ERASE) && (obj->async_pause == QSPI_ASYNC_PAUSED)) {
+    return QSPI_AsyncResume(obj, QSPI_OK);
+  } else if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  /* Wait that memory is ready */
-  if (QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
-    return QSPI_ERROR;
-  }
+  status = QSPI_EnterIndirectMode(obj);
 
-  /* Check the configuration has been correctly done */
-  sCommand.Instruction = READ_STATUS_REG_CMD;
+  /* The data read during the suspend are erased after the resume */
+  QSPI_ReadCacheInvalidate(obj, 0, obj->info.FlashSize);
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (status == QSPI_OK) {
+    status = QSPI_ResumeMemory(&(obj->handle));
   }
 
-  if (HAL_XSPI_Receive(hxspi, &reg, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  return QSPI_RestoreMappedMode(obj, status);
+}
+
+/**
+  * @brief  This function suspends an ongoing page program so that the memory
+  *         can be read. An asynchronous write is stopped at its current step:
+  *         the page being programmed is suspended in the memory and the next
+  *         pages are only programmed after BSP_QSPI_ResumeProgram().
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  * @note Only the blocking reads are allowed until the program is resumed.
+  */
+uint8_t BSP_QSPI_SuspendProgram(QSPI_t *obj)
+{
+  uint8_t status;
+
+  QSPI_STATS(obj, QSPI_STATS_SUSPEND, 0);
+
+  if (obj->async_op == QSPI_ASYNC_WRITE) {
+    return QSPI_RestoreMappedMode(obj, QSPI_AsyncSuspend(obj));
+  } else if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  if ((((reg & MX25R6435F_SR_QE) == 0) && (Operation == QSPI_QUAD_ENABLE)) ||
-      (((reg & MX25R6435F_SR_QE) != 0) && (Operation == QSPI_QUAD_DISABLE))) {
-    return QSPI_ERROR;
+  status = QSPI_EnterIndirectMode(obj);
+
+  if (status == QSPI_OK) {
+    status = QSPI_SuspendMemory(&(obj->handle));
   }
 
-  return QSPI_OK;
+  return QSPI_RestoreMappedMode(obj, status);
 }
 
 /**
-  * @brief  This function enables/disables the high performance mode of the memory.
-  * @param  hxspi     : QSPI handle
-  * @param  Operation : QSPI_HIGH_PERF_ENABLE or QSPI_HIGH_PERF_DISABLE high performance mode
-  * @retval None
+  * @brief  This function resumes a suspended page program and restarts the
+  *         asynchronous write stopped by BSP_QSPI_SuspendProgram().
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
   */
-static uint8_t QSPI_HighPerfMode(XSPI_HandleTypeDef *hxspi, uint8_t Operation)
+uint8_t BSP_QSPI_ResumeProgram(QSPI_t *obj)
 {
-  uint8_t reg[3];
-#ifdef OCTOSPI
-  OSPI_RegularCmdTypeDef sCommand;
-
-  /* Read status register */
-  sCommand.OperationType      = HAL_OSPI_OPTYPE_COMMON_CFG;
-  sCommand.FlashId            = HAL_OSPI_FLASH_ID_1;
-  sCommand.Instruction        = READ_STATUS_REG_CMD;
-  sCommand.InstructionMode    = HAL_OSPI_INSTRUCTION_1_LINE;
-  sCommand.InstructionSize    = HAL_OSPI_INSTRUCTION_8_BITS;
-  sCommand.InstructionDtrMode = HAL_OSPI_INSTRUCTION_DTR_DISABLE;
-  sCommand.AddressMode        = HAL_OSPI_ADDRESS_NONE;
-  sCommand.AlternateBytesMode = HAL_OSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode           = HAL_OSPI_DATA_1_LINE;
-  sCommand.DataDtrMode        = HAL_OSPI_DATA_DTR_DISABLE;
-  sCommand.DummyCycles        = 0;
-  sCommand.NbData             = 1;
-  sCommand.DQSMode            = HAL_OSPI_DQS_DISABLE;
-  sCommand.SIOOMode           = HAL_OSPI_SIOO_INST_EVERY_CMD;
-#else /* OCTOSPI */
-  QSPI_CommandTypeDef sCommand;
+  uint8_t status;
 
-  /* Read status register */
-  sCommand.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
-  sCommand.Instruction       = READ_STATUS_REG_CMD;
-  sCommand.AddressMode       = QSPI_ADDRESS_NONE;
-  sCommand.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
-  sCommand.DataMode          = QSPI_DATA_1_LINE;
-  sCommand.DummyCycles       = 0;
-  sCommand.NbData            = 1;
-  sCommand.DdrMode           = QSPI_DDR_MODE_DISABLE;
-  sCommand.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
-  sCommand.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
-#endif /* OCTOSPI */
+  QSPI_STATS(obj, QSPI_STATS_RESUME, 0);
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if ((obj->async_op == QSPI_ASYNC_WRITE) && (obj->async_pause == QSPI_ASYNC_PAUSED)) {
+    return QSPI_AsyncResume(obj, QSPI_OK);
+  } else if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  if (HAL_XSPI_Receive(hxspi, &(reg[0]), HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+  status = QSPI_EnterIndirectMode(obj);
 
-  /* Read configuration registers */
-  sCommand.Instruction = READ_CFG_REG_CMD;
-  sCommand.NbData      = 2;
+  /* The data read during the suspend may be programmed after the resume */
+  QSPI_ReadCacheInvalidate(obj, 0, obj->info.FlashSize);
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  if (status == QSPI_OK) {
+    status = QSPI_ResumeMemory(&(obj->handle));
   }
 
-  if (HAL_XSPI_Receive(hxspi, &(reg[1]), HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
-  }
+  return QSPI_RestoreMappedMode(obj, status);
+}
 
-  /* Enable write operations */
-  if (QSPI_WriteEnable(hxspi) != QSPI_OK) {
-    return QSPI_ERROR;
-  }
+/**
+  * @brief  This function enter the QSPI memory in deep power down mode.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status, QSPI_BUSY during an asynchronous operation or
+  *         a sector erase started without waiting
+  */
+uint8_t BSP_QSPI_EnterDeepPowerDown(QSPI_t *obj)
+{
+  uint8_t status;
 
-  /* Activate/deactivate the Quad mode */
-  if (Operation == QSPI_HIGH_PERF_ENABLE) {
-    SET_BIT(reg[2], MX25R6435F_CR2_LH_SWITCH);
-  } else {
-    CLEAR_BIT(reg[2], MX25R6435F_CR2_LH_SWITCH);
+  QSPI_STATS(obj, QSPI_STATS_POWER_DOWN, 0);
+
+  /* The interface is owned by an asynchronous operation */
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
   }
 
-  sCommand.Instruction = WRITE_STATUS_CFG_REG_CMD;
-  sCommand.NbData      = 3;
+  /* A sector erase started without waiting must be completed */
+  if (obj->erase_pending != 0) {
+    status = BSP_QSPI_GetStatus(obj);
+    if (status != QSPI_OK) {
+      return status;
+    }
+  }
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  if (BSP_QSPI_Flush(obj) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
-  if (HAL_XSPI_Transmit(hxspi, &(reg[0]), HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  /* The memory-mapped mode is restored when leaving deep power down */
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
-  /* Wait that memory is ready */
-  if (QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
+  /* Send the command */
+  if (QSPI_Command(&(obj->handle), QSPI_CMD_DEEP_POWER_DOWN, 0, 0) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
-  /* Check the configuration has been correctly done */
-  sCommand.Instruction = READ_CFG_REG_CMD;
-  sCommand.NbData      = 2;
+  /* ---          Memory takes 10us max to enter deep power down          --- */
+  /* --- At least 30us should be respected before leaving deep power down --- */
 
-  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
-    return QSPI_ERROR;
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function leave the QSPI memory from deep power down mode.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+uint8_t BSP_QSPI_LeaveDeepPowerDown(QSPI_t *obj)
+{
+  QSPI_STATS(obj, QSPI_STATS_POWER_DOWN, 0);
+
+  if ((obj->async_op != QSPI_ASYNC_NONE) || (obj->erase_pending != 0)) {
+    return QSPI_BUSY;
   }
 
-  if (HAL_XSPI_Receive(hxspi, &(reg[0]), HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
-  if ((((reg[1] & MX25R6435F_CR2_LH_SWITCH) == 0) && (Operation == QSPI_HIGH_PERF_ENABLE)) ||
-      (((reg[1] & MX25R6435F_CR2_LH_SWITCH) != 0) && (Operation == QSPI_HIGH_PERF_DISABLE))) {
+  /* Send the command */
+  if (QSPI_Command(&(obj->handle), QSPI_CMD_NOP, 0, 0) != QSPI_OK) {
     return QSPI_ERROR;
   }
 
-  return QSPI_OK;
+  /* --- A NOP command is sent to the memory, as the nCS should be low for at least 20 ns --- */
+  /* ---                  Memory takes 35us min to leave deep power down                  --- */
+
+  return QSPI_RestoreMappedMode(obj, QSPI_OK);
 }
 
+/**
+  * @brief  This function enables/disables the continuous read mode: the
+  *         memory is kept in performance enhance mode between the reads,
+  *         so only the address is sent for the next ones.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  Enable : 1 to enable, 0 to disable
+  * @retval QSPI memory status
+  * @note The memory leaves the performance enhance mode before any other
+  *       command.
+  */
+uint8_t BSP_QSPI_SetContinuousRead(QSPI_t *obj, uint8_t Enable)
+{
+  QSPI_STATS(obj, QSPI_STATS_CONTINUOUS_READ, 0);
+
+  if (obj->async_op != QSPI_ASYNC_NONE) {
+    return QSPI_BUSY;
+  }
+
+  /* The memory-mapped mode is re-configured with the new setting */
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  obj->continuous_read = (Enable != 0) ? 1 : 0;
+
+  return QSPI_RestoreMappedMode(obj, QSPI_OK);
+}
+
+/**
+  * @brief  Calibrate the OCTOSPI timing: select the fastest clock prescaler
+  *         allowed by the kernel clock, then sweep the sample shifting and
+  *         delay hold quarter cycle settings until a known pattern is read
+  *         correctly.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  pCalib : Calibration result, to be given to BSP_QSPI_SetCalibration()
+  *                  at next boots
+  * @retval QSPI memory status
+  * @note The reference pattern (SFDP header and beginning of the memory) is
+  *       read with the low power mode clock, which has a large timing margin.
+  *       The configuration found is applied.
+  */
+uint8_t BSP_QSPI_Calibrate(QSPI_t *obj, QSPI_Calibration *pCalib)
+{
+  QSPI_STATS(obj, QSPI_STATS_CALIBRATE, 0);
+
+#ifdef OCTOSPI
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t ref_sfdp[QSPI_CALIB_SFDP_SIZE], ref_data[QSPI_CALIB_PATTERN_SIZE];
+  uint8_t sfdp[QSPI_CALIB_SFDP_SIZE], data[QSPI_CALIB_PATTERN_SIZE];
+  uint32_t prescaler, safe_prescaler, signature;
+  uint8_t i;
+  /* Sample shifting and delay hold quarter cycle settings, in order of preference */
+  static const uint32_t timing[4][2] = {
+    {HAL_OSPI_SAMPLE_SHIFTING_HALFCYCLE, HAL_OSPI_DHQC_DISABLE},
+    {HAL_OSPI_SAMPLE_SHIFTING_HALFCYCLE, HAL_OSPI_DHQC_ENABLE},
+    {HAL_OSPI_SAMPLE_SHIFTING_NONE,      HAL_OSPI_DHQC_DISABLE},
+    {HAL_OSPI_SAMPLE_SHIFTING_NONE,      HAL_OSPI_DHQC_ENABLE}
+  };
+
+  if (pCalib == NULL) {
+    return QSPI_ERROR;
+  }
+
+  if ((obj->async_op != QSPI_ASYNC_NONE) || (obj->mapped != 0)) {
+    return QSPI_BUSY;
+  }
+
+  if (QSPI_ExitContinuousRead(obj) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Read the reference pattern with a safe configuration */
+  safe_prescaler = qspi_setClockPrescaler(MX25R6435F_LOW_POWER_MAX_FREQ);
+
+  if (QSPI_SetTiming(handle, safe_prescaler, HAL_OSPI_SAMPLE_SHIFTING_NONE, HAL_OSPI_DHQC_ENABLE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (QSPI_ReadPattern(handle, ref_sfdp, ref_data) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* The memory does not answer: nothing to calibrate against */
+  signature = ref_sfdp[0] | (ref_sfdp[1] << 8) | (ref_sfdp[2] << 16) | ((uint32_t)ref_sfdp[3] << 24);
+  if (signature != QSPI_SFDP_SIGNATURE) {
+    return QSPI_ERROR;
+  }
+
+  /* Sweep from the fastest clock down to the safe one */
+  for (prescaler = qspi_setClockPrescaler(MX25R6435F_HIGH_PERF_MAX_FREQ); prescaler <= safe_prescaler; prescaler++) {
+    for (i = 0; i < 4; i++) {
+      if ((QSPI_SetTiming(handle, prescaler, timing[i][0], timing[i][1]) == QSPI_OK) &&
+          (QSPI_ReadPattern(handle, sfdp, data) == QSPI_OK) &&
+          (memcmp(sfdp, ref_sfdp, sizeof(sfdp)) == 0) &&
+          (memcmp(data, ref_data, sizeof(data)) == 0)) {
+        pCalib->KernelClock           = qspi_getKernelClock();
+        pCalib->ClockPrescaler        = prescaler;
+        pCalib->SampleShifting        = timing[i][0];
+        pCalib->DelayHoldQuarterCycle = timing[i][1];
+        return QSPI_OK;
+      }
+    }
+  }
+
+  /* No configuration is working: go back to the safe one */
+  QSPI_SetTiming(handle, safe_prescaler, HAL_OSPI_SAMPLE_SHIFTING_NONE, HAL_OSPI_DHQC_ENABLE);
+
+  return QSPI_ERROR;
+#else /* OCTOSPI */
+  UNUSED(obj);
+  UNUSED(pCalib);
+
+  return QSPI_NOT_SUPPORTED;
+#endif /* OCTOSPI */
+}
+
+/**
+  * @brief  Apply a calibration result saved from a previous boot.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  pCalib : Calibration returned by BSP_QSPI_Calibrate()
+  * @retval QSPI memory status
+  * @note The calibration is rejected, and the current configuration kept,
+  *       if the kernel clock changed or if the reference pattern is not
+  *       read correctly with it. BSP_QSPI_Calibrate() must then be called.
+  */
+uint8_t BSP_QSPI_SetCalibration(QSPI_t *obj, const QSPI_Calibration *pCalib)
+{
+  QSPI_STATS(obj, QSPI_STATS_CALIBRATE, 0);
+
+#ifdef OCTOSPI
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t ref_sfdp[QSPI_CALIB_SFDP_SIZE], ref_data[QSPI_CALIB_PATTERN_SIZE];
+  uint8_t sfdp[QSPI_CALIB_SFDP_SIZE], data[QSPI_CALIB_PATTERN_SIZE];
+  uint32_t prescaler = handle->Init.ClockPrescaler;
+  uint32_t shifting = handle->Init.SampleShifting;
+  uint32_t dhqc = handle->Init.DelayHoldQuarterCycle;
+
+  if ((pCalib == NULL) || (pCalib->KernelClock != qspi_getKernelClock()) ||
+      (pCalib->ClockPrescaler < qspi_setClockPrescaler(MX25R6435F_HIGH_PERF_MAX_FREQ))) {
+    return QSPI_ERROR;
+  }
+
+  if ((obj->async_op != QSPI_ASYNC_NONE) || (obj->mapped != 0)) {
+    return QSPI_BUSY;
+  }
+
+  if (QSPI_ExitContinuousRead(obj) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Read the reference pattern with the current configuration */
+  if (QSPI_ReadPattern(handle, ref_sfdp, ref_data) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if ((QSPI_SetTiming(handle, pCalib->ClockPrescaler, pCalib->SampleShifting, pCalib->DelayHoldQuarterCycle) == QSPI_OK) &&
+      (QSPI_ReadPattern(handle, sfdp, data) == QSPI_OK) &&
+      (memcmp(sfdp, ref_sfdp, sizeof(sfdp)) == 0) &&
+      (memcmp(data, ref_data, sizeof(data)) == 0)) {
+    return QSPI_OK;
+  }
+
+  /* Restore the previous configuration */
+  QSPI_SetTiming(handle, prescaler, shifting, dhqc);
+
+  return QSPI_ERROR;
+#else /* OCTOSPI */
+  UNUSED(obj);
+  UNUSED(pCalib);
+
+  return QSPI_NOT_SUPPORTED;
+#endif /* OCTOSPI */
+}
+
+#if MX25R6435F_STATS
+/**
+  * @brief  Copy the statistics of the operations.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  pStats : Copy of the statistics
+  * @retval QSPI memory status
+  * @note The copy is made with the interrupts disabled, so that the
+  *       asynchronous completions do not update it halfway.
+  */
+uint8_t BSP_QSPI_GetStats(QSPI_t *obj, QSPI_Stats *pStats)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  if (pStats == NULL) {
+    return QSPI_ERROR;
+  }
+
+  __disable_irq();
+  memcpy(pStats, &(obj->stats), sizeof(QSPI_Stats));
+  __set_PRIMASK(primask);
+
+  pStats->Frequency = SystemCoreClock;
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  Clear the statistics of the operations.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+uint8_t BSP_QSPI_ResetStats(QSPI_t *obj)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memset(&(obj->stats), 0, sizeof(QSPI_Stats));
+  __set_PRIMASK(primask);
+
+  return QSPI_OK;
+}
+#endif /* MX25R6435F_STATS */
+
+/**
+  * @brief  Initializes the QSPI MSP.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval None
+  */
+__weak void BSP_QSPI_MspInit(QSPI_t *obj)
+{
+#ifdef OCTOSPI
+
+  /* Enable the OctoSPI memory interface clock */
+  /* Reset the OctoSPI memory interface */
+#if defined(OCTOSPI1)
+  if (obj->qspi == OCTOSPI1) {
+    __HAL_RCC_OSPI1_CLK_ENABLE();
+
+    __HAL_RCC_OSPI1_FORCE_RESET();
+    __HAL_RCC_OSPI1_RELEASE_RESET();
+  }
+#endif
+#if defined(OCTOSPI2)
+  if (obj->qspi == OCTOSPI2) {
+    __HAL_RCC_OSPI2_CLK_ENABLE();
+
+    __HAL_RCC_OSPI2_FORCE_RESET();
+    __HAL_RCC_OSPI2_RELEASE_RESET();
+  }
+#endif
+#else /* OCTOSPI */
+  /* Enable the QuadSPI memory interface clock */
+  __HAL_RCC_QSPI_CLK_ENABLE();
+
+  /* Reset the QuadSPI memory interface */
+  __HAL_RCC_QSPI_FORCE_RESET();
+  __HAL_RCC_QSPI_RELEASE_RESET();
+#endif /* OCTOSPI */
+
+  /* Configure QSPI GPIO pins */
+  pinmap_pinout(obj->pin_d0, PinMap_XSPI_DATA0);
+  pinmap_pinout(obj->pin_d1, PinMap_XSPI_DATA1);
+  pinmap_pinout(obj->pin_d2, PinMap_XSPI_DATA2);
+  pinmap_pinout(obj->pin_d3, PinMap_XSPI_DATA3);
+  pinmap_pinout(obj->pin_sclk, PinMap_XSPI_SCLK);
+  pinmap_pinout(obj->pin_ssel, PinMap_XSPI_SSEL);
+
+#if MX25R6435F_DMA
+  /* Configure the DMA used by the asynchronous transfers */
+  MX25R6435F_DMA_CLK_ENABLE();
+#if defined(DMAMUX1_Channel0)
+  __HAL_RCC_DMAMUX1_CLK_ENABLE();
+#endif
+
+  obj->hdma.Instance                 = MX25R6435F_DMA_CHANNEL;
+  obj->hdma.Init.Request             = MX25R6435F_DMA_REQUEST;
+  obj->hdma.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  obj->hdma.Init.PeriphInc           = DMA_PINC_DISABLE;
+  obj->hdma.Init.MemInc              = DMA_MINC_ENABLE;
+  obj->hdma.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  obj->hdma.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+  obj->hdma.Init.Mode                = DMA_NORMAL;
+  obj->hdma.Init.Priority            = DMA_PRIORITY_HIGH;
+
+  if (HAL_DMA_Init(&(obj->hdma)) == HAL_OK) {
+    __HAL_LINKDMA(&(obj->handle), hdma, obj->hdma);
+    qspi_hdma = &(obj->hdma);
+
+    HAL_NVIC_SetPriority(MX25R6435F_DMA_IRQn, MX25R6435F_IRQ_PRIO, MX25R6435F_IRQ_SUBPRIO);
+    HAL_NVIC_EnableIRQ(MX25R6435F_DMA_IRQn);
+  }
+#endif /* MX25R6435F_DMA */
+
+  /* Enable the xSPI interrupt used by the asynchronous operations */
+#if defined(OCTOSPI)
+#if defined(OCTOSPI1)
+  if (obj->qspi == OCTOSPI1) {
+    HAL_NVIC_SetPriority(OCTOSPI1_IRQn, MX25R6435F_IRQ_PRIO, MX25R6435F_IRQ_SUBPRIO);
+    HAL_NVIC_EnableIRQ(OCTOSPI1_IRQn);
+  }
+#endif
+#if defined(OCTOSPI2)
+  if (obj->qspi == OCTOSPI2) {
+    HAL_NVIC_SetPriority(OCTOSPI2_IRQn, MX25R6435F_IRQ_PRIO, MX25R6435F_IRQ_SUBPRIO);
+    HAL_NVIC_EnableIRQ(OCTOSPI2_IRQn);
+  }
+#endif
+#else /* OCTOSPI */
+  HAL_NVIC_SetPriority(QUADSPI_IRQn, MX25R6435F_IRQ_PRIO, MX25R6435F_IRQ_SUBPRIO);
+  HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
+#endif /* OCTOSPI */
+}
+
+/**
+  * @brief  De-Initializes the QSPI MSP.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval None
+  */
+__weak void BSP_QSPI_MspDeInit(QSPI_t *obj)
+{
+  /* Disable the interrupts used by the asynchronous operations */
+#if defined(OCTOSPI)
+#if defined(OCTOSPI1)
+  if (obj->qspi == OCTOSPI1) {
+    HAL_NVIC_DisableIRQ(OCTOSPI1_IRQn);
+  }
+#endif
+#if defined(OCTOSPI2)
+  if (obj->qspi == OCTOSPI2) {
+    HAL_NVIC_DisableIRQ(OCTOSPI2_IRQn);
+  }
+#endif
+#else /* OCTOSPI */
+  HAL_NVIC_DisableIRQ(QUADSPI_IRQn);
+#endif /* OCTOSPI */
+
+#if MX25R6435F_DMA
+  if (qspi_hdma == &(obj->hdma)) {
+    HAL_NVIC_DisableIRQ(MX25R6435F_DMA_IRQn);
+    HAL_DMA_DeInit(&(obj->hdma));
+    qspi_hdma = NULL;
+  }
+#endif /* MX25R6435F_DMA */
+
+  /* QSPI CLK, CS, D0-D3 GPIO pins de-configuration  */
+
+  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d0), STM_GPIO_PIN(obj->pin_d0));
+  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d1), STM_GPIO_PIN(obj->pin_d1));
+  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d2), STM_GPIO_PIN(obj->pin_d2));
+  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_d3), STM_GPIO_PIN(obj->pin_d3));
+  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_sclk), STM_GPIO_PIN(obj->pin_sclk));
+  HAL_GPIO_DeInit((GPIO_TypeDef *)STM_PORT(obj->pin_ssel), STM_GPIO_PIN(obj->pin_ssel));
+
+#ifdef OCTOSPI
+#if defined(OCTOSPI1)
+  /* Reset the OctoSPI memory interface */
+  /* Disable the OctoSPI memory interface clock */
+  if (obj->qspi == OCTOSPI1) {
+    __HAL_RCC_OSPI1_FORCE_RESET();
+    __HAL_RCC_OSPI1_RELEASE_RESET();
+
+    __HAL_RCC_OSPI1_CLK_DISABLE();
+  }
+#endif
+#if defined(OCTOSPI2)
+  if (obj->qspi == OCTOSPI2) {
+    __HAL_RCC_OSPI2_FORCE_RESET();
+    __HAL_RCC_OSPI2_RELEASE_RESET();
+
+    __HAL_RCC_OSPI2_CLK_DISABLE();
+  }
+#endif
+#else /* OCTOSPI */
+  /* Reset the QuadSPI memory interface */
+  __HAL_RCC_QSPI_FORCE_RESET();
+  __HAL_RCC_QSPI_RELEASE_RESET();
+
+  /* Disable the QuadSPI memory interface clock */
+  __HAL_RCC_QSPI_CLK_DISABLE();
+#endif /* OCTOSPI */
+}
+
+/**
+  * @brief  This function sends a command from its template.
+  * @param  hxspi   : QSPI handle
+  * @param  Cmd     : Index of the command template
+  * @param  Address : Address of the command (ignored if the command has none)
+  * @param  NbData  : Number of data of the command (0 to keep the template one)
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_Command(XSPI_HandleTypeDef *hxspi, QSPI_CmdTypeDef Cmd, uint32_t Address, uint32_t NbData)
+{
+  XSPI_CommandTypeDef sCommand = qspi_cmd[Cmd];
+
+  sCommand.Address = Address;
+  if (NbData != 0) {
+    sCommand.NbData = NbData;
+  }
+
+  if (HAL_XSPI_Command(hxspi, &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function sends a command without data from its template in
+  *         interrupt mode: the command complete callback is called when it
+  *         is sent.
+  * @param  hxspi   : QSPI handle
+  * @param  Cmd     : Index of the command template
+  * @param  Address : Address of the command (ignored if the command has none)
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_Command_IT(XSPI_HandleTypeDef *hxspi, QSPI_CmdTypeDef Cmd, uint32_t Address)
+{
+  XSPI_CommandTypeDef sCommand = qspi_cmd[Cmd];
+
+  sCommand.Address = Address;
+
+  if (HAL_XSPI_Command_IT(hxspi, &sCommand) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function enables the write operations and sends an erase
+  *         command.
+  * @param  obj     : pointer to QSPI_t structure
+  * @param  Cmd     : Index of the erase command template
+  * @param  Address : Address in the area to erase
+  * @param  Timeout : Maximum time of the erase, 0 to return without waiting
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_Erase(QSPI_t *obj, QSPI_CmdTypeDef Cmd, uint32_t Address, uint32_t Timeout)
+{
+  uint8_t status = QSPI_EnterIndirectMode(obj);
+  uint32_t size = obj->info.EraseSize[Cmd - QSPI_CMD_SECTOR_ERASE];
+
+  /* The previous erase is completed first, a suspended one is kept */
+  if (status == QSPI_OK) {
+    status = QSPI_EraseCheck(obj);
+  }
+
+  if (status == QSPI_OK) {
+    Address -= Address % size;
+    QSPI_BlankMapUpdate(obj, Address, size, 0);
+    QSPI_CacheDiscard(obj, Address, size);
+    QSPI_ReadCacheInvalidate(obj, Address, size);
+
+    status = QSPI_EraseArea(obj, Cmd, Address, Timeout, 0);
+  }
+
+  return QSPI_RestoreMappedMode(obj, status);
+}
+
+/**
+  * @brief  This function erases an area of the memory and checks the result,
+  *         retrying the erase if it failed. A larger erase still failing is
+  *         split in sector erases to find the sectors to retire.
+  * @param  obj     : pointer to QSPI_t structure
+  * @param  Cmd     : Index of the erase command template
+  * @param  Address : Start address of the area, aligned on the erase size
+  * @param  Timeout : Maximum time of the erase, 0 to return without waiting
+  *                   (the erase is checked by QSPI_EraseCheck())
+  * @param  Started : 1 if the erase command is already sent
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_EraseArea(QSPI_t *obj, QSPI_CmdTypeDef Cmd, uint32_t Address, uint32_t Timeout, uint8_t Started)
+{
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint32_t size = obj->info.EraseSize[Cmd - QSPI_CMD_SECTOR_ERASE];
+  uint32_t offset;
+  uint8_t status = QSPI_OK;
+  uint8_t retry = 0;
+  uint8_t fail;
+
+  do {
+    /* Enable write operations and send the command */
+    if ((Started == 0) &&
+        ((QSPI_WriteEnable(handle) != QSPI_OK) || (QSPI_Command(handle, Cmd, Address, 0) != QSPI_OK))) {
+      return QSPI_ERROR;
+    }
+    Started = 0;
+
+    if (Timeout == 0) {
+      obj->erase_addr = Address;
+      obj->erase_pending = 1;
+      obj->async_resume_tick = HAL_GetTick();
+      return QSPI_OK;
+    }
+
+    /* Configure automatic polling mode to wait for end of erase, then check its result */
+    if ((QSPI_AutoPollingMemReady(handle, Timeout) != QSPI_OK) ||
+        (QSPI_CheckFail(handle, MX25R6435F_SECR_E_FAIL, &fail) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+  } while ((fail != 0) && (retry++ < MX25R6435F_ERASE_RETRIES));
+
+  if (fail == 0) {
+    QSPI_BlankMapUpdate(obj, Address, size, 1);
+    QSPI_RetiredErased(obj, Address, size);
+    return QSPI_OK;
+  }
+
+  if (Cmd == QSPI_CMD_SECTOR_ERASE) {
+    QSPI_Retire(obj, Address);
+    return QSPI_ERROR;
+  }
+
+  for (offset = 0; offset < size; offset += obj->info.EraseSectorSize) {
+    if (QSPI_EraseArea(obj, QSPI_CMD_SECTOR_ERASE, Address + offset,
+                       obj->info.EraseMaxTime[QSPI_ERASE_SECTOR], 0) != QSPI_OK) {
+      status = QSPI_ERROR;
+    }
+  }
+
+  return status;
+}
+
+/**
+  * @brief  This function waits for the end of a sector erase started without
+  *         waiting, if any, and checks its result. A suspended erase is
+  *         checked later: the memory rejects a program or an erase until it
+  *         is resumed.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status of the erase, QSPI_SUSPENDED if it is suspended
+  */
+static uint8_t QSPI_EraseCheck(QSPI_t *obj)
+{
+  uint8_t reg;
+
+  if (obj->erase_pending == 0) {
+    return QSPI_OK;
+  }
+
+  if (QSPI_ReadRegister(&(obj->handle), QSPI_CMD_READ_SEC_REG, &reg, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if ((reg & MX25R6435F_SECR_ESB) != 0) {
+    return QSPI_SUSPENDED;
+  }
+
+  obj->erase_pending = 0;
+
+  return QSPI_EraseArea(obj, QSPI_CMD_SECTOR_ERASE, obj->erase_addr, obj->info.EraseMaxTime[QSPI_ERASE_SECTOR], 1);
+}
+
+/**
+  * @brief  Suspend the sector erase started without waiting, if it is still
+  *         running, for a read. The erase is given MX25R6435F_SUSPEND_INTERVAL
+  *         ms after its start or last resume. An ended erase is checked and no
+  *         longer pending.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pSuspended : Set to 1 if the erase was suspended, to resume it
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_EraseSuspend(QSPI_t *obj, uint8_t *pSuspended)
+{
+  uint8_t status;
+
+  *pSuspended = 0;
+
+  if (QSPI_EnterIndirectMode(obj) != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  status = QSPI_ReadStatus(&(obj->handle));
+
+  /* Already suspended by BSP_QSPI_SuspendErase() */
+  if (status == QSPI_SUSPENDED) {
+    return QSPI_RestoreMappedMode(obj, QSPI_OK);
+  }
+
+  /* Ended: check its result now, so that the next reads take the usual path.
+     A failure is retried, or retires the sector, it doesn't fail the read. */
+  if (status != QSPI_BUSY) {
+    QSPI_EraseCheck(obj);
+    return QSPI_RestoreMappedMode(obj, QSPI_OK);
+  }
+
+  while ((HAL_GetTick() - obj->async_resume_tick) < MX25R6435F_SUSPEND_INTERVAL) {
+  }
+
+  /* Checks the erase suspend bit once the command is sent */
+  if (QSPI_SuspendMemory(&(obj->handle)) != QSPI_OK) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  *pSuspended = 1;
+
+  return QSPI_RestoreMappedMode(obj, QSPI_OK);
+}
+
+/**
+  * @brief  Resume the sector erase suspended by QSPI_EraseSuspend().
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  status : Status of the read
+  * @retval status, or QSPI_ERROR if the erase could not be resumed
+  */
+static uint8_t QSPI_EraseResume(QSPI_t *obj, uint8_t status)
+{
+  if ((QSPI_EnterIndirectMode(obj) != QSPI_OK) || (QSPI_ResumeMemory(&(obj->handle)) != QSPI_OK)) {
+    return QSPI_RestoreMappedMode(obj, QSPI_ERROR);
+  }
+
+  obj->async_resume_tick = HAL_GetTick();
+
+  return QSPI_RestoreMappedMode(obj, status);
+}
+
+/**
+  * @brief  Suspend the sector erase started without waiting, if it is still
+  *         running, until the end of an asynchronous read.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_EraseSuspendAsync(QSPI_t *obj)
+{
+  obj->erase_suspended = 0;
+
+  if (obj->erase_pending == 0) {
+    return QSPI_OK;
+  }
+
+  return QSPI_EraseSuspend(obj, &(obj->erase_suspended));
+}
+
+/**
+  * @brief  Resume the sector erase suspended by QSPI_EraseSuspendAsync() when
+  *         the asynchronous read is not started or is done without interrupt.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  status : Status of the read
+  * @retval status, or QSPI_ERROR if the erase could not be resumed
+  */
+static uint8_t QSPI_EraseResumeAsync(QSPI_t *obj, uint8_t status)
+{
+  if (obj->erase_suspended == 0) {
+    return status;
+  }
+
+  obj->erase_suspended = 0;
+
+  return QSPI_EraseResume(obj, status);
+}
+
+/**
+  * @brief  This function checks the result of the last program or erase in
+  *         the security register.
+  * @param  hxspi : QSPI handle
+  * @param  Flag  : MX25R6435F_SECR_P_FAIL or MX25R6435F_SECR_E_FAIL
+  * @param  pFail : Set to 1 if the operation failed, else 0
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_CheckFail(XSPI_HandleTypeDef *hxspi, uint8_t Flag, uint8_t *pFail)
+{
+  uint8_t reg;
+
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_SEC_REG, &reg, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  *pFail = ((reg & Flag) != 0) ? 1 : 0;
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function retires the sector containing an address. The table
+  *         is saved by BSP_QSPI_Flush().
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Address in the sector
+  * @retval None
+  */
+static void QSPI_Retire(QSPI_t *obj, uint32_t Address)
+{
+#if MX25R6435F_RETIRED_TABLE
+  uint32_t sector = Address / obj->info.EraseSectorSize;
+
+  if ((sector < MX25R6435F_RETIRED_SECTORS) && ((obj->retired_map[sector / 8] & (1U << (sector % 8))) != 0)) {
+    obj->retired_map[sector / 8] &= ~(1U << (sector % 8));
+    obj->retired_dirty = 1;
+  }
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+#endif
+}
+
+/**
+  * @brief  This function notes an erased area: the table of the retired
+  *         sectors is written again if it was in the area.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Start address of the area
+  * @param  Size    : Size of the area
+  * @retval None
+  */
+static void QSPI_RetiredErased(QSPI_t *obj, uint32_t Address, uint32_t Size)
+{
+#if MX25R6435F_RETIRED_TABLE
+  uint32_t table = obj->retired_table;
+
+  if ((table >= Address) && ((table - Address) < Size)) {
+    obj->retired_dirty = 1;
+  }
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+  UNUSED(Size);
+#endif
+}
+
+/**
+  * @brief  This function reads the table of the retired sectors. If the
+  *         header is not found, the table is created in its sector only if
+  *         the sector is erased: other data are never erased.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_RetiredLoad(QSPI_t *obj)
+{
+#if MX25R6435F_RETIRED_TABLE
+  uint32_t sector = MX25R6435F_RETIRED_TABLE_SECTOR;
+  uint32_t magic;
+  uint8_t blank;
+
+  /* By default, the last sector of the memory found */
+  if (sector == MX25R6435F_RETIRED_TABLE_LAST) {
+    sector = obj->info.EraseSectorsNumber - 1;
+  }
+
+  obj->retired_dirty = 0;
+  obj->retired_table = sector * obj->info.EraseSectorSize;
+
+  if ((sector >= obj->info.EraseSectorsNumber) || (sector >= MX25R6435F_RETIRED_SECTORS) ||
+      (QSPI_ReadDirect(obj, (uint8_t *)&magic, obj->retired_table, sizeof(magic)) != QSPI_OK) ||
+      (QSPI_ReadDirect(obj, obj->retired_map, obj->retired_table + MX25R6435F_PAGE_SIZE,
+                       sizeof(obj->retired_map)) != QSPI_OK)) {
+    return QSPI_ERROR;
+  }
+
+  if (magic != QSPI_RETIRED_MAGIC) {
+    if ((QSPI_ScanBlank(obj, obj->retired_table, obj->info.EraseSectorSize, &blank) != QSPI_OK) || (blank == 0)) {
+      core_debug("ERROR: sector of the retired table is not erased\n");
+      return QSPI_ERROR;
+    }
+
+    /* The header is written at once, the map is programmed by the saves */
+    memset(obj->retired_map, 0xFF, sizeof(obj->retired_map));
+    magic = QSPI_RETIRED_MAGIC;
+    if (QSPI_Program(obj, (uint8_t *)&magic, obj->retired_table, sizeof(magic)) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+  }
+
+  /* The sector of the table is reserved */
+  obj->retired_map[sector / 8] &= ~(1U << (sector % 8));
+#else
+  UNUSED(obj);
+#endif
+
+  return QSPI_OK;
+}
+
+#if MX25R6435F_RETIRED_TABLE
+/**
+  * @brief  This function saves the table of the retired sectors if it
+  *         changed. The table is programmed again without erase, its bits
+  *         only go from 1 to 0. The memory must be in indirect mode.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval None
+  */
+static void QSPI_RetiredSave(QSPI_t *obj)
+{
+  uint32_t table = obj->retired_table;
+  uint32_t magic = QSPI_RETIRED_MAGIC;
+
+  if (obj->retired_dirty == 0) {
+    return;
+  }
+  obj->retired_dirty = 0;
+
+  QSPI_BlankMapUpdate(obj, table, obj->info.EraseSectorSize, 0);
+  QSPI_ReadCacheInvalidate(obj, table, obj->info.EraseSectorSize);
+
+  /* The header first, written again after an erase of the sector, so that
+     an interrupted save leaves a table found at next initialization. A failure
+     retires the sector of the table, already retired: no new save. */
+  if (QSPI_Program(obj, (uint8_t *)&magic, table, sizeof(magic)) == QSPI_OK) {
+    QSPI_Program(obj, obj->retired_map, table + MX25R6435F_PAGE_SIZE, sizeof(obj->retired_map));
+  }
+}
+#endif /* MX25R6435F_RETIRED_TABLE */
+
+/**
+  * @brief  This function selects the largest erase starting at an address
+  *         and contained in an area.
+  * @param  pInfo   : pointer on the configuration structure
+  * @param  Address : Start address of the area
+  * @param  Size    : Size of the area
+  * @retval Erase granularity, QSPI_ERASE_NUMBER if no erase fits
+  */
+static uint8_t QSPI_EraseType(const QSPI_Info *pInfo, uint32_t Address, uint32_t Size)
+{
+  uint8_t type = QSPI_ERASE_CHIP;
+
+  if ((Address == 0) && (Size == pInfo->FlashSize)) {
+    return QSPI_ERASE_CHIP;
+  }
+
+  while (type-- > 0) {
+    if ((pInfo->EraseSize[type] != 0) && (Size >= pInfo->EraseSize[type]) &&
+        ((Address % pInfo->EraseSize[type]) == 0)) {
+      return type;
+    }
+  }
+
+  return QSPI_ERASE_NUMBER;
+}
+
+/**
+  * @brief  This function reads an area of the memory and checks it is erased.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Start address of the area
+  * @param  Size    : Size of the area
+  * @param  pBlank  : Set to 1 if all the bytes are 0xFF, else 0
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ScanBlank(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t *pBlank)
+{
+  uint32_t buffer[QSPI_BLANK_CHUNK_SIZE / 4];
+  uint32_t current_size;
+
+  /* The mapped window is checked in place */
+  if (HAL_XSPI_GetState(&(obj->handle)) == HAL_XSPI_STATE_BUSY_MEM_MAPPED) {
+    *pBlank = qspi_isErased(qspi_getMappedAddress(obj) + Address, Size);
+    return QSPI_OK;
+  }
+
+  *pBlank = 1;
+
+  while ((Size > 0) && (*pBlank != 0)) {
+    current_size = (Size > QSPI_BLANK_CHUNK_SIZE) ? QSPI_BLANK_CHUNK_SIZE : Size;
+
+    if (BSP_QSPI_Read(obj, (uint8_t *)buffer, Address, current_size) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    *pBlank  = qspi_isErased((uint8_t *)buffer, current_size);
+    Address += current_size;
+    Size    -= current_size;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function returns whether the sector containing an address is
+  *         known to be erased.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Address in the sector
+  * @retval 1 if the sector is known to be erased, else 0
+  */
+static uint8_t QSPI_BlankMapGet(QSPI_t *obj, uint32_t Address)
+{
+#if MX25R6435F_BLANK_MAP
+  uint32_t sector = Address / obj->info.EraseSectorSize;
+
+  if (sector < MX25R6435F_BLANK_MAP_SECTORS) {
+    return (obj->blank_map[sector / 32] >> (sector % 32)) & 0x1;
+  }
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+#endif
+  return 0;
+}
+
+/**
+  * @brief  This function updates the map of the erased sectors.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Start address of the area
+  * @param  Size    : Size of the area
+  * @param  Blank   : 1 if the area is erased (entire sectors only), 0 if the
+  *                   sectors of the area may not be erased anymore
+  * @retval None
+  */
+static void QSPI_BlankMapUpdate(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t Blank)
+{
+#if MX25R6435F_BLANK_MAP
+  uint32_t sector = Address / obj->info.EraseSectorSize;
+  uint32_t end = (Address + Size + obj->info.EraseSectorSize - 1) / obj->info.EraseSectorSize;
+
+  for (; (sector < end) && (sector < MX25R6435F_BLANK_MAP_SECTORS); sector++) {
+    if (Blank != 0) {
+      obj->blank_map[sector / 32] |= (1UL << (sector % 32));
+    } else {
+      obj->blank_map[sector / 32] &= ~(1UL << (sector % 32));
+    }
+  }
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+  UNUSED(Size);
+  UNUSED(Blank);
+#endif
+}
+
+/**
+  * @brief  This function programs an amount of data page by page. A page
+  *         reported failed by the memory is programmed again, then its sector
+  *         is retired.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_Program(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
+{
+  XSPI_HandleTypeDef *hxspi = &(obj->handle);
+  uint32_t end_addr, current_size, current_addr;
+  uint8_t retry = 0;
+  uint8_t fail;
+
+  /* Calculation of the size between the write address and the end of the page */
+  current_size = MX25R6435F_PAGE_SIZE - (WriteAddr % MX25R6435F_PAGE_SIZE);
+
+  /* Check if the size of the data is less than the remaining place in the page */
+  if (current_size > Size) {
+    current_size = Size;
+  }
+
+  /* Initialize the adress variables */
+  current_addr = WriteAddr;
+  end_addr = WriteAddr + Size;
+
+  /* Perform the write page by page */
+  do {
+    QSPI_STATS(obj, QSPI_STATS_PAGE_PROGRAM, current_size);
+
+    /* Enable write operations */
+    if (QSPI_WriteEnable(hxspi) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    /* Configure the command */
+    if (QSPI_Command(hxspi, QSPI_CMD_PAGE_PROG, current_addr, current_size) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    /* Transmission of the data */
+    if (HAL_XSPI_Transmit(hxspi, pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+      return QSPI_ERROR;
+    }
+
+    /* Configure automatic polling mode to wait for end of program, then check its result */
+    if ((QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) ||
+        (QSPI_CheckFail(hxspi, MX25R6435F_SECR_P_FAIL, &fail) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+
+    /* Program the same page again */
+    if (fail != 0) {
+      if (retry++ < MX25R6435F_PROGRAM_RETRIES) {
+        continue;
+      }
+      QSPI_Retire(obj, current_addr);
+      return QSPI_ERROR;
+    }
+    retry = 0;
+
+    /* Update the address and size variables for next page programming */
+    current_addr += current_size;
+    pData += current_size;
+    current_size = ((current_addr + MX25R6435F_PAGE_SIZE) > end_addr) ? (end_addr - current_addr) : MX25R6435F_PAGE_SIZE;
+  } while (current_addr < end_addr);
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function reads an amount of data with a read command.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData    : Pointer to data to be read
+  * @param  ReadAddr : Read start address
+  * @param  Size     : Size of data to read
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadDirect(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size)
+{
+  /* Configure the command */
+  if (QSPI_ReadCommand(obj, ReadAddr, Size) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Reception of the data */
+  if (HAL_XSPI_Receive(&(obj->handle), pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+#if MX25R6435F_READ_CACHE
+/**
+  * @brief  This function reads an amount of data through the read cache. A
+  *         miss fills one line, or all the lines if it follows the last filled
+  *         line (sequential read).
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData    : Pointer to data to be read
+  * @param  ReadAddr : Read start address
+  * @param  Size     : Size of data to read
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadCached(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size)
+{
+  uint32_t line_addr, offset, current_size, lines, i;
+  uint8_t n;
+
+  while (Size > 0) {
+    offset = ReadAddr % MX25R6435F_READ_CACHE_LINE_SIZE;
+    line_addr = ReadAddr - offset;
+    current_size = MX25R6435F_READ_CACHE_LINE_SIZE - offset;
+    if (current_size > Size) {
+      current_size = Size;
+    }
+
+    for (n = 0; (n < MX25R6435F_READ_CACHE) && (obj->rcache_addr[n] != line_addr); n++) {
+    }
+
+    if (n == MX25R6435F_READ_CACHE) {
+      if (line_addr >= obj->info.FlashSize) {
+        return QSPI_ERROR;
+      }
+
+      /* Read ahead the next lines of a sequential read, up to the end of the memory */
+      lines = (line_addr == obj->rcache_next) ? MX25R6435F_READ_CACHE : 1;
+      if (lines > ((obj->info.FlashSize - line_addr) / MX25R6435F_READ_CACHE_LINE_SIZE)) {
+        lines = (obj->info.FlashSize - line_addr) / MX25R6435F_READ_CACHE_LINE_SIZE;
+      }
+      n = ((obj->rcache_slot + lines) > MX25R6435F_READ_CACHE) ? 0 : obj->rcache_slot;
+
+      for (i = 0; i < lines; i++) {
+        obj->rcache_addr[n + i] = QSPI_CACHE_FREE;
+      }
+
+      if (QSPI_ReadDirect(obj, obj->rcache[n], line_addr, lines * MX25R6435F_READ_CACHE_LINE_SIZE) != QSPI_OK) {
+        return QSPI_ERROR;
+      }
+
+      for (i = 0; i < lines; i++) {
+        obj->rcache_addr[n + i] = line_addr + (i * MX25R6435F_READ_CACHE_LINE_SIZE);
+      }
+      obj->rcache_slot = (n + lines) % MX25R6435F_READ_CACHE;
+      obj->rcache_next = line_addr + (lines * MX25R6435F_READ_CACHE_LINE_SIZE);
+    }
+
+    memcpy(pData, obj->rcache[n] + offset, current_size);
+
+    pData    += current_size;
+    ReadAddr += current_size;
+    Size     -= current_size;
+  }
+
+  return QSPI_OK;
+}
+#endif /* MX25R6435F_READ_CACHE */
+
+/**
+  * @brief  This function drops the read cache lines of a modified area.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Start address of the area
+  * @param  Size    : Size of the area
+  * @retval None
+  */
+static void QSPI_ReadCacheInvalidate(QSPI_t *obj, uint32_t Address, uint32_t Size)
+{
+#if MX25R6435F_READ_CACHE
+  for (uint8_t n = 0; n < MX25R6435F_READ_CACHE; n++) {
+    if ((obj->rcache_addr[n] != QSPI_CACHE_FREE) && (obj->rcache_addr[n] < (Address + Size)) &&
+        ((obj->rcache_addr[n] + MX25R6435F_READ_CACHE_LINE_SIZE) > Address)) {
+      obj->rcache_addr[n] = QSPI_CACHE_FREE;
+    }
+  }
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+  UNUSED(Size);
+#endif
+}
+
+/**
+  * @brief  This function programs an amount of data, leaving the memory-mapped
+  *         mode during the programming.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_WriteDirect(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
+{
+  uint8_t status = QSPI_EnterIndirectMode(obj);
+
+  QSPI_ReadCacheInvalidate(obj, WriteAddr, Size);
+
+  /* The previous erase is completed first */
+  if (status == QSPI_OK) {
+    status = QSPI_EraseCheck(obj);
+  }
+
+  if (status == QSPI_OK) {
+    status = QSPI_Program(obj, pData, WriteAddr, Size);
+  }
+
+  return QSPI_RestoreMappedMode(obj, status);
+}
+
+/**
+  * @brief  This function checks the areas of a vectored operation and sorts
+  *         them by address (insertion sort, the vectors are short).
+  * @param  pVec  : Array of the areas
+  * @param  Count : Number of areas
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_SortVec(QSPI_IoVec *pVec, uint32_t Count)
+{
+  QSPI_IoVec vec;
+  uint32_t i, j;
+
+  if ((pVec == NULL) || (Count == 0)) {
+    return QSPI_ERROR;
+  }
+
+  for (i = 0; i < Count; i++) {
+    if ((pVec[i].pData == NULL) && (pVec[i].Size != 0)) {
+      return QSPI_ERROR;
+    }
+
+    vec = pVec[i];
+    for (j = i; (j > 0) && (pVec[j - 1].Address > vec.Address); j--) {
+      pVec[j] = pVec[j - 1];
+    }
+    pVec[j] = vec;
+  }
+
+  return QSPI_OK;
+}
+
+#if MX25R6435F_WRITE_CACHE
+/**
+  * @brief  This function writes an amount of data in the write cache. The data
+  *         is ANDed with the slot content, as programming does in the memory.
+  *         Entire slots not in the cache are programmed directly.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_CacheWrite(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size)
+{
+  QSPI_CacheSlot *slot;
+  uint32_t offset, current_size, i;
+  uint8_t n;
+
+  while (Size > 0) {
+    offset = WriteAddr % MX25R6435F_WRITE_CACHE_SLOT_SIZE;
+    current_size = MX25R6435F_WRITE_CACHE_SLOT_SIZE - offset;
+    if (current_size > Size) {
+      current_size = Size;
+    }
+
+    /* Look for the slot, or the least recently used one */
+    slot = &(obj->wcache[0]);
+    for (n = 0; n < MX25R6435F_WRITE_CACHE; n++) {
+      if (obj->wcache[n].addr == (WriteAddr - offset)) {
+        slot = &(obj->wcache[n]);
+        break;
+      }
+      if ((obj->wcache[n].addr == QSPI_CACHE_FREE) ||
+          ((slot->addr != QSPI_CACHE_FREE) && (obj->wcache[n].used < slot->used))) {
+        slot = &(obj->wcache[n]);
+      }
+    }
+
+    if (slot->addr != (WriteAddr - offset)) {
+      if (current_size == MX25R6435F_WRITE_CACHE_SLOT_SIZE) {
+        slot = NULL;
+      } else if (QSPI_CacheFlushSlot(obj, slot) != QSPI_OK) {
+        return QSPI_ERROR;
+      } else {
+        slot->addr = WriteAddr - offset;
+        memset(slot->data, 0xFF, MX25R6435F_WRITE_CACHE_SLOT_SIZE);
+      }
+    }
+
+    if (slot == NULL) {
+      if (QSPI_WriteDirect(obj, pData, WriteAddr, current_size) != QSPI_OK) {
+        return QSPI_ERROR;
+      }
+    } else {
+      for (i = 0; i < current_size; i++) {
+        slot->data[offset + i] &= pData[i];
+      }
+      slot->used = ++obj->wcache_stamp;
+    }
+
+    pData     += current_size;
+    WriteAddr += current_size;
+    Size      -= current_size;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function programs the pages of a write cache slot and frees it.
+  *         The erased pages are not programmed.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pSlot : pointer to the slot
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_CacheFlushSlot(QSPI_t *obj, QSPI_CacheSlot *pSlot)
+{
+  uint32_t offset;
+
+  if (pSlot->addr == QSPI_CACHE_FREE) {
+    return QSPI_OK;
+  }
+
+  for (offset = 0; offset < MX25R6435F_WRITE_CACHE_SLOT_SIZE; offset += MX25R6435F_PAGE_SIZE) {
+    if ((qspi_isErased(pSlot->data + offset, MX25R6435F_PAGE_SIZE) == 0) &&
+        (QSPI_WriteDirect(obj, pSlot->data + offset, pSlot->addr + offset, MX25R6435F_PAGE_SIZE) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+  }
+
+  pSlot->addr = QSPI_CACHE_FREE;
+
+  return QSPI_OK;
+}
+#endif /* MX25R6435F_WRITE_CACHE */
+
+/**
+  * @brief  This function applies the data of the write cache to read data.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData    : Pointer to the read data
+  * @param  ReadAddr : Read start address
+  * @param  Size     : Size of the read data
+  * @retval None
+  */
+static void QSPI_CacheMerge(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size)
+{
+#if MX25R6435F_WRITE_CACHE
+  QSPI_CacheSlot *slot;
+  uint32_t start, end, i;
+
+  for (uint8_t n = 0; n < MX25R6435F_WRITE_CACHE; n++) {
+    slot = &(obj->wcache[n]);
+    if ((slot->addr == QSPI_CACHE_FREE) ||
+        (slot->addr >= (ReadAddr + Size)) || ((slot->addr + MX25R6435F_WRITE_CACHE_SLOT_SIZE) <= ReadAddr)) {
+      continue;
+    }
+
+    start = (slot->addr > ReadAddr) ? slot->addr : ReadAddr;
+    end = ((slot->addr + MX25R6435F_WRITE_CACHE_SLOT_SIZE) < (ReadAddr + Size)) ?
+          (slot->addr + MX25R6435F_WRITE_CACHE_SLOT_SIZE) : (ReadAddr + Size);
+
+    for (i = start; i < end; i++) {
+      pData[i - ReadAddr] &= slot->data[i - slot->addr];
+    }
+  }
+#else
+  UNUSED(obj);
+  UNUSED(pData);
+  UNUSED(ReadAddr);
+  UNUSED(Size);
+#endif
+}
+
+/**
+  * @brief  This function drops the write cache slots of an erased area.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  Address : Start address of the area, aligned on a sector
+  * @param  Size    : Size of the area
+  * @retval None
+  */
+static void QSPI_CacheDiscard(QSPI_t *obj, uint32_t Address, uint32_t Size)
+{
+#if MX25R6435F_WRITE_CACHE
+  for (uint8_t n = 0; n < MX25R6435F_WRITE_CACHE; n++) {
+    if ((obj->wcache[n].addr != QSPI_CACHE_FREE) &&
+        (obj->wcache[n].addr >= Address) && ((obj->wcache[n].addr - Address) < Size)) {
+      obj->wcache[n].addr = QSPI_CACHE_FREE;
+    }
+  }
+#else
+  UNUSED(obj);
+  UNUSED(Address);
+  UNUSED(Size);
+#endif
+}
+
+/**
+  * @brief  This function programs the pages of an area in a sector which
+  *         differ from the data, as long as no bit has to go from 0 to 1.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write, in the sector
+  * @param  pErase    : Set to 1 if the sector has to be erased, the
+  *                     programming is stopped at the first page needing it
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ProgramInPlace(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, uint8_t *pErase)
+{
+  uint8_t page[MX25R6435F_PAGE_SIZE];
+  uint8_t blank = QSPI_BlankMapGet(obj, WriteAddr);
+  uint32_t current_size, i;
+
+  *pErase = 0;
+
+  while (Size > 0) {
+    current_size = MX25R6435F_PAGE_SIZE - (WriteAddr % MX25R6435F_PAGE_SIZE);
+    if (current_size > Size) {
+      current_size = Size;
+    }
+
+    /* Read the current content, unless the sector is known to be erased */
+    if (blank != 0) {
+      memset(page, 0xFF, current_size);
+    } else if (BSP_QSPI_Read(obj, page, WriteAddr, current_size) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    for (i = 0; i < current_size; i++) {
+      if ((page[i] & pData[i]) != pData[i]) {
+        *pErase = 1;
+        return QSPI_OK;
+      }
+    }
+
+    if ((memcmp(page, pData, current_size) != 0) &&
+        (BSP_QSPI_Write(obj, pData, WriteAddr, current_size) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+
+    pData     += current_size;
+    WriteAddr += current_size;
+    Size      -= current_size;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function erases a sector and programs it back with the data
+  *         merged in its previous content. The erased pages are not programmed.
+  * @param  obj : pointer to QSPI_t structure
+  * @param  pData     : Pointer to data to be written
+  * @param  WriteAddr : Write start address
+  * @param  Size      : Size of data to write, in the sector
+  * @param  pSector   : Buffer of EraseSectorSize bytes
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_RewriteSector(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, uint8_t *pSector)
+{
+  uint32_t sector_size = obj->info.EraseSectorSize;
+  uint32_t sector_addr = WriteAddr - (WriteAddr % sector_size);
+  uint32_t offset;
+
+  if (pSector == NULL) {
+    return QSPI_ERROR;
+  }
+
+  if (BSP_QSPI_Read(obj, pSector, sector_addr, sector_size) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  memcpy(pSector + (WriteAddr - sector_addr), pData, Size);
+
+  if (QSPI_Erase(obj, QSPI_CMD_SECTOR_ERASE, sector_addr, obj->info.EraseMaxTime[QSPI_ERASE_SECTOR]) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  for (offset = 0; offset < sector_size; offset += MX25R6435F_PAGE_SIZE) {
+    if ((qspi_isErased(pSector + offset, MX25R6435F_PAGE_SIZE) == 0) &&
+        (BSP_QSPI_Write(obj, pSector + offset, sector_addr + offset, MX25R6435F_PAGE_SIZE) != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function reads the status of the memory from the security
+  *         and status registers.
+  * @param  hxspi : QSPI handle
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadStatus(XSPI_HandleTypeDef *hxspi)
+{
+  uint8_t reg;
+
+  /* Read the security register */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_SEC_REG, &reg, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Check the value of the register */
+  if ((reg & (MX25R6435F_SECR_P_FAIL | MX25R6435F_SECR_E_FAIL)) != 0) {
+    return QSPI_ERROR;
+  } else if ((reg & (MX25R6435F_SECR_PSB | MX25R6435F_SECR_ESB)) != 0) {
+    return QSPI_SUSPENDED;
+  }
+
+  /* Read the status register */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_STATUS_REG, &reg, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Check the value of the register */
+  if ((reg & MX25R6435F_SR_WIP) != 0) {
+    return QSPI_BUSY;
+  } else {
+    return QSPI_OK;
+  }
+}
+
+/**
+  * @brief  This function suspends the program or erase in progress, if any.
+  * @param  hxspi : QSPI handle
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_SuspendMemory(XSPI_HandleTypeDef *hxspi)
+{
+  /* Check whether the device is busy (program or erase operation is
+  in progress).
+  */
+  if (QSPI_ReadStatus(hxspi) == QSPI_BUSY) {
+    /* Send the command */
+    if ((QSPI_Command(hxspi, QSPI_CMD_SUSPEND, 0, 0) != QSPI_OK) ||
+        (QSPI_ReadStatus(hxspi) != QSPI_SUSPENDED)) {
+      return QSPI_ERROR;
+    }
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function resumes the suspended program or erase, if any.
+  * @param  hxspi : QSPI handle
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ResumeMemory(XSPI_HandleTypeDef *hxspi)
+{
+  uint8_t status;
+
+  /* Check whether the device is in suspended state */
+  if (QSPI_ReadStatus(hxspi) == QSPI_SUSPENDED) {
+    /* Send the command */
+    /*
+    When this command is executed, the status register write in progress bit is set to 1, and
+    the flag status register program erase controller bit is set to 0. This command is ignored
+    if the device is not in a suspended state.
+    The end of a short page program may already be reached when the status is read.
+    */
+    if (QSPI_Command(hxspi, QSPI_CMD_RESUME, 0, 0) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    status = QSPI_ReadStatus(hxspi);
+    if ((status != QSPI_BUSY) && (status != QSPI_OK)) {
+      return QSPI_ERROR;
+    }
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function reads a register of the memory.
+  * @param  hxspi : QSPI handle
+  * @param  Cmd   : Index of the read register command template
+  * @param  pData : Pointer to the register value
+  * @param  Size  : Number of bytes to read
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadRegister(XSPI_HandleTypeDef *hxspi, QSPI_CmdTypeDef Cmd, uint8_t *pData, uint32_t Size)
+{
+  if (QSPI_Command(hxspi, Cmd, 0, Size) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_XSPI_Receive(hxspi, pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function reads the serial flash discoverable parameters.
+  * @param  hxspi   : QSPI handle
+  * @param  Address : Address in the SFDP area
+  * @param  pData   : Pointer to data to be read
+  * @param  Size    : Size of data to read
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadSFDP(XSPI_HandleTypeDef *hxspi, uint32_t Address, uint8_t *pData, uint32_t Size)
+{
+  if (QSPI_Command(hxspi, QSPI_CMD_READ_SFDP, Address, Size) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_XSPI_Receive(hxspi, pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function sets the parameters of the MX25R6435F.
+  * @param  pInfo : pointer on the configuration structure
+  * @retval None
+  */
+static void QSPI_DefaultInfo(QSPI_Info *pInfo)
+{
+  pInfo->FlashSize          = MX25R6435F_FLASH_SIZE;
+  pInfo->EraseSectorSize    = MX25R6435F_SECTOR_SIZE;
+  pInfo->EraseSectorsNumber = (MX25R6435F_FLASH_SIZE / MX25R6435F_SECTOR_SIZE);
+  pInfo->ProgPageSize       = MX25R6435F_PAGE_SIZE;
+  pInfo->ProgPagesNumber    = (MX25R6435F_FLASH_SIZE / MX25R6435F_PAGE_SIZE);
+  pInfo->JedecId            = MX25R6435F_JEDEC_ID;
+
+  pInfo->EraseSize[QSPI_ERASE_SECTOR]      = MX25R6435F_SECTOR_SIZE;
+  pInfo->EraseSize[QSPI_ERASE_SUBBLOCK]    = MX25R6435F_SUBBLOCK_SIZE;
+  pInfo->EraseSize[QSPI_ERASE_BLOCK]       = MX25R6435F_BLOCK_SIZE;
+  pInfo->EraseSize[QSPI_ERASE_CHIP]        = MX25R6435F_FLASH_SIZE;
+  pInfo->EraseTypTime[QSPI_ERASE_SECTOR]   = MX25R6435F_SECTOR_ERASE_TYP_TIME;
+  pInfo->EraseTypTime[QSPI_ERASE_SUBBLOCK] = MX25R6435F_SUBBLOCK_ERASE_TYP_TIME;
+  pInfo->EraseTypTime[QSPI_ERASE_BLOCK]    = MX25R6435F_BLOCK_ERASE_TYP_TIME;
+  pInfo->EraseTypTime[QSPI_ERASE_CHIP]     = MX25R6435F_CHIP_ERASE_TYP_TIME;
+  pInfo->EraseMaxTime[QSPI_ERASE_SECTOR]   = MX25R6435F_SECTOR_ERASE_MAX_TIME;
+  pInfo->EraseMaxTime[QSPI_ERASE_SUBBLOCK] = MX25R6435F_SUBBLOCK_ERASE_MAX_TIME;
+  pInfo->EraseMaxTime[QSPI_ERASE_BLOCK]    = MX25R6435F_BLOCK_ERASE_MAX_TIME;
+  pInfo->EraseMaxTime[QSPI_ERASE_CHIP]     = MX25R6435F_CHIP_ERASE_MAX_TIME;
+
+  pInfo->ReadInstruction    = QUAD_INOUT_READ_CMD;
+  pInfo->ReadDummyCycles    = MX25R6435F_DUMMY_CYCLES_READ_QUAD;
+}
+
+/**
+  * @brief  This function reads the JEDEC ID and the basic flash parameter
+  *         table of the SFDP to find the size, the erase types and times and
+  *         the quad read configuration of the memory. The MX25R6435F values
+  *         are kept for the parameters the memory doesn't describe.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_Discover(QSPI_t *obj)
+{
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+  QSPI_Info *info = &(obj->info);
+  uint8_t id[QSPI_JEDEC_ID_SIZE];
+  uint8_t header[QSPI_SFDP_HEADER_SIZE];
+  uint32_t bfpt[QSPI_SFDP_BFPT_MAX];
+  uint32_t signature, length, size, field, multiplier;
+  uint8_t i, type;
+
+  QSPI_DefaultInfo(info);
+
+  /* Read the JEDEC ID: manufacturer, memory type and density */
+  if (QSPI_ReadRegister(handle, QSPI_CMD_READ_ID, id, QSPI_JEDEC_ID_SIZE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  info->JedecId = ((uint32_t)id[0] << 16) | ((uint32_t)id[1] << 8) | id[2];
+
+  /* Macronix density code is the log2 of the size in bytes */
+  if ((id[0] == MX25R6435F_MANUFACTURER_ID) && (id[2] >= 0x10) && (id[2] < 0x20)) {
+    info->FlashSize = 1UL << id[2];
+  }
+
+  /* Read the SFDP header and the first parameter header */
+  if (QSPI_ReadSFDP(handle, 0, header, QSPI_SFDP_HEADER_SIZE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  signature = header[0] | (header[1] << 8) | (header[2] << 16) | ((uint32_t)header[3] << 24);
+  length = header[11];
+
+  if ((signature == QSPI_SFDP_SIGNATURE) && (header[8] == QSPI_SFDP_BFPT_ID) &&
+      (length >= QSPI_SFDP_BFPT_MIN)) {
+    if (length > QSPI_SFDP_BFPT_MAX) {
+      length = QSPI_SFDP_BFPT_MAX;
+    }
+
+    /* Read the basic flash parameter table, little endian DWORDs as the core */
+    if (QSPI_ReadSFDP(handle, (header[14] << 16) | (header[13] << 8) | header[12],
+                      (uint8_t *)bfpt, length * 4) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+
+    /* 2nd DWORD: density in bits */
+    if ((bfpt[1] & 0x80000000) == 0) {
+      info->FlashSize = (bfpt[1] / 8) + 1;
+    } else if (((bfpt[1] & 0x7FFFFFFF) > 3) && ((bfpt[1] & 0x7FFFFFFF) < 35)) {
+      info->FlashSize = 1UL << ((bfpt[1] & 0x7FFFFFFF) - 3);
+    }
+
+    /* 1st and 3rd DWORDs: 1-4-4 fast read, the 2 mode clocks are the alternate byte */
+    if (((bfpt[0] & (1UL << 21)) != 0) && (((bfpt[2] >> 5) & 0x7) == 2)) {
+      info->ReadInstruction = (bfpt[2] >> 8) & 0xFF;
+      info->ReadDummyCycles = bfpt[2] & 0x1F;
+    }
+
+    /* 8th and 9th DWORDs: size of the erase types */
+    for (type = QSPI_ERASE_SECTOR; type < QSPI_ERASE_CHIP; type++) {
+      size = info->EraseSize[type];
+      info->EraseSize[type] = 0;
+
+      for (i = 0; i < 4; i++) {
+        field = bfpt[7 + (i / 2)] >> ((i % 2) * 16);
+
+        if (((field & 0xFF) != 0) && ((field & 0xFF) < 32) && ((1UL << (field & 0xFF)) == size)) {
+          info->EraseSize[type] = size;
+
+          /* 10th DWORD: typical erase time and multiplier to the maximum time */
+          if (length >= 10) {
+            multiplier = 2 * ((bfpt[9] & 0xF) + 1);
+            field = bfpt[9] >> (4 + (i * 7));
+            info->EraseTypTime[type] = ((field & 0x1F) + 1) * qspi_sfdp_erase_unit[(field >> 5) & 0x3];
+            info->EraseMaxTime[type] = info->EraseTypTime[type] * multiplier;
+          }
+        }
+      }
+    }
+
+    /* 11th DWORD: typical chip erase time */
+    if (length >= 11) {
+      multiplier = 2 * ((bfpt[9] & 0xF) + 1);
+      field = bfpt[10] >> 24;
+      info->EraseTypTime[QSPI_ERASE_CHIP] = ((field & 0x1F) + 1) * qspi_sfdp_chip_erase_unit[(field >> 5) & 0x3];
+      info->EraseMaxTime[QSPI_ERASE_CHIP] = info->EraseTypTime[QSPI_ERASE_CHIP] * multiplier;
+    }
+  }
+
+  info->EraseSize[QSPI_ERASE_CHIP] = info->FlashSize;
+  info->EraseSectorSize    = (info->EraseSize[QSPI_ERASE_SECTOR] != 0) ? info->EraseSize[QSPI_ERASE_SECTOR] : MX25R6435F_SECTOR_SIZE;
+  info->EraseSectorsNumber = info->FlashSize / info->EraseSectorSize;
+  info->ProgPagesNumber    = info->FlashSize / info->ProgPageSize;
+
+  return QSPI_OK;
+}
+
+#ifdef OCTOSPI
+/**
+  * @brief  This function changes the clock and sampling configuration of
+  *         the OCTOSPI. The interface is re-initialized as the HAL only
+  *         applies its configuration from the reset state.
+  * @param  hxspi                 : QSPI handle
+  * @param  ClockPrescaler        : Division factor of the kernel clock
+  * @param  SampleShifting        : HAL_OSPI_SAMPLE_SHIFTING_xxx
+  * @param  DelayHoldQuarterCycle : HAL_OSPI_DHQC_xxx
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_SetTiming(XSPI_HandleTypeDef *hxspi, uint32_t ClockPrescaler, uint32_t SampleShifting, uint32_t DelayHoldQuarterCycle)
+{
+  if (HAL_OSPI_DeInit(hxspi) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  hxspi->Init.ClockPrescaler        = ClockPrescaler;
+  hxspi->Init.SampleShifting        = SampleShifting;
+  hxspi->Init.DelayHoldQuarterCycle = DelayHoldQuarterCycle;
+
+  if (HAL_OSPI_Init(hxspi) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function reads the pattern used to check the timing: the
+  *         SFDP header on 1 line and the beginning of the memory on 4 lines.
+  * @param  hxspi : QSPI handle
+  * @param  pSfdp : Pointer to QSPI_CALIB_SFDP_SIZE bytes
+  * @param  pData : Pointer to QSPI_CALIB_PATTERN_SIZE bytes
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadPattern(XSPI_HandleTypeDef *hxspi, uint8_t *pSfdp, uint8_t *pData)
+{
+  if (QSPI_ReadSFDP(hxspi, 0, pSfdp, QSPI_CALIB_SFDP_SIZE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (QSPI_Command(hxspi, QSPI_CMD_READ, 0, QSPI_CALIB_PATTERN_SIZE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_XSPI_Receive(hxspi, pData, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+#endif /* OCTOSPI */
+
+/**
+  * @brief  This function configures a quad read. In continuous read mode,
+  *         the mode bits keep the memory in performance enhance mode and the
+  *         instruction is skipped when the memory is already in this mode.
+  * @param  obj     : pointer to QSPI_t structure
+  * @param  Address : Read start address
+  * @param  NbData  : Size of data to read
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadCommand(QSPI_t *obj, uint32_t Address, uint32_t NbData)
+{
+  XSPI_CommandTypeDef sCommand = qspi_cmd[QSPI_CMD_READ];
+
+  sCommand.Instruction = obj->info.ReadInstruction;
+  sCommand.DummyCycles = obj->info.ReadDummyCycles;
+  sCommand.Address     = Address;
+  sCommand.NbData      = NbData;
+
+  if (obj->continuous_read) {
+    sCommand.AlternateBytes = MX25R6435F_ALT_BYTES_PE_MODE;
+    if (obj->enhanced) {
+#ifdef OCTOSPI
+      sCommand.InstructionMode = HAL_OSPI_INSTRUCTION_NONE;
+#else
+      sCommand.InstructionMode = QSPI_INSTRUCTION_NONE;
+#endif
+    }
+  }
+
+  if (HAL_XSPI_Command(&(obj->handle), &sCommand, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  obj->enhanced = obj->continuous_read;
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function makes the memory leave the performance enhance
+  *         mode, if needed, so it accepts other commands than read.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ExitContinuousRead(QSPI_t *obj)
+{
+  if (obj->enhanced) {
+    if (QSPI_Command(&(obj->handle), QSPI_CMD_RELEASE_READ_ENHANCED, 0, 0) != QSPI_OK) {
+      return QSPI_ERROR;
+    }
+    obj->enhanced = 0;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function configures the interface in memory-mapped mode.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_MemoryMapped(QSPI_t *obj)
+{
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+  XSPI_CommandTypeDef sCommand = qspi_cmd[QSPI_CMD_READ];
+  XSPI_MemoryMappedTypeDef sMemMappedCfg;
+
+  sCommand.Instruction = obj->info.ReadInstruction;
+  sCommand.DummyCycles = obj->info.ReadDummyCycles;
+
+  /* The first mapped access sends the instruction again */
+  if (QSPI_ExitContinuousRead(obj) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (obj->continuous_read) {
+    /* Only the address is sent for the next cache line refills */
+    sCommand.AlternateBytes = MX25R6435F_ALT_BYTES_PE_MODE;
+#ifdef OCTOSPI
+    sCommand.SIOOMode       = HAL_OSPI_SIOO_INST_ONLY_FIRST_CMD;
+#else
+    sCommand.SIOOMode       = QSPI_SIOO_INST_ONLY_FIRST_CMD;
+#endif
+  }
+
+#ifdef OCTOSPI
+  /* Configure the command for the read instruction */
+  sCommand.OperationType = HAL_OSPI_OPTYPE_READ_CFG;
+
+  if (HAL_OSPI_Command(handle, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Configure the command for the program instruction */
+  sCommand = qspi_cmd[QSPI_CMD_PAGE_PROG];
+  sCommand.OperationType = HAL_OSPI_OPTYPE_WRITE_CFG;
+
+  if (HAL_OSPI_Command(handle, &sCommand, HAL_OSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Configure the memory mapped mode */
+  sMemMappedCfg.TimeOutActivation = HAL_OSPI_TIMEOUT_COUNTER_DISABLE;
+
+  if (HAL_OSPI_MemoryMapped(handle, &sMemMappedCfg) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#else /* OCTOSPI */
+  /* Configure the memory mapped mode */
+  sMemMappedCfg.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+
+  if (HAL_QSPI_MemoryMapped(handle, &sCommand, &sMemMappedCfg) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#endif /* OCTOSPI */
+
+  obj->enhanced = obj->continuous_read;
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function leaves the memory-mapped mode, if active, and the
+  *         continuous read mode so that any command can be sent.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_EnterIndirectMode(QSPI_t *obj)
+{
+  if (HAL_XSPI_GetState(&(obj->handle)) == HAL_XSPI_STATE_BUSY_MEM_MAPPED) {
+    if (HAL_XSPI_Abort(&(obj->handle)) != HAL_OK) {
+      return QSPI_ERROR;
+    }
+  }
+
+  return QSPI_ExitContinuousRead(obj);
+}
+
+/**
+  * @brief  This function goes back to the memory-mapped mode if it was
+  *         enabled before an indirect operation.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  status : QSPI memory status of the indirect operation
+  * @retval status, or QSPI_ERROR if the memory-mapped mode can't be restored
+  */
+static uint8_t QSPI_RestoreMappedMode(QSPI_t *obj, uint8_t status)
+{
+  if ((obj->mapped != 0) && (QSPI_MemoryMapped(obj) != QSPI_OK)) {
+    return QSPI_ERROR;
+  }
+
+  return status;
+}
+
+/**
+  * @brief  This function reset the QSPI memory.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+static uint8_t QSPI_ResetMemory(XSPI_HandleTypeDef *hxspi)
+{
+  /* Leave the performance enhance mode possibly kept over a MCU reset */
+  if (QSPI_Command(hxspi, QSPI_CMD_RELEASE_READ_ENHANCED, 0, 0) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Send the reset enable command */
+  if (QSPI_Command(hxspi, QSPI_CMD_RESET_ENABLE, 0, 0) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Send the reset memory command */
+  if (QSPI_Command(hxspi, QSPI_CMD_RESET_MEMORY, 0, 0) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Configure automatic polling mode to wait the memory is ready */
+  if (QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function send a Write Enable and wait it is effective.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+static uint8_t QSPI_WriteEnable(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_STATS(qspi_getObj(hxspi), QSPI_STATS_WRITE_ENABLE, 0);
+
+  /* Enable write operations */
+  if (QSPI_Command(hxspi, QSPI_CMD_WRITE_ENABLE, 0, 0) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Configure automatic polling mode to wait for write enabling */
+  return QSPI_AutoPolling(hxspi, &qspi_polling_wel, HAL_XSPI_TIMEOUT_DEFAULT_VALUE);
+}
+
+/**
+  * @brief  This function polls the SR of the memory until
+  *         (SR & Mask) == Match.
+  * @param  hxspi   : QSPI handle
+  * @param  pConfig : Automatic polling template
+  * @param  Timeout : Timeout for auto-polling
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_AutoPolling(XSPI_HandleTypeDef *hxspi, const XSPI_AutoPollingTypeDef *pConfig, uint32_t Timeout)
+{
+  XSPI_AutoPollingTypeDef sConfig = *pConfig;
+
+#ifdef OCTOSPI
+  if (QSPI_Command(hxspi, QSPI_CMD_READ_STATUS_REG, 0, 0) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_OSPI_AutoPolling(hxspi, &sConfig, Timeout) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#else /* OCTOSPI */
+  QSPI_CommandTypeDef sCommand = qspi_cmd[QSPI_CMD_READ_STATUS_REG];
+
+  if (HAL_QSPI_AutoPolling(hxspi, &sCommand, &sConfig, Timeout) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#endif /* OCTOSPI */
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function read the SR of the memory and wait the EOP.
+  * @param  hxspi   : QSPI handle
+  * @param  Timeout : Timeout for auto-polling
+  * @retval None
+  */
+static uint8_t QSPI_AutoPollingMemReady(XSPI_HandleTypeDef *hxspi, uint32_t Timeout)
+{
+  QSPI_STATS(qspi_getObj(hxspi), QSPI_STATS_BUSY_POLL, 0);
+
+  return QSPI_AutoPolling(hxspi, &qspi_polling_ready, Timeout);
+}
+
+/**
+  * @brief  This function enables/disables the Quad mode of the memory.
+  * @param  hxspi     : QSPI handle
+  * @param  Operation : QSPI_QUAD_ENABLE or QSPI_QUAD_DISABLE mode
+  * @retval None
+  */
+static uint8_t QSPI_QuadMode(XSPI_HandleTypeDef *hxspi, uint8_t Operation)
+{
+  uint8_t reg;
+
+  /* Read status register */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_STATUS_REG, &reg, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Enable write operations */
+  if (QSPI_WriteEnable(hxspi) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Activate/deactivate the Quad mode */
+  if (Operation == QSPI_QUAD_ENABLE) {
+    SET_BIT(reg, MX25R6435F_SR_QE);
+  } else {
+    CLEAR_BIT(reg, MX25R6435F_SR_QE);
+  }
+
+  if (QSPI_Command(hxspi, QSPI_CMD_WRITE_STATUS_CFG_REG, 0, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_XSPI_Transmit(hxspi, &reg, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Wait that memory is ready */
+  if (QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Check the configuration has been correctly done */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_STATUS_REG, &reg, 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if ((((reg & MX25R6435F_SR_QE) == 0) && (Operation == QSPI_QUAD_ENABLE)) ||
+      (((reg & MX25R6435F_SR_QE) != 0) && (Operation == QSPI_QUAD_DISABLE))) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function enables/disables the high performance mode of the memory.
+  * @param  hxspi     : QSPI handle
+  * @param  Operation : QSPI_HIGH_PERF_ENABLE or QSPI_HIGH_PERF_DISABLE high performance mode
+  * @retval None
+  */
+static uint8_t QSPI_HighPerfMode(XSPI_HandleTypeDef *hxspi, uint8_t Operation)
+{
+  uint8_t reg[3];
+
+  /* Read status register */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_STATUS_REG, &(reg[0]), 1) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Read configuration registers */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_CFG_REG, &(reg[1]), 2) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Enable write operations */
+  if (QSPI_WriteEnable(hxspi) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Activate/deactivate the Quad mode */
+  if (Operation == QSPI_HIGH_PERF_ENABLE) {
+    SET_BIT(reg[2], MX25R6435F_CR2_LH_SWITCH);
+  } else {
+    CLEAR_BIT(reg[2], MX25R6435F_CR2_LH_SWITCH);
+  }
+
+  if (QSPI_Command(hxspi, QSPI_CMD_WRITE_STATUS_CFG_REG, 0, 3) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_XSPI_Transmit(hxspi, &(reg[0]), HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Wait that memory is ready */
+  if (QSPI_AutoPollingMemReady(hxspi, HAL_XSPI_TIMEOUT_DEFAULT_VALUE) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Check the configuration has been correctly done */
+  if (QSPI_ReadRegister(hxspi, QSPI_CMD_READ_CFG_REG, &(reg[0]), 2) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if ((((reg[1] & MX25R6435F_CR2_LH_SWITCH) == 0) && (Operation == QSPI_HIGH_PERF_ENABLE)) ||
+      (((reg[1] & MX25R6435F_CR2_LH_SWITCH) != 0) && (Operation == QSPI_HIGH_PERF_DISABLE))) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function configures the automatic polling of the SR in
+  *         interrupt mode: the status match callback is called when
+  *         (SR & Mask) == Match.
+  * @param  hxspi   : QSPI handle
+  * @param  pConfig : Automatic polling template
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_AutoPolling_IT(XSPI_HandleTypeDef *hxspi, const XSPI_AutoPollingTypeDef *pConfig)
+{
+  XSPI_AutoPollingTypeDef sConfig = *pConfig;
+
+#ifdef OCTOSPI
+  if (QSPI_Command(hxspi, QSPI_CMD_READ_STATUS_REG, 0, 0) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  if (HAL_OSPI_AutoPolling_IT(hxspi, &sConfig) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#else /* OCTOSPI */
+  QSPI_CommandTypeDef sCommand = qspi_cmd[QSPI_CMD_READ_STATUS_REG];
+
+  if (HAL_QSPI_AutoPolling_IT(hxspi, &sCommand, &sConfig) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#endif /* OCTOSPI */
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function starts the reception of the next chunk of an
+  *         asynchronous read.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_ReadChunk_Async(QSPI_t *obj)
+{
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+
+  obj->async_size = obj->async_end - obj->async_addr;
+  if (obj->async_size > QSPI_ASYNC_MAX_TRANSFER) {
+    obj->async_size = QSPI_ASYNC_MAX_TRANSFER;
+  }
+
+  /* Configure the command */
+  if (QSPI_ReadCommand(obj, obj->async_addr, obj->async_size) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Start the reception of the data */
+#if MX25R6435F_DMA
+  if (HAL_XSPI_Receive_DMA(handle, obj->async_data) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#else
+  if (HAL_XSPI_Receive_IT(handle, obj->async_data) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#endif /* MX25R6435F_DMA */
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function starts the data transfer of the current page of an
+  *         asynchronous write. The write enable latch must be set.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_WritePage_Async(QSPI_t *obj)
+{
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+
+  /* Calculation of the size between the write address and the end of the page */
+  obj->async_size = MX25R6435F_PAGE_SIZE - (obj->async_addr % MX25R6435F_PAGE_SIZE);
+  if (obj->async_size > (obj->async_end - obj->async_addr)) {
+    obj->async_size = obj->async_end - obj->async_addr;
+  }
+
+  /* Configure the command */
+  if (QSPI_Command(handle, obj->async_cmd, obj->async_addr, obj->async_size) != QSPI_OK) {
+    return QSPI_ERROR;
+  }
+
+  /* Start the transmission of the data */
+#if MX25R6435F_DMA
+  if (HAL_XSPI_Transmit_DMA(handle, obj->async_data) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#else
+  if (HAL_XSPI_Transmit_IT(handle, obj->async_data) != HAL_OK) {
+    return QSPI_ERROR;
+  }
+#endif /* MX25R6435F_DMA */
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function loads the next area of an asynchronous vectored
+  *         operation, skipping the empty ones.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval 1 if an area is loaded, 0 at the end of the vector
+  */
+static uint8_t QSPI_AsyncNextVec(QSPI_t *obj)
+{
+  while (obj->async_count > 0) {
+    obj->async_count--;
+    if (obj->async_vec->Size > 0) {
+      obj->async_data = obj->async_vec->pData;
+      obj->async_addr = obj->async_vec->Address;
+      obj->async_end  = obj->async_vec->Address + obj->async_vec->Size;
+      obj->async_vec++;
+      return 1;
+    }
+    obj->async_vec++;
+  }
+
+  return 0;
+}
+
+/**
+  * @brief  This function stops the asynchronous write or erase at its
+  *         current step. The polling of the end of a page program or erase is
+  *         aborted, the other steps are short and stop from interrupt.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  */
+static uint8_t QSPI_AsyncPause(QSPI_t *obj)
+{
+  uint32_t tickstart = HAL_GetTick();
+
+  if (obj->async_pause == QSPI_ASYNC_PAUSED) {
+    return QSPI_OK;
+  }
+
+  obj->async_pause = QSPI_ASYNC_PAUSING;
+
+  while (obj->async_pause != QSPI_ASYNC_PAUSED) {
+    /* The operation ended before the request was seen */
+    if (obj->async_op == QSPI_ASYNC_NONE) {
+      return QSPI_OK;
+    }
+
+    /* The program or erase is polled again by the resume. If the status match
+    interrupt comes first, the same step is stopped from interrupt. */
+    if (obj->async_step == QSPI_ASYNC_STEP_WIP) {
+      if (HAL_XSPI_Abort(&(obj->handle)) != HAL_OK) {
+        return QSPI_ERROR;
+      }
+      obj->async_step  = QSPI_ASYNC_STEP_PROGRAM;
+      obj->async_pause = QSPI_ASYNC_PAUSED;
+    }
+
+    if ((HAL_GetTick() - tickstart) > HAL_XSPI_TIMEOUT_DEFAULT_VALUE) {
+      return QSPI_ERROR;
+    }
+  }
+
+  return QSPI_OK;
+}
+
+/**
+  * @brief  This function checks whether an asynchronous write or erase is
+  *         running and not suspended.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval 1 if running, 0 otherwise
+  */
+static uint8_t QSPI_AsyncRunning(QSPI_t *obj)
+{
+  return (((obj->async_op == QSPI_ASYNC_WRITE) || (obj->async_op == QSPI_ASYNC_ERASE)) &&
+          (obj->async_pause == QSPI_ASYNC_RUNNING)) ? 1 : 0;
+}
+
+/**
+  * @brief  This function stops the asynchronous write or erase and suspends
+  *         it in the memory, after the minimum time given to the operation
+  *         since its last resume.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval QSPI memory status
+  * @note The driver is left in indirect mode.
+  */
+static uint8_t QSPI_AsyncSuspend(QSPI_t *obj)
+{
+  while (((HAL_GetTick() - obj->async_resume_tick) < MX25R6435F_SUSPEND_INTERVAL) &&
+         (obj->async_op != QSPI_ASYNC_NONE)) {
+  }
+
+  if ((QSPI_AsyncPause(obj) != QSPI_OK) || (QSPI_EnterIndirectMode(obj) != QSPI_OK)) {
+    return QSPI_ERROR;
+  }
+
+  return QSPI_SuspendMemory(&(obj->handle));
+}
+
+/**
+  * @brief  This function resumes in the memory the asynchronous write or
+  *         erase stopped by QSPI_AsyncSuspend() and chains its next steps.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  status : QSPI memory status of the operation done during the suspend
+  * @retval status, or QSPI_ERROR if the operation can't be resumed
+  */
+static uint8_t QSPI_AsyncResume(QSPI_t *obj, uint8_t status)
+{
+  /* The operation ended before being stopped */
+  if (obj->async_op == QSPI_ASYNC_NONE) {
+    return QSPI_RestoreMappedMode(obj, status);
+  }
+
+  /* The operation could not be stopped and is still chained from interrupt */
+  if (obj->async_pause != QSPI_ASYNC_PAUSED) {
+    obj->async_pause = QSPI_ASYNC_RUNNING;
+    return QSPI_ERROR;
+  }
+
+  if ((QSPI_EnterIndirectMode(obj) != QSPI_OK) || (QSPI_ResumeMemory(&(obj->handle)) != QSPI_OK)) {
+    QSPI_AsyncComplete(obj, QSPI_ERROR);
+    return QSPI_ERROR;
+  }
+
+  obj->async_resume_tick = HAL_GetTick();
+
+  /* Run again the step stopped by the suspend */
+  obj->async_pause = QSPI_ASYNC_RUNNING;
+  QSPI_AsyncNextStep(obj);
+
+  return status;
+}
+
+/**
+  * @brief  This function runs the next step of an asynchronous write or
+  *         erase. It is called from interrupt each time the previous step
+  *         is done.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval None
+  */
+static void QSPI_AsyncNextStep(QSPI_t *obj)
+{
+  XSPI_HandleTypeDef *handle = &(obj->handle);
+  uint8_t erase = (obj->async_op == QSPI_ASYNC_ERASE) ? 1 : 0;
+  uint8_t status;
+  uint8_t fail;
+
+  /* Stop here on suspend request, this step is run by the resume */
+  if (obj->async_pause != QSPI_ASYNC_RUNNING) {
+    obj->async_pause = QSPI_ASYNC_PAUSED;
+    return;
+  }
+
+  switch (obj->async_step) {
+    case QSPI_ASYNC_STEP_WREN:
+      /* Write enable sent: wait for the write enable latch */
+      obj->async_step = QSPI_ASYNC_STEP_WEL;
+      status = QSPI_AutoPolling_IT(handle, &qspi_polling_wel);
+      break;
+
+    case QSPI_ASYNC_STEP_WEL:
+      /* Write enabled: program the page or send the erase command */
+      obj->async_step = QSPI_ASYNC_STEP_PROGRAM;
+      if (obj->async_op == QSPI_ASYNC_ERASE) {
+        status = QSPI_Command_IT(handle, obj->async_cmd, obj->async_addr);
+      } else {
+        status = QSPI_WritePage_Async(obj);
+      }
+      break;
+
+    case QSPI_ASYNC_STEP_PROGRAM:
+      /* Data or command sent: wait for the end of program or erase */
+      obj->async_step = QSPI_ASYNC_STEP_WIP;
+      status = QSPI_AutoPolling_IT(handle, &qspi_polling_ready);
+      break;
+
+    case QSPI_ASYNC_STEP_WIP:
+      /* End of program or erase: read the security register to check its result */
+      obj->async_step = QSPI_ASYNC_STEP_CHECK;
+      status = QSPI_Command(handle, QSPI_CMD_READ_SEC_REG, 0, 1);
+      if ((status == QSPI_OK) && (HAL_XSPI_Receive_IT(handle, (uint8_t *)&(obj->async_secr)) != HAL_OK)) {
+        status = QSPI_ERROR;
+      }
+      break;
+
+    default:
+      /* Security register received: check the result of the program or erase */
+      fail = ((obj->async_secr & ((erase != 0) ? MX25R6435F_SECR_E_FAIL : MX25R6435F_SECR_P_FAIL)) != 0) ? 1 : 0;
+
+      /* Run the page program or erase again from the write enable. The
+         sector of a larger erase still failing is not known, it is not retired. */
+      if (fail != 0) {
+        if (obj->async_retry < ((erase != 0) ? MX25R6435F_ERASE_RETRIES : MX25R6435F_PROGRAM_RETRIES)) {
+          obj->async_retry++;
+          obj->async_step = QSPI_ASYNC_STEP_WREN;
+          status = QSPI_Command_IT(handle, QSPI_CMD_WRITE_ENABLE, 0);
+          break;
+        }
+        if ((erase == 0) || (obj->async_cmd == QSPI_CMD_SECTOR_ERASE)) {
+          QSPI_Retire(obj, obj->async_addr);
+        }
+        QSPI_AsyncComplete(obj, QSPI_ERROR);
+        return;
+      }
+      obj->async_retry = 0;
+
+      if (erase != 0) {
+        QSPI_AsyncComplete(obj, QSPI_OK);
+        return;
+      }
+
+      /* Page programmed: update the address and data pointer for next page */
+      obj->async_addr += obj->async_size;
+      obj->async_data += obj->async_size;
+
+      if ((obj->async_addr >= obj->async_end) && (QSPI_AsyncNextVec(obj) == 0)) {
+        QSPI_AsyncComplete(obj, QSPI_OK);
+        return;
+      }
+
+      obj->async_step = QSPI_ASYNC_STEP_WREN;
+      status = QSPI_Command_IT(handle, QSPI_CMD_WRITE_ENABLE, 0);
+      break;
+  }
+
+  if (status != QSPI_OK) {
+    QSPI_AsyncComplete(obj, QSPI_ERROR);
+  }
+}
+
+/**
+  * @brief  This function ends the asynchronous operation and notifies it.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  status : QSPI memory status of the operation
+  * @retval None
+  */
+static void QSPI_AsyncComplete(QSPI_t *obj, uint8_t status)
+{
+  QSPI_Callback callback = obj->async_cb;
+  uint32_t size;
+
+  if ((obj->async_op == QSPI_ASYNC_ERASE) && (status == QSPI_OK)) {
+    size = obj->info.EraseSize[obj->async_cmd - QSPI_CMD_SECTOR_ERASE];
+    QSPI_BlankMapUpdate(obj, obj->async_addr - (obj->async_addr % size), size, 1);
+  }
+
+  obj->async_op = QSPI_ASYNC_NONE;
+  obj->async_pause = QSPI_ASYNC_RUNNING;
+
+  /* Go back to the memory-mapped mode left by a write or an erase */
+  status = QSPI_RestoreMappedMode(obj, status);
+
+#if MX25R6435F_STATS
+  QSPI_StatsAsyncEnd(obj);
+#endif
+
+  if (callback != NULL) {
+    callback(status, obj->async_context);
+  }
+}
+
+#if MX25R6435F_STATS
+/**
+  * @brief  Start the measure of an operation. Only the outer BSP function
+  *         called by the thread mode is recorded, the nested calls are part
+  *         of it. The internal steps are recorded at any level.
+  * @param  obj  : pointer to QSPI_t structure, NULL to record nothing
+  * @param  Op   : QSPI_STATS_xxx operation
+  * @param  Size : Bytes read or written
+  * @retval Measure, recorded by QSPI_StatsEnd()
+  */
+static QSPI_StatsScope QSPI_StatsBegin(QSPI_t *obj, uint8_t Op, uint32_t Size)
+{
+  QSPI_StatsScope scope = {obj, Op, 0, Size, DWT->CYCCNT};
+
+  if (obj == NULL) {
+    scope.op = QSPI_STATS_NONE;
+  } else if ((Op < QSPI_STATS_PAGE_PROGRAM) && (__get_IPSR() == 0)) {
+    scope.depth = 1;
+    if (obj->stats_depth++ != 0) {
+      scope.op = QSPI_STATS_NONE;
+    }
+  }
+
+  return scope;
+}
+
+/**
+  * @brief  Record an operation at the end of the scope of its measure.
+  * @param  pScope : Measure started by QSPI_StatsBegin()
+  * @retval None
+  */
+static void QSPI_StatsEnd(QSPI_StatsScope *pScope)
+{
+  uint32_t cycles = DWT->CYCCNT - pScope->start;
+
+  if (pScope->depth != 0) {
+    pScope->obj->stats_depth--;
+  }
+
+  if (pScope->op != QSPI_STATS_NONE) {
+    QSPI_StatsRecord(pScope->obj, pScope->op, pScope->size, cycles);
+  }
+}
+
+/**
+  * @brief  Extend the measure of an asynchronous operation to its completion.
+  *         Called before starting the operation, whose completion may come
+  *         before the function returns.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  pScope : Measure started by QSPI_StatsBegin()
+  * @retval None
+  */
+static void QSPI_StatsAsync(QSPI_t *obj, QSPI_StatsScope *pScope)
+{
+  obj->stats_async_op = pScope->op;
+  obj->stats_async_size = pScope->size;
+  obj->stats_async_start = pScope->start;
+  pScope->op = QSPI_STATS_NONE;
+}
+
+/**
+  * @brief  Record a completed asynchronous operation.
+  * @param  obj : pointer to QSPI_t structure
+  * @retval None
+  */
+static void QSPI_StatsAsyncEnd(QSPI_t *obj)
+{
+  if (obj->stats_async_op != QSPI_STATS_NONE) {
+    QSPI_StatsRecord(obj, obj->stats_async_op, obj->stats_async_size, DWT->CYCCNT - obj->stats_async_start);
+    obj->stats_async_op = QSPI_STATS_NONE;
+  }
+}
+
+/**
+  * @brief  Add an operation to the statistics, with the interrupts disabled
+  *         as the asynchronous completions are recorded from interrupt.
+  * @param  obj    : pointer to QSPI_t structure
+  * @param  Op     : QSPI_STATS_xxx operation
+  * @param  Size   : Bytes read or written
+  * @param  Cycles : Duration of the operation
+  * @retval None
+  */
+static void QSPI_StatsRecord(QSPI_t *obj, uint8_t Op, uint32_t Size, uint32_t Cycles)
+{
+  QSPI_StatsOp *pOp = &(obj->stats.Op[Op]);
+  uint32_t primask = __get_PRIMASK();
+  uint32_t bucket = (Cycles != 0) ? (31U - __CLZ(Cycles)) : 0;
+
+  /* Bucket of the power of 2 of the duration, the last one is 2^31 */
+  bucket = (bucket > QSPI_STATS_MIN_LOG2) ? (bucket - QSPI_STATS_MIN_LOG2) : 0;
+  if (bucket >= MX25R6435F_STATS_BUCKETS) {
+    bucket = MX25R6435F_STATS_BUCKETS - 1;
+  }
+
+  __disable_irq();
+  pOp->Count++;
+  pOp->Bytes += Size;
+  pOp->Cycles += Cycles;
+  if (Cycles > pOp->MaxCycles) {
+    pOp->MaxCycles = Cycles;
+  }
+  pOp->Histogram[bucket]++;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Return the total size of the elements of a vectored operation.
+  * @param  pVec  : Array of the elements
+  * @param  Count : Number of elements
+  * @retval Total size
+  */
+static uint32_t QSPI_StatsVecSize(const QSPI_IoVec *pVec, uint32_t Count)
+{
+  uint32_t size = 0;
+
+  for (uint32_t i = 0; (pVec != NULL) && (i < Count); i++) {
+    size += pVec[i].Size;
+  }
+
+  return size;
+}
+#endif /* MX25R6435F_STATS */
+
+/**
+  * @brief  Command completed callback.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+void HAL_XSPI_CmdCpltCallback(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_t *obj = qspi_getObj(hxspi);
+
+  if (obj == NULL) {
+    return;
+  }
+
+  if ((obj->async_op == QSPI_ASYNC_WRITE) || (obj->async_op == QSPI_ASYNC_ERASE)) {
+    QSPI_AsyncNextStep(obj);
+  } else if (obj->async_op == QSPI_ASYNC_READ) {
+    /* Erase resumed at the end of the read */
+    obj->async_resume_tick = HAL_GetTick();
+    QSPI_AsyncComplete(obj, QSPI_OK);
+  }
+}
+
+/**
+  * @brief  Rx transfer completed callback.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+void HAL_XSPI_RxCpltCallback(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_t *obj = qspi_getObj(hxspi);
+
+  if (obj == NULL) {
+    return;
+  }
+
+  /* Security register read at the end of a page program or an erase */
+  if ((obj->async_op == QSPI_ASYNC_WRITE) || (obj->async_op == QSPI_ASYNC_ERASE)) {
+    QSPI_AsyncNextStep(obj);
+    return;
+  }
+
+  if (obj->async_op != QSPI_ASYNC_READ) {
+    return;
+  }
+
+  obj->async_addr += obj->async_size;
+  obj->async_data += obj->async_size;
+
+  if ((obj->async_addr < obj->async_end) || (QSPI_AsyncNextVec(obj) != 0)) {
+    if (QSPI_ReadChunk_Async(obj) != QSPI_OK) {
+      QSPI_AsyncComplete(obj, QSPI_ERROR);
+    }
+  } else if (obj->erase_suspended != 0) {
+    /* Resume the erase suspended for the read, the read completes with the command */
+    obj->erase_suspended = 0;
+    if (QSPI_Command_IT(&(obj->handle), QSPI_CMD_RESUME, 0) != QSPI_OK) {
+      QSPI_AsyncComplete(obj, QSPI_ERROR);
+    }
+  } else {
+    QSPI_AsyncComplete(obj, QSPI_OK);
+  }
+}
+
+/**
+  * @brief  Tx transfer completed callback.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+void HAL_XSPI_TxCpltCallback(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_t *obj = qspi_getObj(hxspi);
+
+  if ((obj != NULL) && ((obj->async_op == QSPI_ASYNC_WRITE) || (obj->async_op == QSPI_ASYNC_ERASE))) {
+    QSPI_AsyncNextStep(obj);
+  }
+}
+
+/**
+  * @brief  Status match callback.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+void HAL_XSPI_StatusMatchCallback(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_t *obj = qspi_getObj(hxspi);
+
+  if ((obj != NULL) && ((obj->async_op == QSPI_ASYNC_WRITE) || (obj->async_op == QSPI_ASYNC_ERASE))) {
+    QSPI_AsyncNextStep(obj);
+  }
+}
+
+/**
+  * @brief  Transfer error callback.
+  * @param  hxspi : QSPI handle
+  * @retval None
+  */
+void HAL_XSPI_ErrorCallback(XSPI_HandleTypeDef *hxspi)
+{
+  QSPI_t *obj = qspi_getObj(hxspi);
+
+  if ((obj != NULL) && (obj->async_op != QSPI_ASYNC_NONE)) {
+    QSPI_AsyncComplete(obj, QSPI_ERROR);
+  }
+}
+
+#if MX25R6435F_DMA
+/**
+  * @brief  This function handles the DMA interrupt request.
+  * @retval None
+  */
+void MX25R6435F_DMA_IRQHandler(void)
+{
+  if (qspi_hdma != NULL) {
+    HAL_DMA_IRQHandler(qspi_hdma);
+  }
+}
+#endif /* MX25R6435F_DMA */
+
+/**
+  * @brief  This function handles the xSPI interrupt request.
+  * @retval None
+  */
+#if defined(OCTOSPI)
+#if defined(OCTOSPI1)
+void OCTOSPI1_IRQHandler(void)
+{
+  if (qspi_obj[0] != NULL) {
+    HAL_XSPI_IRQHandler(&(qspi_obj[0]->handle));
+  }
+}
+#endif
+#if defined(OCTOSPI2)
+void OCTOSPI2_IRQHandler(void)
+{
+  if (qspi_obj[1] != NULL) {
+    HAL_XSPI_IRQHandler(&(qspi_obj[1]->handle));
+  }
+}
+#endif
+#else /* OCTOSPI */
+void QUADSPI_IRQHandler(void)
+{
+  if (qspi_obj[0] != NULL) {
+    HAL_XSPI_IRQHandler(&(qspi_obj[0]->handle));
+  }
+}
+#endif /* OCTOSPI */
+
 #ifdef __cplusplus
 }
 #endif
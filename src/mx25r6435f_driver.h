@@ -35,6 +35,9 @@ extern "C" {
 #define OCTOSPI
 #define XSPI_HandleTypeDef  OSPI_HandleTypeDef
 #define XSPI_TypeDef        OCTOSPI_TypeDef
+#define XSPI_CommandTypeDef      OSPI_RegularCmdTypeDef
+#define XSPI_AutoPollingTypeDef  OSPI_AutoPollingTypeDef
+#define XSPI_MemoryMappedTypeDef OSPI_MemoryMappedTypeDef
 #define PinMap_XSPI_DATA0   PinMap_OCTOSPI_DATA0
 #define PinMap_XSPI_DATA1   PinMap_OCTOSPI_DATA1
 #define PinMap_XSPI_DATA2   PinMap_OCTOSPI_DATA2
@@ -47,9 +50,26 @@ extern "C" {
 #define HAL_XSPI_Command    HAL_OSPI_Command
 #define HAL_XSPI_Transmit   HAL_OSPI_Transmit
 #define HAL_XSPI_Receive    HAL_OSPI_Receive
+#define HAL_XSPI_Transmit_DMA HAL_OSPI_Transmit_DMA
+#define HAL_XSPI_Receive_DMA  HAL_OSPI_Receive_DMA
+#define HAL_XSPI_Transmit_IT  HAL_OSPI_Transmit_IT
+#define HAL_XSPI_Receive_IT   HAL_OSPI_Receive_IT
+#define HAL_XSPI_Command_IT   HAL_OSPI_Command_IT
+#define HAL_XSPI_Abort        HAL_OSPI_Abort
+#define HAL_XSPI_GetState     HAL_OSPI_GetState
+#define HAL_XSPI_STATE_BUSY_MEM_MAPPED HAL_OSPI_STATE_BUSY_MEM_MAPPED
+#define HAL_XSPI_IRQHandler HAL_OSPI_IRQHandler
+#define HAL_XSPI_CmdCpltCallback      HAL_OSPI_CmdCpltCallback
+#define HAL_XSPI_RxCpltCallback       HAL_OSPI_RxCpltCallback
+#define HAL_XSPI_TxCpltCallback       HAL_OSPI_TxCpltCallback
+#define HAL_XSPI_StatusMatchCallback  HAL_OSPI_StatusMatchCallback
+#define HAL_XSPI_ErrorCallback        HAL_OSPI_ErrorCallback
 #elif defined(QUADSPI)
 #define XSPI_HandleTypeDef  QSPI_HandleTypeDef
 #define XSPI_TypeDef        QUADSPI_TypeDef
+#define XSPI_CommandTypeDef      QSPI_CommandTypeDef
+#define XSPI_AutoPollingTypeDef  QSPI_AutoPollingTypeDef
+#define XSPI_MemoryMappedTypeDef QSPI_MemoryMappedTypeDef
 
 #if defined(STM32_CORE_VERSION) && (STM32_CORE_VERSION  > 0x01090000)
 #define PinMap_XSPI_DATA0   PinMap_QUADSPI_DATA0
@@ -72,10 +92,160 @@ extern "C" {
 #define HAL_XSPI_Command    HAL_QSPI_Command
 #define HAL_XSPI_Transmit   HAL_QSPI_Transmit
 #define HAL_XSPI_Receive    HAL_QSPI_Receive
+#define HAL_XSPI_Transmit_DMA HAL_QSPI_Transmit_DMA
+#define HAL_XSPI_Receive_DMA  HAL_QSPI_Receive_DMA
+#define HAL_XSPI_Transmit_IT  HAL_QSPI_Transmit_IT
+#define HAL_XSPI_Receive_IT   HAL_QSPI_Receive_IT
+#define HAL_XSPI_Command_IT   HAL_QSPI_Command_IT
+#define HAL_XSPI_Abort        HAL_QSPI_Abort
+#define HAL_XSPI_GetState     HAL_QSPI_GetState
+#define HAL_XSPI_STATE_BUSY_MEM_MAPPED HAL_QSPI_STATE_BUSY_MEM_MAPPED
+#define HAL_XSPI_IRQHandler HAL_QSPI_IRQHandler
+#define HAL_XSPI_CmdCpltCallback      HAL_QSPI_CmdCpltCallback
+#define HAL_XSPI_RxCpltCallback       HAL_QSPI_RxCpltCallback
+#define HAL_XSPI_TxCpltCallback       HAL_QSPI_TxCpltCallback
+#define HAL_XSPI_StatusMatchCallback  HAL_QSPI_StatusMatchCallback
+#define HAL_XSPI_ErrorCallback        HAL_QSPI_ErrorCallback
 #else
 #error "QSPI feature not available. MX25R6435F library compilation failed."
 #endif /* OCTOSPIx */
 
+/*
+ * Optional DMA used by the asynchronous transfers, else they are done by
+ * interrupt. Enable it with MX25R6435F_DMA=1 (using build_opt.h or
+ * hal_conf_extra.h). A default channel is provided for the STM32L4/L4+
+ * series; other series also have to define the MX25R6435F_DMA_xxx
+ * definitions below. The library then defines MX25R6435F_DMA_IRQHandler,
+ * which the application must not define.
+ */
+#ifndef MX25R6435F_DMA
+#define MX25R6435F_DMA                0
+#endif
+
+#if MX25R6435F_DMA
+#ifndef MX25R6435F_DMA_CHANNEL
+#define MX25R6435F_DMA_CHANNEL        DMA2_Channel7
+#define MX25R6435F_DMA_IRQn           DMA2_Channel7_IRQn
+#define MX25R6435F_DMA_IRQHandler     DMA2_Channel7_IRQHandler
+#define MX25R6435F_DMA_CLK_ENABLE()   __HAL_RCC_DMA2_CLK_ENABLE()
+#endif
+#ifndef MX25R6435F_DMA_REQUEST
+#ifdef OCTOSPI
+#define MX25R6435F_DMA_REQUEST        DMA_REQUEST_OCTOSPI1
+#else
+#define MX25R6435F_DMA_REQUEST        DMA_REQUEST_3
+#endif
+#endif
+#endif /* MX25R6435F_DMA */
+
+/*
+ * Optional RAM map of the sectors known to be erased (1 bit per sector),
+ * updated by the erases, writes and blank checks of the driver. Memory-mapped
+ * writes are not tracked. Enable it with MX25R6435F_BLANK_MAP=1 (using
+ * build_opt.h or hal_conf_extra.h).
+ */
+#ifndef MX25R6435F_BLANK_MAP
+#define MX25R6435F_BLANK_MAP          0
+#endif
+#define MX25R6435F_BLANK_MAP_SECTORS  (MX25R6435F_FLASH_SIZE / MX25R6435F_SECTOR_SIZE)
+
+/*
+ * The result of each page program and erase is checked in the security
+ * register (P_FAIL/E_FAIL). A failed operation is run again up to
+ * MX25R6435F_PROGRAM_RETRIES or MX25R6435F_ERASE_RETRIES times before the
+ * error is returned and the sector is retired.
+ */
+#ifndef MX25R6435F_PROGRAM_RETRIES
+#define MX25R6435F_PROGRAM_RETRIES    2
+#endif
+#ifndef MX25R6435F_ERASE_RETRIES
+#define MX25R6435F_ERASE_RETRIES      2
+#endif
+
+/*
+ * Optional table of the retired sectors (1 bit per sector), where a program or
+ * an erase still failed after the retries. It is kept in RAM and saved in the
+ * sector MX25R6435F_RETIRED_TABLE_SECTOR (by default the last sector of the
+ * memory found at initialization), reserved to it and reported as retired.
+ * The table is only created in an erased sector: initialization fails if the
+ * sector holds other data, which is never erased. Enable it with
+ * MX25R6435F_RETIRED_TABLE=1 (using build_opt.h or hal_conf_extra.h).
+ */
+#ifndef MX25R6435F_RETIRED_TABLE
+#define MX25R6435F_RETIRED_TABLE      0
+#endif
+#define MX25R6435F_RETIRED_TABLE_LAST 0xFFFFFFFF
+#ifndef MX25R6435F_RETIRED_TABLE_SECTOR
+#define MX25R6435F_RETIRED_TABLE_SECTOR MX25R6435F_RETIRED_TABLE_LAST
+#endif
+#define MX25R6435F_RETIRED_SECTORS    (MX25R6435F_FLASH_SIZE / MX25R6435F_SECTOR_SIZE)
+
+/*
+ * Optional RAM write-back cache: MX25R6435F_WRITE_CACHE slots of
+ * MX25R6435F_WRITE_CACHE_SLOT_SIZE bytes (page or sector size) gather the
+ * small writes, programmed when a slot is evicted (least recently used) or
+ * by BSP_QSPI_Flush(). Not used in memory-mapped mode.
+ */
+#ifndef MX25R6435F_WRITE_CACHE
+#define MX25R6435F_WRITE_CACHE        0
+#endif
+#ifndef MX25R6435F_WRITE_CACHE_SLOT_SIZE
+#define MX25R6435F_WRITE_CACHE_SLOT_SIZE MX25R6435F_PAGE_SIZE
+#endif
+#if (MX25R6435F_WRITE_CACHE_SLOT_SIZE != MX25R6435F_PAGE_SIZE) && \
+    (MX25R6435F_WRITE_CACHE_SLOT_SIZE != MX25R6435F_SECTOR_SIZE)
+#error "MX25R6435F_WRITE_CACHE_SLOT_SIZE must be the page or the sector size"
+#endif
+
+/*
+ * Optional RAM read cache: MX25R6435F_READ_CACHE lines of
+ * MX25R6435F_READ_CACHE_LINE_SIZE bytes (32 to 256) serve the reads smaller
+ * than a line. A miss on the line following the last filled one is seen as a
+ * sequential scan and reads ahead all the lines at once.
+ */
+#ifndef MX25R6435F_READ_CACHE
+#define MX25R6435F_READ_CACHE         0
+#endif
+#ifndef MX25R6435F_READ_CACHE_LINE_SIZE
+#define MX25R6435F_READ_CACHE_LINE_SIZE 64
+#endif
+#if (MX25R6435F_READ_CACHE_LINE_SIZE < 32) || (MX25R6435F_READ_CACHE_LINE_SIZE > 256) || \
+    ((MX25R6435F_READ_CACHE_LINE_SIZE & (MX25R6435F_READ_CACHE_LINE_SIZE - 1)) != 0)
+#error "MX25R6435F_READ_CACHE_LINE_SIZE must be a power of 2 from 32 to 256"
+#endif
+
+/*
+ * Minimum time in ms left to an asynchronous erase or write between a resume
+ * and the next suspend, so that frequent reads can't starve it.
+ */
+#ifndef MX25R6435F_SUSPEND_INTERVAL
+#define MX25R6435F_SUSPEND_INTERVAL   1
+#endif
+
+/* xSPI and DMA interrupts priority */
+#ifndef MX25R6435F_IRQ_PRIO
+#define MX25R6435F_IRQ_PRIO           2
+#endif
+#ifndef MX25R6435F_IRQ_SUBPRIO
+#define MX25R6435F_IRQ_SUBPRIO        0
+#endif
+
+/*
+ * Optional statistics of each operation: number of calls, bytes transferred
+ * and duration measured with the DWT cycle counter, as a total, a maximum and
+ * a histogram of MX25R6435F_STATS_BUCKETS power of 2 buckets. Bucket i holds
+ * the durations from 2^(i+8) to 2^(i+9)-1 cycles, the first one also the
+ * shorter ones. Enable it with MX25R6435F_STATS=1 (using build_opt.h or
+ * hal_conf_extra.h).
+ */
+#ifndef MX25R6435F_STATS
+#define MX25R6435F_STATS              0
+#endif
+#define MX25R6435F_STATS_BUCKETS      24
+#if MX25R6435F_STATS && !defined(DWT_CTRL_CYCCNTENA_Msk)
+#error "MX25R6435F_STATS requires the DWT cycle counter (Cortex-M3 and above)"
+#endif
+
 /* QSPI Error codes */
 #define QSPI_OK            ((uint8_t)0x00)
 #define QSPI_ERROR         ((uint8_t)0x01)
@@ -83,16 +253,107 @@ extern "C" {
 #define QSPI_NOT_SUPPORTED ((uint8_t)0x04)
 #define QSPI_SUSPENDED     ((uint8_t)0x08)
 
+/* Erase granularity */
+#define QSPI_ERASE_SECTOR   ((uint8_t)0x00)
+#define QSPI_ERASE_SUBBLOCK ((uint8_t)0x01)
+#define QSPI_ERASE_BLOCK    ((uint8_t)0x02)
+#define QSPI_ERASE_CHIP     ((uint8_t)0x03)
+#define QSPI_ERASE_NUMBER   ((uint8_t)0x04)
+
 /* Exported types ------------------------------------------------------------*/
-/* QSPI Info */
+/* QSPI Info, read from the memory at initialization (JEDEC ID and SFDP) */
 typedef struct {
   uint32_t FlashSize;          /*!< Size of the flash */
   uint32_t EraseSectorSize;    /*!< Size of sectors for the erase operation */
   uint32_t EraseSectorsNumber; /*!< Number of sectors for the erase operation */
   uint32_t ProgPageSize;       /*!< Size of pages for the program operation */
   uint32_t ProgPagesNumber;    /*!< Number of pages for the program operation */
+  uint32_t JedecId;            /*!< Manufacturer ID, memory type and density */
+  uint32_t EraseSize[QSPI_ERASE_NUMBER];    /*!< Size of each erase granularity, 0 if not supported */
+  uint32_t EraseTypTime[QSPI_ERASE_NUMBER]; /*!< Typical duration in ms of each erase granularity */
+  uint32_t EraseMaxTime[QSPI_ERASE_NUMBER]; /*!< Maximum duration in ms of each erase granularity */
+  uint8_t  ReadInstruction;    /*!< Quad I/O fast read instruction */
+  uint8_t  ReadDummyCycles;    /*!< Dummy cycles of the read, after the mode byte */
 } QSPI_Info;
 
+/* Clock and sampling configuration of the xSPI interface */
+typedef struct {
+  uint32_t KernelClock;           /*!< Kernel clock frequency the configuration was found for */
+  uint32_t ClockPrescaler;        /*!< Division factor of the kernel clock */
+  uint32_t SampleShifting;        /*!< Sample shifting setting */
+  uint32_t DelayHoldQuarterCycle; /*!< Delay hold quarter cycle setting */
+} QSPI_Calibration;
+
+/* Asynchronous operation in progress */
+#define QSPI_ASYNC_NONE    ((uint8_t)0x00)
+#define QSPI_ASYNC_READ    ((uint8_t)0x01)
+#define QSPI_ASYNC_WRITE   ((uint8_t)0x02)
+#define QSPI_ASYNC_ERASE   ((uint8_t)0x03)
+
+#if MX25R6435F_STATS
+/* Operations measured by the statistics */
+#define QSPI_STATS_READ            ((uint8_t)0x00)
+#define QSPI_STATS_WRITE           ((uint8_t)0x01)
+#define QSPI_STATS_FLUSH           ((uint8_t)0x02)
+#define QSPI_STATS_PROGRAM         ((uint8_t)0x03)
+#define QSPI_STATS_READ_ASYNC      ((uint8_t)0x04)
+#define QSPI_STATS_WRITE_ASYNC     ((uint8_t)0x05)
+#define QSPI_STATS_READV           ((uint8_t)0x06)
+#define QSPI_STATS_WRITEV          ((uint8_t)0x07)
+#define QSPI_STATS_READV_ASYNC     ((uint8_t)0x08)
+#define QSPI_STATS_WRITEV_ASYNC    ((uint8_t)0x09)
+#define QSPI_STATS_ERASE_ASYNC     ((uint8_t)0x0A)
+#define QSPI_STATS_ERASE_BLOCK     ((uint8_t)0x0B)
+#define QSPI_STATS_ERASE_SECTOR    ((uint8_t)0x0C)
+#define QSPI_STATS_ERASE_CHIP      ((uint8_t)0x0D)
+#define QSPI_STATS_ERASE_RANGE     ((uint8_t)0x0E)
+#define QSPI_STATS_IS_BLANK        ((uint8_t)0x0F)
+#define QSPI_STATS_GET_STATUS      ((uint8_t)0x10)
+#define QSPI_STATS_MAPPED          ((uint8_t)0x11) /* Enable and disable of the memory-mapped mode */
+#define QSPI_STATS_SUSPEND         ((uint8_t)0x12) /* Erase and program suspend */
+#define QSPI_STATS_RESUME          ((uint8_t)0x13) /* Erase and program resume */
+#define QSPI_STATS_POWER_DOWN      ((uint8_t)0x14) /* Enter and leave deep power-down */
+#define QSPI_STATS_CONTINUOUS_READ ((uint8_t)0x15)
+#define QSPI_STATS_CALIBRATE       ((uint8_t)0x16) /* Calibration search and setting */
+#define QSPI_STATS_PAGE_PROGRAM    ((uint8_t)0x17) /* Each page programmed by a synchronous write */
+#define QSPI_STATS_WRITE_ENABLE    ((uint8_t)0x18)
+#define QSPI_STATS_BUSY_POLL       ((uint8_t)0x19) /* Wait for the end of a program or an erase */
+#define QSPI_STATS_NUMBER          ((uint8_t)0x1A)
+
+/* Statistics of an operation */
+typedef struct {
+  uint32_t Count;     /*!< Number of calls */
+  uint32_t MaxCycles; /*!< Longest duration */
+  uint64_t Bytes;     /*!< Bytes read or written */
+  uint64_t Cycles;    /*!< Total duration */
+  uint32_t Histogram[MX25R6435F_STATS_BUCKETS]; /*!< Number of calls per duration bucket */
+} QSPI_StatsOp;
+
+/* Statistics of the operations, durations in CPU cycles */
+typedef struct {
+  uint32_t Frequency;                /*!< CPU clock frequency in Hz, to convert the cycles */
+  QSPI_StatsOp Op[QSPI_STATS_NUMBER]; /*!< Statistics of each QSPI_STATS_xxx operation */
+} QSPI_Stats;
+#endif
+
+#if MX25R6435F_WRITE_CACHE
+/* Write cache slot, holding the AND of the data written to it */
+typedef struct {
+  uint32_t addr; /* Address of the slot, QSPI_CACHE_FREE if not used */
+  uint32_t used; /* Last write stamp, for the LRU eviction */
+  uint8_t data[MX25R6435F_WRITE_CACHE_SLOT_SIZE];
+} QSPI_CacheSlot;
+#endif
+
+/* Element of a vectored read or write */
+typedef struct {
+  uint32_t Address; /*!< Address in the memory */
+  uint8_t *pData;   /*!< Data to write or buffer of the data read */
+  uint32_t Size;    /*!< Size of the data */
+} QSPI_IoVec;
+
+/* Completion callback of an asynchronous operation, called from interrupt */
+typedef void (*QSPI_Callback)(uint8_t status, void *context);
 
 typedef struct {
   XSPI_HandleTypeDef handle;
@@ -103,6 +364,60 @@ typedef struct {
   PinName pin_d3;
   PinName pin_sclk;
   PinName pin_ssel;
+#if MX25R6435F_DMA
+  DMA_HandleTypeDef hdma;
+#endif
+  /* Asynchronous operation context */
+  __IO uint8_t async_op;
+  __IO uint8_t async_step;
+  __IO uint8_t async_pause; /* Suspend request of an asynchronous write or erase */
+  uint32_t async_resume_tick;
+  uint8_t async_cmd;
+  uint8_t *async_data;
+  uint32_t async_addr;
+  uint32_t async_end;
+  uint32_t async_size;
+  QSPI_Callback async_cb;
+  void *async_context;
+  QSPI_IoVec *async_vec; /* Next elements of a vectored operation */
+  uint32_t async_count;
+  uint8_t async_retry;   /* Retries of the current page program or erase */
+  __IO uint8_t async_secr; /* Security register read at the end of a page program or erase */
+  /* Sector erase started without waiting, checked by the next operation */
+  uint8_t erase_pending;
+  uint32_t erase_addr;
+  uint8_t erase_suspended; /* Suspended until the end of an asynchronous read */
+  /* Continuous read mode */
+  uint8_t continuous_read;
+  uint8_t enhanced; /* Memory in performance enhance mode */
+  uint8_t mapped;   /* Memory-mapped mode enabled, left during indirect operations */
+  /* Memory parameters */
+  QSPI_Info info;
+#if MX25R6435F_BLANK_MAP
+  uint32_t blank_map[MX25R6435F_BLANK_MAP_SECTORS / 32]; /* Sectors known to be erased */
+#endif
+#if MX25R6435F_RETIRED_TABLE
+  uint8_t retired_map[MX25R6435F_RETIRED_SECTORS / 8]; /* Image of the table, bit cleared for a retired sector */
+  uint8_t retired_dirty;                               /* Table to save */
+  uint32_t retired_table;                              /* Address of the sector of the table */
+#endif
+#if MX25R6435F_WRITE_CACHE
+  QSPI_CacheSlot wcache[MX25R6435F_WRITE_CACHE];
+  uint32_t wcache_stamp;
+#endif
+#if MX25R6435F_READ_CACHE
+  uint8_t rcache[MX25R6435F_READ_CACHE][MX25R6435F_READ_CACHE_LINE_SIZE];
+  uint32_t rcache_addr[MX25R6435F_READ_CACHE]; /* Address of each line, QSPI_CACHE_FREE if not used */
+  uint32_t rcache_next;                        /* Address following the last filled line */
+  uint8_t rcache_slot;                         /* Next line to replace */
+#endif
+#if MX25R6435F_STATS
+  QSPI_Stats stats;
+  uint8_t stats_depth;        /* Nesting level of the BSP calls in thread mode */
+  uint8_t stats_async_op;     /* Asynchronous operation measured until its completion */
+  uint32_t stats_async_size;
+  uint32_t stats_async_start;
+#endif
 } QSPI_t;
 
 /* Exported functions --------------------------------------------------------*/
@@ -110,16 +425,41 @@ uint8_t BSP_QSPI_Init(QSPI_t *obj);
 uint8_t BSP_QSPI_DeInit(QSPI_t *obj);
 uint8_t BSP_QSPI_Read(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size);
 uint8_t BSP_QSPI_Write(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size);
+uint8_t BSP_QSPI_Flush(QSPI_t *obj);
+uint8_t BSP_QSPI_Program(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, uint8_t *pSector);
+uint8_t BSP_QSPI_Read_Async(QSPI_t *obj, uint8_t *pData, uint32_t ReadAddr, uint32_t Size, QSPI_Callback Callback, void *Context);
+uint8_t BSP_QSPI_Write_Async(QSPI_t *obj, uint8_t *pData, uint32_t WriteAddr, uint32_t Size, QSPI_Callback Callback, void *Context);
+uint8_t BSP_QSPI_ReadV(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count);
+uint8_t BSP_QSPI_WriteV(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count);
+uint8_t BSP_QSPI_ReadV_Async(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count, QSPI_Callback Callback, void *Context);
+uint8_t BSP_QSPI_WriteV_Async(QSPI_t *obj, QSPI_IoVec *pVec, uint32_t Count, QSPI_Callback Callback, void *Context);
+uint8_t BSP_QSPI_Erase_Async(QSPI_t *obj, uint8_t EraseType, uint32_t Address, QSPI_Callback Callback, void *Context);
 uint8_t BSP_QSPI_Erase_Block(QSPI_t *obj, uint32_t BlockAddress);
 uint8_t BSP_QSPI_Erase_Sector(QSPI_t *obj, uint32_t Sector);
 uint8_t BSP_QSPI_Erase_Chip(QSPI_t *obj);
+uint8_t BSP_QSPI_Erase_Plan(QSPI_t *obj, uint32_t Address, uint32_t Size, uint32_t *pCount);
+uint8_t BSP_QSPI_Erase_Range(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t SkipBlank);
+uint8_t BSP_QSPI_IsBlank(QSPI_t *obj, uint32_t Address, uint32_t Size, uint8_t *pBlank);
+uint8_t BSP_QSPI_IsRetired(QSPI_t *obj, uint32_t Address, uint8_t *pRetired);
+uint8_t BSP_QSPI_GetRetiredCount(QSPI_t *obj, uint32_t *pCount);
 uint8_t BSP_QSPI_GetStatus(QSPI_t *obj);
-uint8_t BSP_QSPI_GetInfo(QSPI_Info *pInfo);
+uint8_t BSP_QSPI_GetInfo(QSPI_t *obj, QSPI_Info *pInfo);
+uint8_t *BSP_QSPI_GetMappedAddress(QSPI_t *obj);
 uint8_t BSP_QSPI_EnableMemoryMappedMode(QSPI_t *obj);
+uint8_t BSP_QSPI_DisableMemoryMappedMode(QSPI_t *obj);
 uint8_t BSP_QSPI_SuspendErase(QSPI_t *obj);
 uint8_t BSP_QSPI_ResumeErase(QSPI_t *obj);
+uint8_t BSP_QSPI_SuspendProgram(QSPI_t *obj);
+uint8_t BSP_QSPI_ResumeProgram(QSPI_t *obj);
 uint8_t BSP_QSPI_EnterDeepPowerDown(QSPI_t *obj);
 uint8_t BSP_QSPI_LeaveDeepPowerDown(QSPI_t *obj);
+uint8_t BSP_QSPI_SetContinuousRead(QSPI_t *obj, uint8_t Enable);
+uint8_t BSP_QSPI_Calibrate(QSPI_t *obj, QSPI_Calibration *pCalib);
+uint8_t BSP_QSPI_SetCalibration(QSPI_t *obj, const QSPI_Calibration *pCalib);
+#if MX25R6435F_STATS
+uint8_t BSP_QSPI_GetStats(QSPI_t *obj, QSPI_Stats *pStats);
+uint8_t BSP_QSPI_ResetStats(QSPI_t *obj);
+#endif
 
 void BSP_QSPI_MspInit(QSPI_t *obj);
 void BSP_QSPI_MspDeInit(QSPI_t *obj);
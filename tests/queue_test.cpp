@@ -0,0 +1,269 @@
+/**
+  ******************************************************************************
+  * @file    queue_test.cpp
+  * @brief   Host test of MX25R6435FQueue against MX25R6435FSimDevice
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2020 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under BSD 3-Clause license,
+  * the "License"; You may not use this file except in compliance with the
+  * License. You may obtain a copy of the License at:
+  *                        opensource.org/licenses/BSD-3-Clause
+  *
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include "MX25R6435FQueue.h"
+
+#define MEM_SIZE  (16 * MX25R6435F_SECTOR_SIZE)
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+static int failures = 0;
+static uint8_t mem[MEM_SIZE];
+
+/* Order of the completions, given by the argument of the callbacks */
+static int order[MX25R6435F_QUEUE_DEPTH];
+static int completed = 0;
+static uint8_t lastStatus = MEMORY_OK;
+
+/* Queue clock, set by the tests */
+static uint32_t now = 0;
+
+static void done(uint8_t status, void *arg)
+{
+  lastStatus = status;
+  if (completed < MX25R6435F_QUEUE_DEPTH) {
+    order[completed] = (int)(intptr_t)arg;
+  }
+  completed++;
+}
+
+static uint32_t testClock(void)
+{
+  return now;
+}
+
+static void *tag(int id)
+{
+  return (void *)(intptr_t)id;
+}
+
+static void setUp(void)
+{
+  memset(mem, 0xFF, sizeof(mem));
+  memset(order, 0, sizeof(order));
+  completed = 0;
+  lastStatus = MEMORY_OK;
+  now = 0;
+}
+
+/* Reads before writes before erases when their addresses are independent */
+static void testPriority(void)
+{
+  MX25R6435FSimDevice device(mem, MEM_SIZE);
+  MX25R6435FQueue queue(device);
+  uint8_t data[16], buffer[16];
+
+  setUp();
+  memset(data, 0x5A, sizeof(data));
+
+  CHECK(queue.eraseSector(3 * MX25R6435F_SECTOR_SIZE, done, tag(1)) == MEMORY_OK);
+  CHECK(queue.write(data, 2 * MX25R6435F_SECTOR_SIZE, sizeof(data), done, tag(2)) == MEMORY_OK);
+  CHECK(queue.read(buffer, MX25R6435F_SECTOR_SIZE, sizeof(buffer), done, tag(3)) == MEMORY_OK);
+  CHECK(queue.depth() == 3);
+
+  CHECK(queue.flush() == MEMORY_OK);
+  CHECK(completed == 3);
+  CHECK((order[0] == 3) && (order[1] == 2) && (order[2] == 1));
+  CHECK(queue.depth() == 0);
+  CHECK(queue.process() == false);
+}
+
+/* A request never overtakes an older one of another class on the same addresses */
+static void testOverlap(void)
+{
+  MX25R6435FSimDevice device(mem, MEM_SIZE);
+  MX25R6435FQueue queue(device);
+  uint8_t data[16], before[16], after[16], erased[16];
+
+  setUp();
+  memset(data, 0x33, sizeof(data));
+  memset(mem, 0x00, MX25R6435F_SECTOR_SIZE);
+
+  /* The read of the old data stays before the write, the read of the new
+     data after it, the read of the sector after its erase */
+  CHECK(queue.read(before, 0x100, sizeof(before), done, tag(1)) == MEMORY_OK);
+  CHECK(queue.eraseSector(0x000, done, tag(2)) == MEMORY_OK);
+  CHECK(queue.write(data, 0x100, sizeof(data), done, tag(3)) == MEMORY_OK);
+  CHECK(queue.read(after, 0x100, sizeof(after), done, tag(4)) == MEMORY_OK);
+  CHECK(queue.read(erased, 0x800, sizeof(erased), done, tag(5)) == MEMORY_OK);
+
+  CHECK(queue.flush() == MEMORY_OK);
+  CHECK(completed == 5);
+  CHECK((order[0] == 1) && (order[1] == 2) && (order[2] == 5) && (order[3] == 3) && (order[4] == 4));
+
+  for (uint32_t i = 0; i < sizeof(data); i++) {
+    CHECK(before[i] == 0x00);
+    CHECK(after[i] == 0x33);
+    CHECK(erased[i] == 0xFF);
+  }
+  CHECK(device.erases == 1);
+}
+
+/* The pending writes of a page are programmed together */
+static void testWriteMerge(void)
+{
+  MX25R6435FSimDevice device(mem, MEM_SIZE);
+  MX25R6435FQueue queue(device);
+  memory_queue_stats_t stats;
+  uint8_t first[16], second[16], third[16];
+
+  setUp();
+  memset(first, 0x11, sizeof(first));
+  memset(second, 0x22, sizeof(second));
+  memset(third, 0x44, sizeof(third));
+
+  /* The first two share a page, the third is in the next one */
+  CHECK(queue.write(first, 0x200, sizeof(first), done, tag(1)) == MEMORY_OK);
+  CHECK(queue.write(second, 0x280, sizeof(second), done, tag(2)) == MEMORY_OK);
+  CHECK(queue.write(third, 0x300, sizeof(third), done, tag(3)) == MEMORY_OK);
+
+  CHECK(queue.process() == true);
+  CHECK(completed == 2);
+  CHECK(device.writes == 1);
+
+  CHECK(queue.flush() == MEMORY_OK);
+  CHECK(completed == 3);
+  CHECK(device.writes == 2);
+  CHECK(memcmp(mem + 0x200, first, sizeof(first)) == 0);
+  CHECK(memcmp(mem + 0x280, second, sizeof(second)) == 0);
+  CHECK(memcmp(mem + 0x300, third, sizeof(third)) == 0);
+
+  queue.stats(&stats);
+  CHECK(stats.mergedWrites == 1);
+  CHECK(stats.completed[MEMORY_QUEUE_WRITE] == 3);
+}
+
+/* The pending erases of a sector are done once */
+static void testEraseDedup(void)
+{
+  MX25R6435FSimDevice device(mem, MEM_SIZE);
+  MX25R6435FQueue queue(device);
+  memory_queue_stats_t stats;
+
+  setUp();
+  memset(mem, 0x00, sizeof(mem));
+
+  CHECK(queue.eraseSector(MX25R6435F_SECTOR_SIZE, done, tag(1)) == MEMORY_OK);
+  CHECK(queue.eraseSector(MX25R6435F_SECTOR_SIZE + 0x10, done, tag(2)) == MEMORY_OK);
+  CHECK(queue.eraseSector(2 * MX25R6435F_SECTOR_SIZE, done, tag(3)) == MEMORY_OK);
+
+  CHECK(queue.flush() == MEMORY_OK);
+  CHECK(completed == 3);
+  CHECK(device.erases == 2);
+  CHECK((mem[MX25R6435F_SECTOR_SIZE] == 0xFF) && (mem[2 * MX25R6435F_SECTOR_SIZE] == 0xFF));
+  CHECK(mem[0] == 0x00);
+
+  queue.stats(&stats);
+  CHECK(stats.mergedErases == 1);
+  CHECK(stats.completed[MEMORY_QUEUE_ERASE] == 3);
+}
+
+/* Depth and wait counters, measured with the clock of the test */
+static void testStats(void)
+{
+  MX25R6435FSimDevice device(mem, MEM_SIZE);
+  MX25R6435FQueue queue(device);
+  memory_queue_stats_t stats;
+  uint8_t data[16], buffer[16];
+
+  setUp();
+  queue.setClock(testClock);
+  memset(data, 0x77, sizeof(data));
+
+  now = 10;
+  CHECK(queue.write(data, 0x1000, sizeof(data), done, tag(1)) == MEMORY_OK);
+  CHECK(queue.read(buffer, 0x2000, sizeof(buffer), done, tag(2)) == MEMORY_OK);
+  CHECK(queue.eraseSector(0x3000, done, tag(3)) == MEMORY_OK);
+
+  queue.stats(&stats);
+  CHECK((stats.depth == 3) && (stats.maxDepth == 3));
+  CHECK(stats.submitted[MEMORY_QUEUE_READ] == 1);
+  CHECK(stats.submitted[MEMORY_QUEUE_WRITE] == 1);
+  CHECK(stats.submitted[MEMORY_QUEUE_ERASE] == 1);
+
+  now = 110;
+  CHECK(queue.process() == true);
+  now = 310;
+  CHECK(queue.process() == true);
+  now = 1010;
+  CHECK(queue.process() == true);
+  CHECK(queue.process() == false);
+
+  queue.stats(&stats);
+  CHECK((stats.depth == 0) && (stats.maxDepth == 3));
+  CHECK(stats.waitTotal[MEMORY_QUEUE_READ] == 100);
+  CHECK(stats.waitTotal[MEMORY_QUEUE_WRITE] == 300);
+  CHECK(stats.waitMax[MEMORY_QUEUE_ERASE] == 1000);
+  CHECK(stats.completed[MEMORY_QUEUE_READ] == 1);
+  CHECK((stats.mergedWrites == 0) && (stats.mergedErases == 0));
+
+  /* The depth is kept by the reset */
+  CHECK(queue.eraseSector(0x4000) == MEMORY_OK);
+  queue.resetStats();
+  queue.stats(&stats);
+  CHECK((stats.depth == 1) && (stats.maxDepth == 1));
+  CHECK((stats.submitted[MEMORY_QUEUE_ERASE] == 0) && (stats.waitMax[MEMORY_QUEUE_ERASE] == 0));
+}
+
+/* A full queue refuses the requests, a failed request is reported by flush() */
+static void testLimits(void)
+{
+  MX25R6435FSimDevice device(mem, MEM_SIZE);
+  MX25R6435FQueue queue(device);
+  uint8_t buffer[16];
+
+  setUp();
+
+  for (uint32_t i = 0; i < MX25R6435F_QUEUE_DEPTH; i++) {
+    CHECK(queue.read(buffer, 0, sizeof(buffer)) == MEMORY_OK);
+  }
+  CHECK(queue.read(buffer, 0, sizeof(buffer)) == MEMORY_BUSY);
+  CHECK(queue.read(NULL, 0, sizeof(buffer)) == MEMORY_ERROR);
+  CHECK(queue.flush() == MEMORY_OK);
+
+  CHECK(queue.read(buffer, MEM_SIZE, sizeof(buffer), done, tag(1)) == MEMORY_OK);
+  CHECK(queue.flush() == MEMORY_ERROR);
+  CHECK((completed == 1) && (lastStatus == MEMORY_ERROR));
+}
+
+int main(void)
+{
+  testPriority();
+  testOverlap();
+  testWriteMerge();
+  testEraseDedup();
+  testStats();
+  testLimits();
+
+  if (failures != 0) {
+    printf("queue_test: %d failure(s)\n", failures);
+    return 1;
+  }
+
+  printf("queue_test: OK\n");
+  return 0;
+}